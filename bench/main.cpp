@@ -0,0 +1,487 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <dirent.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "main.h"
+#include "libpamanager.h"
+#include "SoundDeviceManager.h"
+#include "MockAudioServer.h"
+
+using namespace std::chrono_literals;
+using namespace LibPAmanager;
+
+// all allocations of the process are counted, for the allocations per hotplug event
+static std::atomic<uint64_t> g_Allocations{0};
+
+void* operator new(size_t size)
+{
+    g_Allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = malloc(size ? size : 1))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t size) noexcept
+{
+    free(memory);
+}
+
+//
+// pamanagerBench: runs the device manager against a private PulseAudio daemon
+// with null sinks and sources and prints the results as JSON;
+// with --mock <devices> an in-process MockAudioServer is used instead
+//
+namespace Bench
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int ITERATIONS = 200;
+    constexpr int HOTPLUG_ITERATIONS = 20;
+    constexpr int RECONNECT_ITERATIONS = 20;
+    constexpr auto IDLE_DURATION = 5s;
+    constexpr auto EVENT_TIMEOUT = 5s;
+
+    pid_t g_DaemonPid = 0;
+    std::string g_RuntimeDirectory;
+
+    // events from the device manager, signalled from the PA thread
+    std::mutex g_EventMutex;
+    std::condition_variable g_EventCondition;
+    uint g_OutputDevicesAdded = 0;
+    Clock::time_point g_OutputDeviceAddedTime;
+    uint g_ConnectionsRestored = 0;
+    Clock::time_point g_ConnectionRestoredTime;
+    uint g_ListChangedEvents = 0;
+
+    struct Percentiles
+    {
+        double m_P50;
+        double m_P90;
+        double m_P99;
+        double m_Max;
+        size_t m_Samples;
+    };
+
+    Percentiles CalculatePercentiles(std::vector<double> samples)
+    {
+        if (samples.empty())
+        {
+            return {0, 0, 0, 0, 0};
+        }
+        std::sort(samples.begin(), samples.end());
+        auto at = [&](double fraction) { return samples[static_cast<size_t>(fraction * (samples.size() - 1))]; };
+        return {at(0.5), at(0.9), at(0.99), samples.back(), samples.size()};
+    }
+
+    std::string ToJSON(const Percentiles& percentiles)
+    {
+        std::stringstream json;
+        json << "{\"samples\": " << percentiles.m_Samples << ", \"p50_us\": " << percentiles.m_P50
+             << ", \"p90_us\": " << percentiles.m_P90 << ", \"p99_us\": " << percentiles.m_P99
+             << ", \"max_us\": " << percentiles.m_Max << "}";
+        return json.str();
+    }
+
+    double ElapsedMicroseconds(Clock::time_point start, Clock::time_point end)
+    {
+        return std::chrono::duration<double, std::micro>(end - start).count();
+    }
+
+    //
+    // start "pulseaudio" with its own runtime directory, so the user's daemon is not touched
+    //
+    bool StartDaemon()
+    {
+        char directoryTemplate[] = "/tmp/pamanagerBench-XXXXXX";
+        if (!mkdtemp(directoryTemplate))
+        {
+            PRINT_ERROR("StartDaemon: mkdtemp() failed");
+            return false;
+        }
+        g_RuntimeDirectory = directoryTemplate;
+        std::string socket = g_RuntimeDirectory + "/native";
+
+        setenv("XDG_RUNTIME_DIR", g_RuntimeDirectory.c_str(), 1);
+        setenv("PULSE_RUNTIME_PATH", g_RuntimeDirectory.c_str(), 1);
+        setenv("PULSE_STATE_PATH", g_RuntimeDirectory.c_str(), 1);
+        setenv("PULSE_SERVER", (std::string("unix:") + socket).c_str(), 1);
+
+        g_DaemonPid = fork();
+        if (g_DaemonPid == 0)
+        {
+            std::string protocol = "module-native-protocol-unix socket=" + socket;
+            execlp("pulseaudio", "pulseaudio", "-n", "--daemonize=no", "--exit-idle-time=-1", "--use-pid-file=no",
+                   "--disable-shm", "--log-target=stderr", "--log-level=error",
+                   "-L", protocol.c_str(),
+                   "-L", "module-null-sink sink_name=bench_sink_a",
+                   "-L", "module-null-sink sink_name=bench_sink_b",
+                   "-L", "module-null-source source_name=bench_source",
+                   static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        if (g_DaemonPid < 0)
+        {
+            PRINT_ERROR("StartDaemon: fork() failed");
+            return false;
+        }
+
+        // wait for the socket to appear
+        for (int attempt = 0; attempt < 500; attempt++)
+        {
+            struct stat status;
+            if (stat(socket.c_str(), &status) == 0)
+            {
+                return true;
+            }
+            std::this_thread::sleep_for(10ms);
+        }
+        PRINT_ERROR("StartDaemon: pulseaudio did not come up");
+        return false;
+    }
+
+    void StopDaemon()
+    {
+        if (g_DaemonPid > 0)
+        {
+            kill(g_DaemonPid, SIGTERM);
+            waitpid(g_DaemonPid, nullptr, 0);
+        }
+        if (!g_RuntimeDirectory.empty())
+        {
+            std::string command = "rm -rf " + g_RuntimeDirectory;
+            if (system(command.c_str()) != 0)
+            {
+                PRINT_ERROR("StopDaemon: could not remove runtime directory");
+            }
+        }
+    }
+
+    // voluntary and involuntary context switches of all threads of this process
+    uint64_t GetContextSwitches()
+    {
+        uint64_t contextSwitches = 0;
+        DIR* directory = opendir("/proc/self/task");
+        if (!directory)
+        {
+            return 0;
+        }
+        while (auto entry = readdir(directory))
+        {
+            if (entry->d_name[0] == '.')
+            {
+                continue;
+            }
+            std::ifstream status(std::string("/proc/self/task/") + entry->d_name + "/status");
+            std::string line;
+            while (std::getline(status, line))
+            {
+                if ((line.rfind("voluntary_ctxt_switches:", 0) == 0) ||
+                    (line.rfind("nonvoluntary_ctxt_switches:", 0) == 0))
+                {
+                    contextSwitches += std::stoull(line.substr(line.find(':') + 1));
+                }
+            }
+        }
+        closedir(directory);
+        return contextSwitches;
+    }
+
+    double GetCPUTimeSeconds()
+    {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+               (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+}
+
+using namespace Bench;
+
+int main(int argc, char* argv[])
+{
+    MockAudioServer* mockAudioServer = nullptr;
+    uint mockDevices = 0;
+    const char* resultFile = nullptr;
+    for (int argument = 1; argument < argc; argument++)
+    {
+        if ((std::string(argv[argument]) == "--mock") && (argument + 1 < argc))
+        {
+            mockDevices = std::stoul(argv[++argument]);
+        }
+        else
+        {
+            resultFile = argv[argument];
+        }
+    }
+
+    auto soundDeviceManager = SoundDeviceManager::GetInstance();
+    if (mockDevices)
+    {
+        MockAudioServer::Configuration configuration;
+        configuration.m_Sinks = mockDevices;
+        configuration.m_Sources = mockDevices;
+        configuration.m_Cards = 1;
+        auto server = std::make_unique<MockAudioServer>(configuration);
+        mockAudioServer = server.get();
+        soundDeviceManager->SetAudioServer(std::move(server));
+    }
+    else if (!StartDaemon())
+    {
+        StopDaemon();
+        return 1;
+    }
+
+    soundDeviceManager->SetCallback([](const Event& event)
+    {
+        std::lock_guard<std::mutex> lock(g_EventMutex);
+        switch (event.GetType())
+        {
+            case Event::OUTPUT_DEVICE_ADDED:
+                g_OutputDevicesAdded++;
+                g_OutputDeviceAddedTime = Clock::now();
+                break;
+            case Event::CONNECTION_RESTORED:
+                g_ConnectionsRestored++;
+                g_ConnectionRestoredTime = Clock::now();
+                break;
+            case Event::OUTPUT_DEVICE_LIST_CHANGED:
+            case Event::INPUT_DEVICE_LIST_CHANGED:
+            case Event::PLAYBACK_STREAM_LIST_CHANGED:
+            case Event::RECORD_STREAM_LIST_CHANGED:
+            case Event::CARD_LIST_CHANGED:
+                g_ListChangedEvents++;
+                break;
+            default:
+                break;
+        }
+        g_EventCondition.notify_all();
+    });
+
+    // time to DEVICE_MANAGER_READY
+    auto startTime = Clock::now();
+    soundDeviceManager->Start();
+    bool ready = soundDeviceManager->WaitUntilReady(EVENT_TIMEOUT);
+    double timeToReady = ready ? static_cast<double>(soundDeviceManager->GetTimeToReady().count()) : -1;
+
+    // the benchmarks below need a default sink
+    while (!soundDeviceManager->GetSnapshot()->m_DefaultOutputDeviceHandle.IsValid())
+    {
+        if (Clock::now() - startTime > EVENT_TIMEOUT)
+        {
+            PRINT_ERROR("pamanagerBench: no default sink");
+            StopDaemon();
+            return 1;
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+
+    // SetVolume round trip: call until the server acknowledged
+    std::vector<double> setVolumeSamples;
+    for (int iteration = 0; iteration < ITERATIONS; iteration++)
+    {
+        auto requestTime = Clock::now();
+        auto result = soundDeviceManager->SetVolume(iteration % 100).get();
+        if (result.m_Success)
+        {
+            setVolumeSamples.push_back(ElapsedMicroseconds(requestTime, result.m_Timestamp));
+        }
+    }
+
+    // SetOutputDevice round trip, alternating between the null sinks
+    std::vector<double> setOutputDeviceSamples;
+    for (int iteration = 0; iteration < ITERATIONS; iteration++)
+    {
+        auto requestTime = Clock::now();
+        auto result = soundDeviceManager->CycleNextOutputDevice().get();
+        if (result.m_Success)
+        {
+            setOutputDeviceSamples.push_back(ElapsedMicroseconds(requestTime, result.m_Timestamp));
+        }
+    }
+
+    // hotplug to callback, includes starting pactl when running against the daemon;
+    // the allocations include the bench's own and, with --mock, those of the server
+    std::vector<double> hotplugSamples;
+    uint64_t allocationsStart = g_Allocations.load(std::memory_order_relaxed);
+    for (int iteration = 0; iteration < HOTPLUG_ITERATIONS; iteration++)
+    {
+        uint outputDevicesAdded;
+        {
+            std::lock_guard<std::mutex> lock(g_EventMutex);
+            outputDevicesAdded = g_OutputDevicesAdded;
+        }
+        std::string sinkName = "bench_hotplug_" + std::to_string(iteration);
+        auto requestTime = Clock::now();
+        if (mockAudioServer)
+        {
+            mockAudioServer->AddSink(sinkName, sinkName);
+        }
+        else
+        {
+            std::string command = "pactl load-module module-null-sink sink_name=" + sinkName + " > /dev/null";
+            if (system(command.c_str()) != 0)
+            {
+                PRINT_ERROR("pamanagerBench: pactl load-module failed");
+                break;
+            }
+        }
+        std::unique_lock<std::mutex> lock(g_EventMutex);
+        if (g_EventCondition.wait_for(lock, EVENT_TIMEOUT, [&] { return g_OutputDevicesAdded > outputDevicesAdded; }))
+        {
+            hotplugSamples.push_back(ElapsedMicroseconds(requestTime, g_OutputDeviceAddedTime));
+        }
+    }
+    double allocationsPerHotplug =
+        static_cast<double>(g_Allocations.load(std::memory_order_relaxed) - allocationsStart) / HOTPLUG_ITERATIONS;
+
+    // profile switch until its devices are registered, alternating between two profiles of the first card;
+    // the null sinks of the daemon have no card, so this only runs against the mock
+    std::vector<double> profileSwitchSamples;
+    auto cards = soundDeviceManager->GetCards();
+    if (!cards->empty() && (cards->front().m_Profiles->size() > 2))
+    {
+        auto& card = cards->front();
+        for (int iteration = 0; iteration < ITERATIONS; iteration++)
+        {
+            auto& profile = (*card.m_Profiles)[1 + iteration % 2];
+            auto requestTime = Clock::now();
+            auto result = soundDeviceManager->SetCardProfile(card.m_PAIndex, profile.m_Name).get();
+            if (result.m_Success)
+            {
+                profileSwitchSamples.push_back(ElapsedMicroseconds(requestTime, result.m_Timestamp));
+            }
+        }
+    }
+
+    // server restart until the registry is resynced; nothing changed in between, so the resync
+    // should not raise list changed events (mock only, restarting the daemon would take seconds)
+    std::vector<double> reconnectSamples;
+    uint resyncListChangedEvents = 0;
+    if (mockAudioServer)
+    {
+        for (int iteration = 0; iteration < RECONNECT_ITERATIONS; iteration++)
+        {
+            uint connectionsRestored;
+            uint listChangedEvents;
+            {
+                std::lock_guard<std::mutex> lock(g_EventMutex);
+                connectionsRestored = g_ConnectionsRestored;
+                listChangedEvents = g_ListChangedEvents;
+            }
+            auto requestTime = Clock::now();
+            mockAudioServer->Restart(0);
+            std::unique_lock<std::mutex> lock(g_EventMutex);
+            if (g_EventCondition.wait_for(lock, EVENT_TIMEOUT,
+                                          [&] { return g_ConnectionsRestored > connectionsRestored; }))
+            {
+                reconnectSamples.push_back(ElapsedMicroseconds(requestTime, g_ConnectionRestoredTime));
+                resyncListChangedEvents += g_ListChangedEvents - listChangedEvents;
+            }
+        }
+    }
+
+    // idle: let everything settle, then measure CPU time and wakeups
+    std::this_thread::sleep_for(500ms);
+    double cpuStart = GetCPUTimeSeconds();
+    uint64_t contextSwitchesStart = GetContextSwitches();
+    auto idleStart = Clock::now();
+    std::this_thread::sleep_for(IDLE_DURATION);
+    double idleSeconds = std::chrono::duration<double>(Clock::now() - idleStart).count();
+    // one context switch belongs to the main thread's sleep
+    uint64_t contextSwitches = GetContextSwitches() - contextSwitchesStart;
+    contextSwitches = contextSwitches > 0 ? contextSwitches - 1 : 0;
+    double cpuPercent = 100.0 * (GetCPUTimeSeconds() - cpuStart) / idleSeconds;
+
+    // the same with a level meter on every sink and source
+    soundDeviceManager->EnableLevelMeters(true);
+    std::this_thread::sleep_for(500ms);
+    cpuStart = GetCPUTimeSeconds();
+    auto meteringStart = Clock::now();
+    std::this_thread::sleep_for(IDLE_DURATION);
+    double meteringSeconds = std::chrono::duration<double>(Clock::now() - meteringStart).count();
+    double meteringCPUPercent = 100.0 * (GetCPUTimeSeconds() - cpuStart) / meteringSeconds;
+    size_t levelMeters = soundDeviceManager->GetLevels()->size();
+    soundDeviceManager->EnableLevelMeters(false);
+
+    auto coalescing = soundDeviceManager->GetCoalescingStatistics();
+
+    std::stringstream json;
+    json << "{\n"
+         << "  \"version\": \"" << LIBPAMANAGER_VERSION << "\",\n"
+         << "  \"server\": \"" << (mockAudioServer ? "mock" : "pulseaudio") << "\",\n"
+         << "  \"devices\": " << soundDeviceManager->GetSnapshot()->m_OutputDevices.size() << ",\n"
+         << "  \"time_to_ready_us\": " << timeToReady << ",\n"
+         << "  \"set_volume\": " << ToJSON(CalculatePercentiles(setVolumeSamples)) << ",\n"
+         << "  \"set_output_device\": " << ToJSON(CalculatePercentiles(setOutputDeviceSamples)) << ",\n"
+         << "  \"hotplug_to_callback\": " << ToJSON(CalculatePercentiles(hotplugSamples)) << ",\n"
+         << "  \"allocations_per_hotplug\": " << allocationsPerHotplug << ",\n"
+         << "  \"profile_switch\": " << ToJSON(CalculatePercentiles(profileSwitchSamples)) << ",\n"
+         << "  \"reconnect\": {\"to_consistent\": " << ToJSON(CalculatePercentiles(reconnectSamples))
+         << ", \"list_changed_events\": " << resyncListChangedEvents << "},\n"
+         << "  \"idle\": {\"seconds\": " << idleSeconds << ", \"cpu_percent\": " << cpuPercent
+         << ", \"wakeups_per_second\": " << contextSwitches / idleSeconds << "},\n"
+         << "  \"level_meters\": {\"meters\": " << levelMeters << ", \"cpu_percent\": " << meteringCPUPercent
+         << "},\n"
+         << "  \"coalescing\": {\"subscription_events\": " << coalescing.m_SubscriptionEvents
+         << ", \"refreshes\": " << coalescing.m_Refreshes << ", \"round_trips\": " << coalescing.m_RoundTrips
+         << ", \"round_trips_saved\": " << coalescing.m_RoundTripsSaved << "},\n"
+         << "  \"stats\": " << soundDeviceManager->GetStats().ToJSON() << "\n"
+         << "}\n";
+
+    std::cout << json.str() << std::flush;
+    if (resultFile)
+    {
+        std::ofstream file(resultFile);
+        file << json.str();
+    }
+
+    StopDaemon();
+    // the process-wide manager is never destroyed, the static destructors would stop its shared
+    // event loop under it; skip them, but write the log messages that are still queued
+    Logger::Flush();
+    _exit(0);
+}
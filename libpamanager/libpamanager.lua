@@ -30,3 +30,45 @@ project "libpamanager"
     filter { "configurations:Release" }
         defines { "NDEBUG" }
         optimize "On"
+
+-- the C ABI of src/pamanager_c.h, only the pamanager_* symbols are exported
+project "libpamanager_shared"
+    kind "SharedLib"
+    language "C++"
+    cppdialect "C++17"
+    targetdir "bin/%{cfg.buildcfg}"
+    targetname "pamanager"
+    pic "On"
+    visibility "Hidden"
+    buildoptions { "-fdiagnostics-color=always -Wall -Wextra -Wno-unused-parameter" }
+
+    defines
+    {
+        "_REENTRANT",
+        "LIBPAMANAGER_VERSION=\"0.1.0\"",
+    }
+
+    files 
+    { 
+        "src/**.h", 
+        "src/**.cpp",
+    }
+
+    includedirs 
+    { 
+        "src",
+    }
+
+    links
+    {
+        "pulse",
+        "pthread",
+    }
+
+    filter { "configurations:Debug" }
+        defines { "DEBUG", "VERBOSE" }
+        symbols "On"
+
+    filter { "configurations:Release" }
+        defines { "NDEBUG" }
+        optimize "On"
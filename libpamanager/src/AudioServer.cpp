@@ -0,0 +1,324 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <algorithm>
+#include <vector>
+
+#include "libpamanager.h"
+#include "AudioServer.h"
+
+namespace LibPAmanager
+{
+    namespace
+    {
+        // requests that replace the effect of an older one for the same target
+        bool Supersedes(OperationType type)
+        {
+            return (type == OperationType::SET_DEFAULT_SINK) || (type == OperationType::SET_CARD_PROFILE);
+        }
+
+        void CountMax(std::atomic<uint64_t>& maximum, uint64_t value)
+        {
+            if (value > maximum.load(std::memory_order_relaxed))
+            {
+                maximum.store(value, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    AudioServer::AudioServer()
+    {
+        auto timeout = [this](OperationType type) -> pa_usec_t& { return m_OperationTimeouts[static_cast<int>(type)]; };
+        timeout(OperationType::QUERY) = 5 * PA_USEC_PER_SEC;
+        timeout(OperationType::SUBSCRIBE) = 5 * PA_USEC_PER_SEC;
+        timeout(OperationType::SET_DEFAULT_SINK) = 2 * PA_USEC_PER_SEC;
+        timeout(OperationType::SET_SINK_VOLUME) = 2 * PA_USEC_PER_SEC;
+        timeout(OperationType::MOVE_STREAM) = 2 * PA_USEC_PER_SEC;
+        timeout(OperationType::SET_STREAM_VOLUME) = 2 * PA_USEC_PER_SEC;
+        // the server loads and unloads the devices of the card before it answers
+        timeout(OperationType::SET_CARD_PROFILE) = 5 * PA_USEC_PER_SEC;
+    }
+
+    AudioServer::~AudioServer()
+    {
+        // the backends drop their operations, nothing is left to cancel here
+        m_Counters->m_InFlight.fetch_sub(m_Operations.size(), std::memory_order_relaxed);
+        if (m_OperationTimer)
+        {
+            FreeTimer(m_OperationTimer);
+        }
+    }
+
+    void AudioServer::SetOperationCounters(OperationCounters* counters)
+    {
+        auto inFlight = m_Operations.size();
+        m_Counters->m_InFlight.fetch_sub(inFlight, std::memory_order_relaxed);
+        m_Counters = counters ? counters : &m_OwnCounters;
+        m_Counters->m_InFlight.fetch_add(inFlight, std::memory_order_relaxed);
+    }
+
+    void AudioServer::SetOperationTimeout(OperationType type, pa_usec_t timeout)
+    {
+        m_OperationTimeouts[static_cast<int>(type)] = timeout;
+    }
+
+    bool AudioServer::AdmitOperation()
+    {
+        int error = m_CancelError;
+        if ((error == PA_OK) && (m_Operations.size() >= m_MaxOperations))
+        {
+            error = PA_ERR_BUSY;
+        }
+        if (error != PA_OK)
+        {
+            m_RejectionError = error;
+            m_Counters->m_Rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t AudioServer::TrackOperation(OperationType type, uint key, std::function<void()> cancel,
+                                         std::function<void()> fail)
+    {
+        uint64_t id = m_NextOperation++;
+        pa_usec_t deadline = pa_rtclock_now() + m_OperationTimeouts[static_cast<int>(type)];
+        m_Operations.emplace(id, Operation{type, key, deadline, std::move(cancel), std::move(fail)});
+        auto inFlight = m_Counters->m_InFlight.fetch_add(1, std::memory_order_relaxed) + 1;
+        CountMax(m_Counters->m_MaxInFlight, inFlight);
+        m_Counters->m_Issued.fetch_add(1, std::memory_order_relaxed);
+
+        // the answer to the older request would be overwritten anyway
+        if (Supersedes(type))
+        {
+            auto& target = m_Targets[{type, key}];
+            auto older = m_Operations.find(target);
+            target = id;
+            if (older != m_Operations.end())
+            {
+                m_Counters->m_Superseded.fetch_add(1, std::memory_order_relaxed);
+                Operation operation = std::move(older->second);
+                Untrack(older);
+                if (operation.m_Cancel)
+                {
+                    operation.m_Cancel();
+                }
+                Fail(operation, PA_ERR_KILLED);
+            }
+        }
+        ScheduleOperationTimeout(deadline);
+        return id;
+    }
+
+    bool AudioServer::FinishOperation(uint64_t id)
+    {
+        auto operation = m_Operations.find(id);
+        if (operation == m_Operations.end())
+        {
+            return false;
+        }
+        Untrack(operation);
+        return true;
+    }
+
+    void AudioServer::FailOperation(uint64_t id, int error)
+    {
+        auto iterator = m_Operations.find(id);
+        if (iterator == m_Operations.end())
+        {
+            return;
+        }
+        m_Counters->m_Cancelled.fetch_add(1, std::memory_order_relaxed);
+        Operation operation = std::move(iterator->second);
+        Untrack(iterator);
+        Fail(operation, error);
+    }
+
+    void AudioServer::CancelOperations(int error)
+    {
+        // the failure callbacks may issue new requests, they are refused until all are done
+        m_CancelError = error;
+        while (!m_Operations.empty())
+        {
+            m_Counters->m_Cancelled.fetch_add(1, std::memory_order_relaxed);
+            Operation operation = std::move(m_Operations.begin()->second);
+            Untrack(m_Operations.begin());
+            if (operation.m_Cancel)
+            {
+                operation.m_Cancel();
+            }
+            Fail(operation, error);
+        }
+        m_CancelError = PA_OK;
+    }
+
+    void AudioServer::DropOperations()
+    {
+        while (!m_Operations.empty())
+        {
+            Operation operation = std::move(m_Operations.begin()->second);
+            Untrack(m_Operations.begin());
+            if (operation.m_Cancel)
+            {
+                operation.m_Cancel();
+            }
+        }
+    }
+
+    int AudioServer::GetOperationError() const
+    {
+        if (m_FailureError != PA_OK)
+        {
+            return m_FailureError;
+        }
+        int error = m_RejectionError;
+        m_RejectionError = PA_OK;
+        return error;
+    }
+
+    std::function<void()> AudioServer::FailReply(pa_context_success_cb_t callback, void* userdata)
+    {
+        return [callback, userdata]()
+        {
+            if (callback)
+            {
+                callback(nullptr, 0, userdata);
+            }
+        };
+    }
+
+    std::function<void()> AudioServer::FailReply(pa_server_info_cb_t callback, void* userdata)
+    {
+        return [callback, userdata]() { callback(nullptr, nullptr, userdata); };
+    }
+
+    void AudioServer::Untrack(std::map<uint64_t, Operation>::iterator operation)
+    {
+        if (Supersedes(operation->second.m_Type))
+        {
+            auto target = m_Targets.find({operation->second.m_Type, operation->second.m_Key});
+            if ((target != m_Targets.end()) && (target->second == operation->first))
+            {
+                m_Targets.erase(target);
+            }
+        }
+        m_Operations.erase(operation);
+        m_Counters->m_InFlight.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void AudioServer::Fail(Operation& operation, int error)
+    {
+        // nested failures, e.g. a request superseded from a failure callback, restore the outer error
+        int outerError = m_FailureError;
+        m_FailureError = error;
+        operation.m_Fail();
+        m_FailureError = outerError;
+    }
+
+    // one timer for all operations; it is not moved back when operations finish, a wakeup
+    // without expired operations just arms it for the next deadline
+    void AudioServer::ScheduleOperationTimeout(pa_usec_t deadline)
+    {
+        if (m_OperationTimer && (m_OperationTimerDeadline <= deadline))
+        {
+            return;
+        }
+        m_OperationTimerDeadline = deadline;
+        pa_usec_t now = pa_rtclock_now();
+        pa_usec_t delay = deadline > now ? deadline - now : 0;
+        if (!m_OperationTimer)
+        {
+            m_OperationTimer = NewTimer(delay, OperationTimerCallback, this);
+        }
+        else
+        {
+            RestartTimer(m_OperationTimer, delay);
+        }
+    }
+
+    void AudioServer::OperationTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent, const struct timeval* tv,
+                                             void* userdata)
+    {
+        auto server = static_cast<AudioServer*>(userdata);
+        pa_usec_t now = pa_rtclock_now();
+
+        std::vector<uint64_t> expired;
+        pa_usec_t next = PA_USEC_INVALID;
+        for (auto& operation : server->m_Operations)
+        {
+            if (operation.second.m_Deadline <= now)
+            {
+                expired.push_back(operation.first);
+            }
+            else
+            {
+                next = std::min(next, operation.second.m_Deadline);
+            }
+        }
+
+        // the timer is parked until the next request
+        server->m_OperationTimerDeadline = PA_USEC_INVALID;
+        server->m_MainloopAPI->time_restart(timeEvent, nullptr);
+
+        for (auto id : expired)
+        {
+            // an earlier failure callback may have cancelled it
+            auto iterator = server->m_Operations.find(id);
+            if (iterator == server->m_Operations.end())
+            {
+                continue;
+            }
+            PRINT_ERROR("OperationTimerCallback: operation %llu timed out", static_cast<unsigned long long>(id));
+            server->m_Counters->m_TimedOut.fetch_add(1, std::memory_order_relaxed);
+            Operation operation = std::move(iterator->second);
+            server->Untrack(iterator);
+            if (operation.m_Cancel)
+            {
+                operation.m_Cancel();
+            }
+            server->Fail(operation, PA_ERR_TIMEOUT);
+        }
+        if (next != PA_USEC_INVALID)
+        {
+            server->ScheduleOperationTimeout(next);
+        }
+    }
+
+    pa_time_event* AudioServer::NewTimer(pa_usec_t delay, pa_time_event_cb_t callback, void* userdata)
+    {
+        struct timeval tv;
+        pa_timeval_add(pa_gettimeofday(&tv), delay);
+        return m_MainloopAPI->time_new(m_MainloopAPI, &tv, callback, userdata);
+    }
+
+    void AudioServer::RestartTimer(pa_time_event* timeEvent, pa_usec_t delay)
+    {
+        struct timeval tv;
+        pa_timeval_add(pa_gettimeofday(&tv), delay);
+        m_MainloopAPI->time_restart(timeEvent, &tv);
+    }
+
+    void AudioServer::FreeTimer(pa_time_event* timeEvent)
+    {
+        m_MainloopAPI->time_free(timeEvent);
+    }
+}
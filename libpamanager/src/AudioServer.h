@@ -0,0 +1,213 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <map>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <pulse/pulseaudio.h>
+#include <sys/types.h>
+
+namespace LibPAmanager
+{
+    // stream property that marks the record streams of the level meters
+    constexpr const char* LEVEL_METER_PROPERTY = "pamanager.level_meter";
+
+    // the samples of a peak detect stream, each one the absolute peak of its window
+    using PeakCallback = void (*)(const float* samples, size_t count, void* userdata);
+    // the stream failed or the server ended it, e.g. with its source; it delivers nothing anymore
+    using PeakStreamEndedCallback = void (*)(void* userdata);
+
+    //
+    // record stream of a level meter, delivers samples until it is destroyed
+    //
+    class PeakStream
+    {
+    public:
+        virtual ~PeakStream() {}
+    };
+
+    // the kinds of requests, each with its own deadline
+    enum class OperationType
+    {
+        QUERY, // server, device, stream and card infos
+        SUBSCRIBE,
+        SET_DEFAULT_SINK,
+        SET_SINK_VOLUME,
+        MOVE_STREAM,
+        SET_STREAM_VOLUME,
+        SET_CARD_PROFILE,
+        TYPES
+    };
+
+    // written on the mainloop thread, can be read from any thread
+    struct OperationCounters
+    {
+        std::atomic<uint64_t> m_InFlight{0};
+        std::atomic<uint64_t> m_MaxInFlight{0};
+        std::atomic<uint64_t> m_Issued{0};
+        std::atomic<uint64_t> m_TimedOut{0};
+        std::atomic<uint64_t> m_Superseded{0}; // cancelled by a newer request for the same target
+        std::atomic<uint64_t> m_Rejected{0};   // refused over the in-flight cap
+        std::atomic<uint64_t> m_Cancelled{0};  // failed by CancelOperations() or the connection
+    };
+
+    //
+    // the server interactions of the device manager; requests return false if they
+    // could not be issued, replies arrive asynchronously on the mainloop thread
+    //
+    // every request is tracked until its reply arrives: a request that misses the deadline
+    // of its type, or is superseded by a newer one for the same target, is cancelled and
+    // its callback is called with a failure, GetErrno() then reports PA_ERR_TIMEOUT or
+    // PA_ERR_KILLED; over the in-flight cap requests are refused with PA_ERR_BUSY
+    //
+    class AudioServer
+    {
+    public:
+        static constexpr uint DEFAULT_MAX_OPERATIONS = 256;
+
+    public:
+        AudioServer();
+        virtual ~AudioServer();
+
+        void SetMainloopAPI(pa_mainloop_api* mainloopAPI) { m_MainloopAPI = mainloopAPI; }
+
+        // the counters can outlive the server, nullptr selects the server's own
+        void SetOperationCounters(OperationCounters* counters);
+        const OperationCounters& GetOperationCounters() const { return *m_Counters; }
+        void SetOperationTimeout(OperationType type, pa_usec_t timeout);
+        void SetMaxOperations(uint maxOperations) { m_MaxOperations = maxOperations; }
+        size_t GetOperationsInFlight() const { return m_Operations.size(); }
+
+        // fails every tracked operation with error, e.g. before disconnecting; requests
+        // issued by the failure callbacks are refused with the same error
+        void CancelOperations(int error);
+
+        virtual bool Connect(const char* server, pa_context_notify_cb_t stateCallback, void* userdata) = 0;
+        virtual pa_context_state_t GetState() const = 0;
+        virtual int GetErrno() const = 0;
+
+        virtual bool GetServerInfo(pa_server_info_cb_t callback, void* userdata) = 0;
+        virtual bool GetSinkInfoList(pa_sink_info_cb_t callback, void* userdata) = 0;
+        virtual bool GetSinkInfoByIndex(uint index, pa_sink_info_cb_t callback, void* userdata) = 0;
+        virtual bool GetSourceInfoList(pa_source_info_cb_t callback, void* userdata) = 0;
+        virtual bool GetSourceInfoByIndex(uint index, pa_source_info_cb_t callback, void* userdata) = 0;
+        virtual bool Subscribe(pa_subscription_mask_t mask, pa_context_subscribe_cb_t callback, void* userdata,
+                               pa_context_success_cb_t successCallback, void* successUserdata) = 0;
+        virtual bool SetDefaultSink(const char* name, pa_context_success_cb_t callback, void* userdata) = 0;
+        virtual bool SetSinkVolumeByIndex(uint index, const pa_cvolume* volume, pa_context_success_cb_t callback,
+                                          void* userdata) = 0;
+
+        // application streams
+        virtual bool GetSinkInputInfoList(pa_sink_input_info_cb_t callback, void* userdata) = 0;
+        virtual bool GetSinkInputInfo(uint index, pa_sink_input_info_cb_t callback, void* userdata) = 0;
+        virtual bool GetSourceOutputInfoList(pa_source_output_info_cb_t callback, void* userdata) = 0;
+        virtual bool GetSourceOutputInfo(uint index, pa_source_output_info_cb_t callback, void* userdata) = 0;
+        virtual bool MoveSinkInput(uint index, uint sinkIndex, pa_context_success_cb_t callback, void* userdata) = 0;
+        virtual bool MoveSourceOutput(uint index, uint sourceIndex, pa_context_success_cb_t callback,
+                                      void* userdata) = 0;
+        virtual bool SetSinkInputVolume(uint index, const pa_cvolume* volume, pa_context_success_cb_t callback,
+                                        void* userdata) = 0;
+        virtual bool SetSourceOutputVolume(uint index, const pa_cvolume* volume, pa_context_success_cb_t callback,
+                                           void* userdata) = 0;
+
+        // cards
+        virtual bool GetCardInfoList(pa_card_info_cb_t callback, void* userdata) = 0;
+        virtual bool GetCardInfoByIndex(uint index, pa_card_info_cb_t callback, void* userdata) = 0;
+        virtual bool SetCardProfileByIndex(uint index, const char* profile, pa_context_success_cb_t callback,
+                                           void* userdata) = 0;
+
+        // PA_STREAM_PEAK_DETECT record stream on a source: rate peaks per second, handed to
+        // the callback fragment peaks at a time; nullptr if it could not be created
+        virtual std::unique_ptr<PeakStream> OpenPeakStream(uint sourceIndex, uint rate, uint fragment,
+                                                           PeakCallback callback,
+                                                           PeakStreamEndedCallback endedCallback, void* userdata) = 0;
+
+        // timers on the mainloop the server is driven by
+        pa_time_event* NewTimer(pa_usec_t delay, pa_time_event_cb_t callback, void* userdata);
+        void RestartTimer(pa_time_event* timeEvent, pa_usec_t delay);
+        void FreeTimer(pa_time_event* timeEvent);
+
+    protected:
+        // false over the in-flight cap
+        bool AdmitOperation();
+        // the tracker owns the request from here: cancel drops it without a reply, fail
+        // calls the callback of the request with a failure; returns the id of the operation
+        uint64_t TrackOperation(OperationType type, uint key, std::function<void()> cancel,
+                                std::function<void()> fail);
+        // the reply is about to be delivered, false if the operation timed out or was superseded
+        bool FinishOperation(uint64_t id);
+        // the backend gave up on the operation, e.g. the connection was lost
+        void FailOperation(uint64_t id, int error);
+        // cancels all operations without calling back, for the destructors of the backends
+        void DropOperations();
+        // the error of a failure made up by the tracker, PA_OK if there is none
+        int GetOperationError() const;
+
+        // failure replies in the shape libpulse uses for each callback type
+        static std::function<void()> FailReply(pa_context_success_cb_t callback, void* userdata);
+        static std::function<void()> FailReply(pa_server_info_cb_t callback, void* userdata);
+        template <typename Info>
+        static std::function<void()> FailReply(void (*callback)(pa_context*, const Info*, int, void*), void* userdata)
+        {
+            return [callback, userdata]() { callback(nullptr, nullptr, -1, userdata); };
+        }
+
+    protected:
+        pa_mainloop_api* m_MainloopAPI = nullptr;
+
+    private:
+        struct Operation
+        {
+            OperationType m_Type;
+            uint m_Key;
+            pa_usec_t m_Deadline;
+            std::function<void()> m_Cancel;
+            std::function<void()> m_Fail;
+        };
+        using Target = std::pair<OperationType, uint>;
+
+        void Untrack(std::map<uint64_t, Operation>::iterator operation);
+        void Fail(Operation& operation, int error);
+        void ScheduleOperationTimeout(pa_usec_t deadline);
+        static void OperationTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent, const struct timeval* tv,
+                                           void* userdata);
+
+    private:
+        std::map<uint64_t, Operation> m_Operations; // by id, i.e. in the order they were issued
+        std::map<Target, uint64_t> m_Targets;       // operations that supersede older ones
+        uint64_t m_NextOperation = 1;
+        pa_usec_t m_OperationTimeouts[static_cast<int>(OperationType::TYPES)];
+        uint m_MaxOperations = DEFAULT_MAX_OPERATIONS;
+        pa_time_event* m_OperationTimer = nullptr;
+        pa_usec_t m_OperationTimerDeadline = 0;
+
+        int m_FailureError = PA_OK;         // while a made-up failure is delivered
+        mutable int m_RejectionError = PA_OK; // reported once, by the GetErrno() after the refusal
+        int m_CancelError = PA_OK;          // while CancelOperations() runs
+
+        OperationCounters m_OwnCounters;
+        OperationCounters* m_Counters = &m_OwnCounters;
+    };
+}
@@ -0,0 +1,155 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include "CardTable.h"
+
+namespace LibPAmanager
+{
+    namespace
+    {
+        bool Equal(const CardProfile& left, const CardProfile& right)
+        {
+            return (left.m_Name == right.m_Name) && (left.m_Description == right.m_Description) &&
+                   (left.m_Sinks == right.m_Sinks) && (left.m_Sources == right.m_Sources) &&
+                   (left.m_Priority == right.m_Priority) && (left.m_Available == right.m_Available);
+        }
+
+        bool Equal(const CardPort& left, const CardPort& right)
+        {
+            return (left.m_Name == right.m_Name) && (left.m_Description == right.m_Description) &&
+                   (left.m_Priority == right.m_Priority) && (left.m_Available == right.m_Available) &&
+                   (left.m_Output == right.m_Output) && (left.m_Profiles == right.m_Profiles);
+        }
+
+        template<typename T> bool Equal(const std::shared_ptr<const std::vector<T>>& left,
+                                        const std::shared_ptr<const std::vector<T>>& right)
+        {
+            if (!left || !right)
+            {
+                return left == right;
+            }
+            if (left->size() != right->size())
+            {
+                return false;
+            }
+            for (size_t entry = 0; entry < left->size(); entry++)
+            {
+                if (!Equal((*left)[entry], (*right)[entry]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    const CardProfile* CardRecord::FindProfile(const std::string& name) const
+    {
+        if (!m_Profiles)
+        {
+            return nullptr;
+        }
+        for (auto& profile : *m_Profiles)
+        {
+            if (profile.m_Name == name)
+            {
+                return &profile;
+            }
+        }
+        return nullptr;
+    }
+
+    bool CardTable::Update(CardRecord record)
+    {
+        auto existing = m_Cards.find(record.m_PAIndex);
+        if (existing == m_Cards.end())
+        {
+            m_Cards.emplace(record.m_PAIndex, std::move(record));
+            m_Published.reset();
+            return true;
+        }
+
+        auto& card = existing->second;
+        bool changed = (card.m_Name != record.m_Name) || (card.m_Description != record.m_Description) ||
+                       (card.m_ActiveProfile != record.m_ActiveProfile);
+        if (Equal(card.m_Profiles, record.m_Profiles))
+        {
+            record.m_Profiles = card.m_Profiles;
+        }
+        else
+        {
+            changed = true;
+        }
+        if (Equal(card.m_Ports, record.m_Ports))
+        {
+            record.m_Ports = card.m_Ports;
+        }
+        else
+        {
+            changed = true;
+        }
+        if (!changed)
+        {
+            return false;
+        }
+        card = std::move(record);
+        m_Published.reset();
+        return true;
+    }
+
+    bool CardTable::Remove(uint paIndex)
+    {
+        if (!m_Cards.erase(paIndex))
+        {
+            return false;
+        }
+        m_Published.reset();
+        return true;
+    }
+
+    void CardTable::Clear()
+    {
+        m_Cards.clear();
+        m_Published.reset();
+    }
+
+    const CardRecord* CardTable::Find(uint paIndex) const
+    {
+        auto existing = m_Cards.find(paIndex);
+        return existing != m_Cards.end() ? &existing->second : nullptr;
+    }
+
+    CardTable::CardList CardTable::Publish()
+    {
+        if (!m_Published)
+        {
+            auto cards = std::make_shared<std::vector<CardRecord>>();
+            cards->reserve(m_Cards.size());
+            for (auto& card : m_Cards)
+            {
+                cards->push_back(card.second);
+            }
+            m_Published = std::move(cards);
+        }
+        return m_Published;
+    }
+}
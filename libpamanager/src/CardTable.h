@@ -0,0 +1,93 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+namespace LibPAmanager
+{
+    struct CardProfile
+    {
+        std::string m_Name;
+        std::string m_Description;
+        uint m_Sinks;   // sinks the profile creates
+        uint m_Sources; // sources the profile creates, monitors not counted
+        uint m_Priority;
+        bool m_Available;
+    };
+
+    struct CardPort
+    {
+        std::string m_Name;
+        std::string m_Description;
+        uint m_Priority;
+        int m_Available;              // PA_PORT_AVAILABLE_UNKNOWN, _NO or _YES, e.g. for a jack
+        bool m_Output;
+        std::vector<uint> m_Profiles; // positions in the profile table of the card
+    };
+
+    using CardProfileTable = std::shared_ptr<const std::vector<CardProfile>>;
+    using CardPortTable = std::shared_ptr<const std::vector<CardPort>>;
+
+    // a sound card, e.g. a USB or Bluetooth device
+    struct CardRecord
+    {
+        uint m_PAIndex;
+        std::string m_Name;
+        std::string m_Description;
+        std::string m_ActiveProfile;
+        CardProfileTable m_Profiles;
+        CardPortTable m_Ports;
+
+        const CardProfile* FindProfile(const std::string& name) const;
+    };
+
+    //
+    // cards by PA index; an update that leaves the profiles or the ports unchanged keeps the
+    // tables already shared with the readers, so a profile switch only replaces the active profile
+    //
+    class CardTable
+    {
+    public:
+        using CardList = std::shared_ptr<const std::vector<CardRecord>>;
+
+        // insert or replace, returns false if the record did not change
+        bool Update(CardRecord record);
+        bool Remove(uint paIndex);
+        void Clear();
+
+        const CardRecord* Find(uint paIndex) const;
+        size_t Size() const { return m_Cards.size(); }
+
+        // ordered by PA index, shared between snapshots until the next change
+        CardList Publish();
+
+    private:
+        std::map<uint, CardRecord> m_Cards;
+        CardList m_Published;
+    };
+}
@@ -0,0 +1,234 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libpamanager.h"
+#include "DeviceCache.h"
+
+namespace LibPAmanager
+{
+    namespace
+    {
+        constexpr char MAGIC[4] = {'P', 'A', 'M', 'C'};
+        constexpr uint32_t VERSION = 1;
+
+        void Put(std::string& buffer, uint32_t value)
+        {
+            buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        void Put(std::string& buffer, const std::string& value)
+        {
+            Put(buffer, static_cast<uint32_t>(value.size()));
+            buffer.append(value);
+        }
+
+        // bounds-checked reader over the mapped file
+        struct Reader
+        {
+            const char* m_Data;
+            size_t m_Size;
+            size_t m_Position;
+
+            bool Get(uint32_t& value)
+            {
+                if (m_Size - m_Position < sizeof(value))
+                {
+                    return false;
+                }
+                memcpy(&value, m_Data + m_Position, sizeof(value));
+                m_Position += sizeof(value);
+                return true;
+            }
+
+            bool Get(std::string& value)
+            {
+                uint32_t length;
+                if (!Get(length) || (m_Size - m_Position < length))
+                {
+                    return false;
+                }
+                value.assign(m_Data + m_Position, length);
+                m_Position += length;
+                return true;
+            }
+        };
+    }
+
+    //
+    // layout: magic, version, number of input and output devices, default input and output name,
+    // then per device its volume, name and description; strings are length-prefixed
+    //
+    void DeviceCache::Encode(const Topology& topology, std::string& buffer)
+    {
+        buffer.clear();
+        buffer.append(MAGIC, sizeof(MAGIC));
+        Put(buffer, VERSION);
+        Put(buffer, static_cast<uint32_t>(topology.m_InputDevices.size()));
+        Put(buffer, static_cast<uint32_t>(topology.m_OutputDevices.size()));
+        Put(buffer, topology.m_DefaultInputDevice);
+        Put(buffer, topology.m_DefaultOutputDevice);
+        for (auto devices : {&topology.m_InputDevices, &topology.m_OutputDevices})
+        {
+            for (auto& device : *devices)
+            {
+                Put(buffer, static_cast<uint32_t>(device.m_Volume));
+                Put(buffer, device.m_Name);
+                Put(buffer, device.m_Description);
+            }
+        }
+    }
+
+    bool DeviceCache::Decode(const char* data, size_t size, Topology& topology)
+    {
+        if ((size < sizeof(MAGIC)) || memcmp(data, MAGIC, sizeof(MAGIC)))
+        {
+            return false;
+        }
+        Reader reader{data, size, sizeof(MAGIC)};
+        uint32_t version, numberOfInputDevices, numberOfOutputDevices;
+        if (!reader.Get(version) || (version != VERSION) || !reader.Get(numberOfInputDevices) ||
+            !reader.Get(numberOfOutputDevices) || !reader.Get(topology.m_DefaultInputDevice) ||
+            !reader.Get(topology.m_DefaultOutputDevice))
+        {
+            return false;
+        }
+
+        auto decodeDevices = [&reader](uint32_t numberOfDevices, std::vector<Device>& devices)
+        {
+            devices.clear();
+            for (uint32_t index = 0; index < numberOfDevices; index++)
+            {
+                Device device;
+                uint32_t volume;
+                if (!reader.Get(volume) || !reader.Get(device.m_Name) || !reader.Get(device.m_Description))
+                {
+                    return false;
+                }
+                device.m_Volume = volume;
+                devices.push_back(std::move(device));
+            }
+            return true;
+        };
+        return decodeDevices(numberOfInputDevices, topology.m_InputDevices) &&
+               decodeDevices(numberOfOutputDevices, topology.m_OutputDevices);
+    }
+
+    bool DeviceCache::Load(Topology& topology)
+    {
+        int fd = open(m_Filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat fileStatus;
+        if ((fstat(fd, &fileStatus) < 0) || (fileStatus.st_size == 0))
+        {
+            close(fd);
+            return false;
+        }
+        size_t size = static_cast<size_t>(fileStatus.st_size);
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+
+        // an invalid file may decode partially, the caller's topology is only replaced by a complete one
+        Topology decoded;
+        bool valid = Decode(static_cast<const char*>(data), size, decoded);
+        if (valid)
+        {
+            topology = std::move(decoded);
+            m_Stored.assign(static_cast<const char*>(data), size);
+        }
+        else
+        {
+            PRINT_ERROR("DeviceCache::Load: ignoring invalid cache file %s", m_Filename.c_str());
+        }
+        munmap(data, size);
+        return valid;
+    }
+
+    //
+    // the new contents go to a temporary file that replaces the cache in one rename, a reader never
+    // sees a partially written file; the temporary file is unique, so processes sharing the cache do
+    // not write into each other's, and it is synced before the rename, so a crash cannot leave an
+    // empty cache behind
+    //
+    bool DeviceCache::Store(const Topology& topology)
+    {
+        std::string buffer;
+        Encode(topology, buffer);
+        if (buffer == m_Stored)
+        {
+            return true;
+        }
+
+        std::string temporaryFilename = m_Filename + ".XXXXXX";
+        int fd = mkostemp(&temporaryFilename[0], O_CLOEXEC);
+        if (fd < 0)
+        {
+            PRINT_ERROR("DeviceCache::Store: cannot create %s", temporaryFilename.c_str());
+            return false;
+        }
+        auto fail = [&]()
+        {
+            close(fd);
+            unlink(temporaryFilename.c_str());
+            return false;
+        };
+        if ((fchmod(fd, 0644) < 0) || (ftruncate(fd, static_cast<off_t>(buffer.size())) < 0))
+        {
+            return fail();
+        }
+        void* data = mmap(nullptr, buffer.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            return fail();
+        }
+        memcpy(data, buffer.data(), buffer.size());
+        munmap(data, buffer.size());
+        if (fsync(fd) < 0)
+        {
+            PRINT_ERROR("DeviceCache::Store: cannot sync %s", temporaryFilename.c_str());
+            return fail();
+        }
+        close(fd);
+
+        if (rename(temporaryFilename.c_str(), m_Filename.c_str()) < 0)
+        {
+            PRINT_ERROR("DeviceCache::Store: cannot replace %s", m_Filename.c_str());
+            unlink(temporaryFilename.c_str());
+            return false;
+        }
+        m_Stored = std::move(buffer);
+        return true;
+    }
+}
@@ -0,0 +1,70 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+namespace LibPAmanager
+{
+    //
+    // last known sinks and sources, kept in a small memory-mapped file so that
+    // the device lists can be shown before the sound server has answered
+    //
+    class DeviceCache
+    {
+    public:
+        struct Device
+        {
+            std::string m_Name;
+            std::string m_Description;
+            uint m_Volume;
+        };
+
+        struct Topology
+        {
+            std::vector<Device> m_InputDevices;
+            std::vector<Device> m_OutputDevices;
+            std::string m_DefaultInputDevice;  // name
+            std::string m_DefaultOutputDevice; // name
+        };
+
+    public:
+        void SetFile(const std::string& filename) { m_Filename = filename; }
+        bool IsEnabled() const { return !m_Filename.empty(); }
+
+        // leaves topology unchanged if the file is missing or invalid
+        bool Load(Topology& topology);
+        // writes only if the topology differs from what the file holds
+        bool Store(const Topology& topology);
+
+    private:
+        static void Encode(const Topology& topology, std::string& buffer);
+        static bool Decode(const char* data, size_t size, Topology& topology);
+
+    private:
+        std::string m_Filename;
+        std::string m_Stored; // encoded file contents
+    };
+}
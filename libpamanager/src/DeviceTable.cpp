@@ -0,0 +1,281 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include "DeviceTable.h"
+
+namespace LibPAmanager
+{
+    //
+    // add a device or return the existing record for this PA index, with the description updated
+    //
+    DeviceRecord* DeviceTable::Add(uint paIndex, const char* name, const char* description)
+    {
+        // a refresh of a known device interns nothing unless its description changed
+        std::string_view descriptionView(description ? description : "");
+        auto existing = m_IndexMap.find(paIndex);
+        if (existing != m_IndexMap.end())
+        {
+            SetDescription(existing->second, descriptionView);
+            return &m_Slots[existing->second].m_Record;
+        }
+
+        // a device of the previous connection
+        InternedString internedName(name ? name : "");
+        auto detached = m_NameMap.find(internedName);
+        if ((detached != m_NameMap.end()) && (m_Slots[detached->second].m_Record.m_PAIndex == PA_INVALID_INDEX))
+        {
+            uint32_t slotIndex = detached->second;
+            auto& record = m_Slots[slotIndex].m_Record;
+            record.m_PAIndex = paIndex;
+            SetDescription(slotIndex, descriptionView);
+            record.m_VolumeRequestPending = false;
+            record.m_VolumeInFlight = false;
+            m_IndexMap[paIndex] = slotIndex;
+            return &record;
+        }
+
+        uint32_t slotIndex;
+        if (!m_FreeSlots.empty())
+        {
+            slotIndex = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+        }
+        else
+        {
+            slotIndex = static_cast<uint32_t>(m_Slots.size());
+            m_Slots.push_back(Slot());
+            m_Slots.back().m_Record.m_Handle = {slotIndex, 0};
+        }
+
+        auto& slot = m_Slots[slotIndex];
+        slot.m_Used = true;
+        slot.m_Record.m_Handle.m_Slot = slotIndex;
+        slot.m_Record.m_PAIndex = paIndex;
+        slot.m_Record.m_Name = internedName;
+        slot.m_Record.m_Description = InternedString(descriptionView);
+        slot.m_Record.m_Volume = 0;
+        slot.m_Record.m_Monitor = PA_INVALID_INDEX;
+        slot.m_Record.m_Card = PA_INVALID_INDEX;
+        slot.m_Record.m_ChannelMap = {};
+        slot.m_Record.m_CVolume = {};
+        slot.m_Record.m_VolumeRequest = {};
+        slot.m_Record.m_VolumeRequestPending = false;
+        slot.m_Record.m_VolumeInFlight = false;
+        slot.m_Record.m_AddedGeneration = m_Generation + 1;
+
+        m_IndexMap[paIndex] = slotIndex;
+        m_NameMap[slot.m_Record.m_Name] = slotIndex;
+        m_DescriptionMap.emplace(slot.m_Record.m_Description, slotIndex);
+        MarkChanged(slotIndex);
+        return &slot.m_Record;
+    }
+
+    void DeviceTable::SetDescription(uint32_t slotIndex, std::string_view description)
+    {
+        auto& record = m_Slots[slotIndex].m_Record;
+        if (record.m_Description != description)
+        {
+            EraseDescription(slotIndex);
+            record.m_Description = InternedString(description);
+            m_DescriptionMap.emplace(record.m_Description, slotIndex);
+            MarkChanged(slotIndex);
+        }
+    }
+
+    void DeviceTable::MarkChanged(uint32_t slotIndex)
+    {
+        m_Generation++;
+        auto& slot = m_Slots[slotIndex];
+        if (!slot.m_Changed)
+        {
+            slot.m_Changed = true;
+            m_ChangedSlots.push_back(slotIndex);
+        }
+    }
+
+    //
+    // a slot in m_ChangedSlots holds a device added since the last report, a modified one,
+    // or none (removed); a removed slot that got reused holds an added device
+    //
+    DeviceListChange DeviceTable::TakeChanges()
+    {
+        DeviceListChange change;
+        change.m_PreviousGeneration = m_ReportedGeneration;
+        change.m_Generation = m_Generation;
+        change.m_Reset = false;
+        for (auto slotIndex : m_ChangedSlots)
+        {
+            auto& slot = m_Slots[slotIndex];
+            slot.m_Changed = false;
+            if (!slot.m_Used)
+            {
+                continue;
+            }
+            if (slot.m_Record.m_AddedGeneration > m_ReportedGeneration)
+            {
+                change.m_Added.push_back(slot.m_Record);
+            }
+            else
+            {
+                change.m_Modified.push_back(slot.m_Record);
+            }
+        }
+        m_ChangedSlots.clear();
+        change.m_Removed = std::move(m_Removed);
+        m_Removed.clear();
+        m_ReportedGeneration = m_Generation;
+        return change;
+    }
+
+    bool DeviceTable::Remove(uint paIndex)
+    {
+        auto existing = m_IndexMap.find(paIndex);
+        if (existing == m_IndexMap.end())
+        {
+            return false;
+        }
+        uint32_t slotIndex = existing->second;
+        m_IndexMap.erase(existing);
+        Release(slotIndex);
+        return true;
+    }
+
+    void DeviceTable::Release(uint32_t slotIndex)
+    {
+        auto& slot = m_Slots[slotIndex];
+        m_NameMap.erase(slot.m_Record.m_Name);
+        EraseDescription(slotIndex);
+
+        m_Generation++;
+        if (slot.m_Record.m_AddedGeneration <= m_ReportedGeneration)
+        {
+            m_Removed.push_back(slot.m_Record);
+        }
+
+        // invalidate all outstanding handles to this slot
+        slot.m_Used = false;
+        slot.m_Record.m_Handle.m_Generation++;
+        slot.m_Record.m_Name = InternedString();
+        slot.m_Record.m_Description = InternedString();
+        m_FreeSlots.push_back(slotIndex);
+    }
+
+    void DeviceTable::EraseDescription(uint32_t slotIndex)
+    {
+        auto range = m_DescriptionMap.equal_range(m_Slots[slotIndex].m_Record.m_Description);
+        for (auto iterator = range.first; iterator != range.second; ++iterator)
+        {
+            if (iterator->second == slotIndex)
+            {
+                m_DescriptionMap.erase(iterator);
+                break;
+            }
+        }
+    }
+
+    void DeviceTable::Detach()
+    {
+        for (auto& slot : m_Slots)
+        {
+            if (slot.m_Used)
+            {
+                slot.m_Record.m_PAIndex = PA_INVALID_INDEX;
+            }
+        }
+        m_IndexMap.clear();
+    }
+
+    std::vector<DeviceHandle> DeviceTable::RemoveDetached()
+    {
+        std::vector<DeviceHandle> removed;
+        for (uint32_t slotIndex = 0; slotIndex < m_Slots.size(); slotIndex++)
+        {
+            auto& slot = m_Slots[slotIndex];
+            if (slot.m_Used && (slot.m_Record.m_PAIndex == PA_INVALID_INDEX))
+            {
+                removed.push_back(slot.m_Record.m_Handle);
+                Release(slotIndex);
+            }
+        }
+        return removed;
+    }
+
+    DeviceRecord* DeviceTable::Get(DeviceHandle handle)
+    {
+        if ((handle.m_Slot >= m_Slots.size()) || !m_Slots[handle.m_Slot].m_Used ||
+            (m_Slots[handle.m_Slot].m_Record.m_Handle.m_Generation != handle.m_Generation))
+        {
+            return nullptr;
+        }
+        return &m_Slots[handle.m_Slot].m_Record;
+    }
+
+    const DeviceRecord* DeviceTable::Get(DeviceHandle handle) const
+    {
+        return const_cast<DeviceTable*>(this)->Get(handle);
+    }
+
+    DeviceRecord* DeviceTable::FindByIndex(uint paIndex)
+    {
+        auto iterator = m_IndexMap.find(paIndex);
+        return iterator == m_IndexMap.end() ? nullptr : &m_Slots[iterator->second].m_Record;
+    }
+
+    DeviceRecord* DeviceTable::FindByName(InternedString name)
+    {
+        auto iterator = m_NameMap.find(name);
+        return iterator == m_NameMap.end() ? nullptr : &m_Slots[iterator->second].m_Record;
+    }
+
+    // a string that was never interned cannot be the name or description of a device
+    DeviceRecord* DeviceTable::FindByName(std::string_view name)
+    {
+        InternedString interned;
+        return InternedString::Find(name, interned) ? FindByName(interned) : nullptr;
+    }
+
+    DeviceRecord* DeviceTable::FindByDescription(std::string_view description)
+    {
+        InternedString interned;
+        if (!InternedString::Find(description, interned))
+        {
+            return nullptr;
+        }
+        auto iterator = m_DescriptionMap.find(interned);
+        return iterator == m_DescriptionMap.end() ? nullptr : &m_Slots[iterator->second].m_Record;
+    }
+
+    DeviceHandle DeviceTable::Next(DeviceHandle handle) const
+    {
+        size_t numberOfSlots = m_Slots.size();
+        size_t start = handle.m_Slot < numberOfSlots ? handle.m_Slot + 1 : 0;
+        for (size_t count = 0; count < numberOfSlots; count++)
+        {
+            auto& slot = m_Slots[(start + count) % numberOfSlots];
+            if (slot.m_Used)
+            {
+                return slot.m_Record.m_Handle;
+            }
+        }
+        return DeviceHandle();
+    }
+}
@@ -0,0 +1,173 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <sys/types.h>
+#include <pulse/pulseaudio.h>
+
+#include "InternedString.h"
+
+namespace LibPAmanager
+{
+    //
+    // stable reference to a device, stays valid until the device is removed;
+    // a slot that gets reused by another device carries a new generation
+    //
+    struct DeviceHandle
+    {
+        static constexpr uint32_t INVALID_SLOT = 0xffffffff;
+
+        uint32_t m_Slot = INVALID_SLOT;
+        uint32_t m_Generation = 0;
+
+        bool IsValid() const { return m_Slot != INVALID_SLOT; }
+        bool operator==(const DeviceHandle& other) const
+        {
+            return (m_Slot == other.m_Slot) && (m_Generation == other.m_Generation);
+        }
+        bool operator!=(const DeviceHandle& other) const { return !(*this == other); }
+    };
+
+    struct DeviceRecord
+    {
+        DeviceHandle m_Handle;
+        uint m_PAIndex;
+        InternedString m_Name;        // copying a record copies no characters
+        InternedString m_Description;
+        uint m_Volume;
+        uint m_Monitor; // sinks: PA index of the monitor source; sources: the sink they monitor, or PA_INVALID_INDEX
+        uint m_Card;    // PA index of the card, PA_INVALID_INDEX if none
+
+        // cached from the last introspection, so a volume change needs no extra query
+        pa_channel_map m_ChannelMap;
+        pa_cvolume m_CVolume;
+
+        // latest-wins volume requests, at most one set operation in flight
+        pa_cvolume m_VolumeRequest;
+        bool m_VolumeRequestPending;
+        bool m_VolumeInFlight;
+
+        uint64_t m_AddedGeneration; // of the device table when the record was added
+    };
+
+    //
+    // payload of the list changed events: what changed since the previous event of the same list;
+    // a receiver that sees m_PreviousGeneration differ from the m_Generation of the last event it
+    // processed has missed one (e.g. a full event queue) and has to re-read the whole list
+    //
+    struct DeviceListChange
+    {
+        std::vector<DeviceRecord> m_Added;
+        std::vector<DeviceRecord> m_Removed;  // as last seen, the handles are no longer valid
+        std::vector<DeviceRecord> m_Modified; // the description changed
+        uint64_t m_PreviousGeneration;
+        uint64_t m_Generation;
+        bool m_Reset; // devices shown from the device cache are gone, they have no handles to report
+
+        bool IsEmpty() const { return m_Added.empty() && m_Removed.empty() && m_Modified.empty() && !m_Reset; }
+    };
+
+    //
+    // sinks or sources, stored in a slot array with hash indexes on PA index and on the ids of the
+    // interned names and descriptions
+    //
+    class DeviceTable
+    {
+    public:
+        DeviceRecord* Add(uint paIndex, const char* name, const char* description);
+        bool Remove(uint paIndex);
+
+        // for a new server connection: the PA indices are dropped, Add() finds the detached
+        // records by name and the devices keep their handles; RemoveDetached() removes the
+        // records that were not found again and returns their (now invalid) handles
+        void Detach();
+        std::vector<DeviceHandle> RemoveDetached();
+
+        DeviceRecord* Get(DeviceHandle handle);
+        const DeviceRecord* Get(DeviceHandle handle) const;
+        DeviceRecord* FindByIndex(uint paIndex);
+        DeviceRecord* FindByName(InternedString name);
+        DeviceRecord* FindByName(std::string_view name);
+        DeviceRecord* FindByDescription(std::string_view description);
+
+        // next device in slot order after handle, wraps around
+        DeviceHandle Next(DeviceHandle handle) const;
+        // devices in the table, detached ones included
+        size_t Size() const { return m_Slots.size() - m_FreeSlots.size(); }
+
+        // every add, remove and description change advances the generation; TakeChanges() returns
+        // the changes since its previous call in O(changes), a device added and removed in between
+        // is not reported
+        uint64_t GetGeneration() const { return m_Generation; }
+        DeviceListChange TakeChanges();
+
+        template<typename Function> void ForEach(Function function)
+        {
+            for (auto& slot : m_Slots)
+            {
+                if (slot.m_Used)
+                {
+                    function(slot.m_Record);
+                }
+            }
+        }
+
+        template<typename Function> void ForEach(Function function) const
+        {
+            for (auto& slot : m_Slots)
+            {
+                if (slot.m_Used)
+                {
+                    function(slot.m_Record);
+                }
+            }
+        }
+
+    private:
+        struct Slot
+        {
+            DeviceRecord m_Record;
+            bool m_Used;
+            bool m_Changed; // listed in m_ChangedSlots
+        };
+
+        void Release(uint32_t slotIndex);
+        void EraseDescription(uint32_t slotIndex);
+        void SetDescription(uint32_t slotIndex, std::string_view description);
+        void MarkChanged(uint32_t slotIndex);
+
+        std::vector<Slot> m_Slots;
+        std::vector<uint32_t> m_FreeSlots;
+        std::unordered_map<uint, uint32_t> m_IndexMap;
+        std::unordered_map<InternedString, uint32_t> m_NameMap;
+        std::unordered_multimap<InternedString, uint32_t> m_DescriptionMap;
+
+        uint64_t m_Generation = 0;
+        uint64_t m_ReportedGeneration = 0;
+        std::vector<uint32_t> m_ChangedSlots;
+        std::vector<DeviceRecord> m_Removed; // reported before, removed since
+    };
+}
@@ -0,0 +1,201 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <chrono>
+
+#include "libpamanager.h"
+#include "EventLoop.h"
+
+namespace LibPAmanager
+{
+    EventLoop::EventLoop(Backend backend) : m_Backend(backend)
+    {
+        // the mainloop is created before the thread is launched,
+        // so that application threads can always wake it up
+        if (m_Backend == Backend::THREADED_MAINLOOP)
+        {
+            m_ThreadedMainloop = pa_threaded_mainloop_new();
+            pa_threaded_mainloop_set_name(m_ThreadedMainloop, "pamanager");
+            m_MainloopAPI = pa_threaded_mainloop_get_api(m_ThreadedMainloop);
+        }
+        else
+        {
+            m_Mainloop = pa_mainloop_new();
+            m_MainloopAPI = pa_mainloop_get_api(m_Mainloop);
+        }
+    }
+
+    EventLoop::~EventLoop()
+    {
+        if (m_ThreadedMainloop)
+        {
+            if (m_Running)
+            {
+                pa_threaded_mainloop_stop(m_ThreadedMainloop);
+            }
+            pa_threaded_mainloop_free(m_ThreadedMainloop);
+            return;
+        }
+
+        if (m_Thread.joinable())
+        {
+            Post([this]() { pa_mainloop_quit(m_Mainloop, 0); });
+            m_Thread.join();
+        }
+        pa_mainloop_free(m_Mainloop);
+    }
+
+    std::shared_ptr<EventLoop> EventLoop::GetShared(Backend backend)
+    {
+        static std::mutex sharedMutex;
+        static std::shared_ptr<EventLoop> sharedEventLoops[2];
+
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        auto& eventLoop = sharedEventLoops[backend == Backend::THREADED_MAINLOOP ? 1 : 0];
+        if (!eventLoop)
+        {
+            eventLoop = std::make_shared<EventLoop>(backend);
+        }
+        return eventLoop;
+    }
+
+    void EventLoop::Start()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_CommandQueueMutex);
+            if (m_Running)
+            {
+                return;
+            }
+            m_Running = true;
+        }
+
+        if (m_Backend == Backend::THREADED_MAINLOOP)
+        {
+            // libpulse runs its own thread, no polling thread on our side
+            pa_threaded_mainloop_lock(m_ThreadedMainloop);
+            ProcessCommands(); // requests posted before Start()
+            pa_threaded_mainloop_unlock(m_ThreadedMainloop);
+
+            if (pa_threaded_mainloop_start(m_ThreadedMainloop) < 0)
+            {
+                PRINT_ERROR("EventLoop::Start: pa_threaded_mainloop_start() failed.");
+            }
+            return;
+        }
+
+        m_Thread = std::thread([this]() { Run(); });
+    }
+
+    void EventLoop::Run()
+    {
+        ProcessCommands();
+        while (true)
+        {
+            // pa_mainloop_iterate() in its steps: block in poll() until PulseAudio or Post() wakes us up
+            if ((pa_mainloop_prepare(m_Mainloop, -1) < 0) || (pa_mainloop_poll(m_Mainloop) < 0))
+            {
+                // pa_mainloop_quit() from the destructor, or a failure
+                break;
+            }
+
+            // an iteration is the work between two polls
+            auto startTime = std::chrono::steady_clock::now();
+            if (pa_mainloop_dispatch(m_Mainloop) < 0)
+            {
+                break;
+            }
+            ProcessCommands();
+            m_IterationTime.Record(startTime);
+        }
+    }
+
+    //
+    // queue a request from an application thread for the event loop thread,
+    // or execute it under the mainloop lock for the threaded backend
+    //
+    void EventLoop::Post(std::function<void()> command)
+    {
+        if (m_ThreadedMainloop)
+        {
+            if (pa_threaded_mainloop_in_thread(m_ThreadedMainloop))
+            {
+                // called from an event callback, the lock is already held
+                command();
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_CommandQueueMutex);
+                if (!m_Running)
+                {
+                    m_CommandQueue.push_back(std::move(command));
+                    return;
+                }
+            }
+
+            pa_threaded_mainloop_lock(m_ThreadedMainloop);
+            auto startTime = std::chrono::steady_clock::now();
+            command();
+            auto endTime = std::chrono::steady_clock::now();
+            pa_threaded_mainloop_unlock(m_ThreadedMainloop);
+
+            uint64_t holdTime = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+            m_LockCount.fetch_add(1, std::memory_order_relaxed);
+            m_TotalLockHoldTimeNs.fetch_add(holdTime, std::memory_order_relaxed);
+            uint64_t maxHoldTime = m_MaxLockHoldTimeNs.load(std::memory_order_relaxed);
+            while ((holdTime > maxHoldTime) &&
+                   !m_MaxLockHoldTimeNs.compare_exchange_weak(maxHoldTime, holdTime, std::memory_order_relaxed))
+            {
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_CommandQueueMutex);
+            m_CommandQueue.push_back(std::move(command));
+        }
+        pa_mainloop_wakeup(m_Mainloop);
+    }
+
+    void EventLoop::ProcessCommands()
+    {
+        std::vector<std::function<void()>> commands;
+        {
+            std::lock_guard<std::mutex> lock(m_CommandQueueMutex);
+            commands.swap(m_CommandQueue);
+        }
+        for (auto& command : commands)
+        {
+            command();
+        }
+    }
+
+    EventLoop::LockStatistics EventLoop::GetLockStatistics() const
+    {
+        LockStatistics statistics;
+        statistics.m_LockCount = m_LockCount.load(std::memory_order_relaxed);
+        statistics.m_TotalHoldTimeNs = m_TotalLockHoldTimeNs.load(std::memory_order_relaxed);
+        statistics.m_MaxHoldTimeNs = m_MaxLockHoldTimeNs.load(std::memory_order_relaxed);
+        return statistics;
+    }
+}
@@ -0,0 +1,98 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <pulse/pulseaudio.h>
+
+#include "Statistics.h"
+
+namespace LibPAmanager
+{
+    //
+    // one PulseAudio mainloop and the thread that drives it;
+    // any number of device managers can share an event loop
+    //
+    class EventLoop
+    {
+    public:
+        enum class Backend
+        {
+            MAINLOOP,          // pa_mainloop driven by a thread owned by the event loop
+            THREADED_MAINLOOP  // pa_threaded_mainloop, posted commands take the mainloop lock
+        };
+
+        struct LockStatistics
+        {
+            uint64_t m_LockCount;
+            uint64_t m_TotalHoldTimeNs;
+            uint64_t m_MaxHoldTimeNs;
+        };
+
+    public:
+        explicit EventLoop(Backend backend = Backend::MAINLOOP);
+        ~EventLoop(); // do not destroy the event loop from its own thread
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        // process-wide event loop per backend, used by managers that were not given one
+        static std::shared_ptr<EventLoop> GetShared(Backend backend);
+
+        void Start(); // starts the thread on the first call
+        void Post(std::function<void()> command);
+
+        Backend GetBackend() const { return m_Backend; }
+        pa_mainloop_api* GetAPI() const { return m_MainloopAPI; }
+        LockStatistics GetLockStatistics() const;
+        // work done per mainloop iteration, without the time blocked in poll(); MAINLOOP backend only
+        LatencyStatistics GetIterationStatistics() const { return m_IterationTime.GetStatistics(); }
+
+    private:
+        void Run();
+        void ProcessCommands();
+
+    private:
+        Backend m_Backend;
+        pa_mainloop* m_Mainloop = nullptr;
+        pa_threaded_mainloop* m_ThreadedMainloop = nullptr;
+        pa_mainloop_api* m_MainloopAPI = nullptr;
+        std::thread m_Thread;
+        bool m_Running = false;
+
+        // requests from application threads, executed on the event loop thread
+        std::mutex m_CommandQueueMutex;
+        std::vector<std::function<void()>> m_CommandQueue;
+
+        // time spent holding the threaded mainloop lock
+        std::atomic<uint64_t> m_LockCount{0};
+        std::atomic<uint64_t> m_TotalLockHoldTimeNs{0};
+        std::atomic<uint64_t> m_MaxLockHoldTimeNs{0};
+
+        LatencyHistogram m_IterationTime;
+    };
+}
@@ -0,0 +1,145 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "InternedString.h"
+
+namespace LibPAmanager
+{
+    namespace
+    {
+        //
+        // the strings are copied into chunks that are never released; the lock is taken to intern or to
+        // look up by value, the registry does that only for new devices and changed descriptions,
+        // readers hold views and never need it
+        //
+        class StringPool
+        {
+        public:
+            static StringPool& Get()
+            {
+                // not destroyed at exit, views may still be in use on other threads
+                static StringPool* pool = new StringPool();
+                return *pool;
+            }
+
+            std::pair<uint32_t, std::string_view> Intern(std::string_view string)
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                auto existing = m_Ids.find(string);
+                if (existing != m_Ids.end())
+                {
+                    return {existing->second, existing->first};
+                }
+
+                size_t size = string.size() + 1;
+                char* characters;
+                if (size > CHUNK_SIZE / 4)
+                {
+                    m_Chunks.push_back(std::make_unique<char[]>(size));
+                    characters = m_Chunks.back().get();
+                }
+                else
+                {
+                    if (m_ChunkUsed + size > CHUNK_SIZE)
+                    {
+                        m_Chunks.push_back(std::make_unique<char[]>(CHUNK_SIZE));
+                        m_Chunk = m_Chunks.back().get();
+                        m_ChunkUsed = 0;
+                    }
+                    characters = m_Chunk + m_ChunkUsed;
+                    m_ChunkUsed += size;
+                }
+                memcpy(characters, string.data(), string.size());
+                characters[string.size()] = '\0';
+
+                std::string_view view(characters, string.size());
+                uint32_t id = static_cast<uint32_t>(m_Ids.size()) + 1; // 0 is the empty string
+                m_Ids.emplace(view, id);
+                return {id, view};
+            }
+
+            bool Find(std::string_view string, std::pair<uint32_t, std::string_view>& interned)
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                auto existing = m_Ids.find(string);
+                if (existing == m_Ids.end())
+                {
+                    return false;
+                }
+                interned = {existing->second, existing->first};
+                return true;
+            }
+
+            size_t Size()
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                return m_Ids.size();
+            }
+
+        private:
+            static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+            std::mutex m_Mutex;
+            std::unordered_map<std::string_view, uint32_t> m_Ids;
+            std::vector<std::unique_ptr<char[]>> m_Chunks;
+            char* m_Chunk = nullptr;
+            size_t m_ChunkUsed = CHUNK_SIZE;
+        };
+    }
+
+    InternedString::InternedString(std::string_view string)
+    {
+        if (!string.empty())
+        {
+            auto interned = StringPool::Get().Intern(string);
+            m_Id = interned.first;
+            m_View = interned.second;
+        }
+    }
+
+    bool InternedString::Find(std::string_view string, InternedString& interned)
+    {
+        if (string.empty())
+        {
+            interned = InternedString();
+            return true;
+        }
+        std::pair<uint32_t, std::string_view> found;
+        if (!StringPool::Get().Find(string, found))
+        {
+            return false;
+        }
+        interned = InternedString(found.first, found.second);
+        return true;
+    }
+
+    size_t InternedString::GetPoolSize()
+    {
+        return StringPool::Get().Size();
+    }
+}
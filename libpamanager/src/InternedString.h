@@ -0,0 +1,82 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+namespace LibPAmanager
+{
+    //
+    // a string of the process-wide intern pool, meant for device names and descriptions: equal
+    // strings share one id and one copy, so comparing and hashing is on the id; the characters are
+    // NUL terminated and never moved or released, so a view into them stays valid on any thread.
+    // Nothing is reclaimed: the pool grows by every distinct string interned during the lifetime of
+    // the process, e.g. by the name and description of each Bluetooth or USB device ever seen (a
+    // device that comes back has the same strings); GetPoolSize() tells how many there are
+    //
+    class InternedString
+    {
+    public:
+        InternedString() = default; // the empty string
+        explicit InternedString(std::string_view string);
+
+        // the interned string equal to string, without adding it to the pool
+        static bool Find(std::string_view string, InternedString& interned);
+        static size_t GetPoolSize(); // distinct strings
+
+        uint32_t GetId() const { return m_Id; }
+        std::string_view View() const { return m_View; }
+        const char* c_str() const { return m_View.data(); }
+        bool empty() const { return m_View.empty(); }
+        operator std::string_view() const { return m_View; }
+
+        friend bool operator==(const InternedString& left, const InternedString& right)
+        {
+            return left.m_Id == right.m_Id;
+        }
+        friend bool operator!=(const InternedString& left, const InternedString& right)
+        {
+            return left.m_Id != right.m_Id;
+        }
+        friend bool operator==(const InternedString& left, std::string_view right) { return left.m_View == right; }
+        friend bool operator!=(const InternedString& left, std::string_view right) { return left.m_View != right; }
+        friend bool operator==(std::string_view left, const InternedString& right) { return left == right.m_View; }
+        friend bool operator!=(std::string_view left, const InternedString& right) { return left != right.m_View; }
+
+    private:
+        InternedString(uint32_t id, std::string_view view) : m_Id(id), m_View(view) {}
+
+        uint32_t m_Id = 0;
+        std::string_view m_View{"", 0};
+    };
+}
+
+namespace std
+{
+    template<> struct hash<LibPAmanager::InternedString>
+    {
+        size_t operator()(const LibPAmanager::InternedString& string) const { return string.GetId(); }
+    };
+}
@@ -0,0 +1,75 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <cmath>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "LevelMeter.h"
+
+namespace LibPAmanager
+{
+    namespace
+    {
+        // the tail is done one sample at a time
+        float Reduce(const float* samples, size_t count)
+        {
+            size_t sample = 0;
+            float peak = 0.0f;
+#if defined(__SSE2__)
+            const __m128 signMask = _mm_set1_ps(-0.0f);
+            __m128 peaks = _mm_setzero_ps();
+            for (; sample + 4 <= count; sample += 4)
+            {
+                peaks = _mm_max_ps(peaks, _mm_andnot_ps(signMask, _mm_loadu_ps(samples + sample)));
+            }
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, peaks);
+            peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+            for (; sample < count; sample++)
+            {
+                peak = std::max(peak, std::fabs(samples[sample]));
+            }
+            return peak;
+        }
+    }
+
+    void LevelAccumulator::Add(const float* samples, size_t count)
+    {
+        m_Peak = std::max(m_Peak, Reduce(samples, count));
+        m_Samples += count;
+    }
+
+    Level LevelAccumulator::GetLevel() const
+    {
+        return {m_Samples ? m_Peak : 0.0f};
+    }
+
+    void LevelAccumulator::Reset()
+    {
+        m_Peak = 0.0f;
+        m_Samples = 0;
+    }
+}
@@ -0,0 +1,52 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <cstddef>
+
+namespace LibPAmanager
+{
+    // linear amplitude, 0.0 is silence, 1.0 full scale (exceeded when clipping); the streams deliver
+    // fragment peaks detected by the server, not the signal, so there is no RMS to derive from them
+    struct Level
+    {
+        float m_Peak;
+    };
+
+    //
+    // peak over the blocks of fragment peaks received during one publishing interval;
+    // the blocks are reduced four samples at a time (SSE2 on x86-64)
+    //
+    class LevelAccumulator
+    {
+    public:
+        void Add(const float* samples, size_t count);
+        bool IsEmpty() const { return !m_Samples; }
+        Level GetLevel() const;
+        void Reset();
+
+    private:
+        float m_Peak = 0.0f;
+        size_t m_Samples = 0;
+    };
+}
@@ -0,0 +1,250 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "colorTTY.h"
+#include "Logger.h"
+
+namespace LibPAmanager
+{
+    #ifdef VERBOSE
+        std::atomic<LogLevel> Logger::m_Level{LogLevel::TRACE};
+    #else
+        std::atomic<LogLevel> Logger::m_Level{LogLevel::ERROR};
+    #endif
+
+    namespace
+    {
+        constexpr size_t LOG_QUEUE_SIZE = 1024; // power of two
+        constexpr size_t LOG_MESSAGE_SIZE = 240;
+
+        //
+        // bounded multi-producer/single-consumer queue of fixed-size messages;
+        // each slot's sequence number tells whether it is free, being written or ready
+        //
+        class LogQueue
+        {
+        public:
+            LogQueue()
+            {
+                for (size_t position = 0; position < LOG_QUEUE_SIZE; position++)
+                {
+                    m_Slots[position].m_Sequence.store(position, std::memory_order_relaxed);
+                }
+                std::thread([this]() { Run(); }).detach();
+                std::atexit([]() { Logger::Flush(); });
+            }
+
+            void Push(LogLevel level, const char* format, va_list arguments)
+            {
+                Slot* slot;
+                size_t position = m_Enqueue.load(std::memory_order_relaxed);
+                while (true)
+                {
+                    slot = &m_Slots[position & (LOG_QUEUE_SIZE - 1)];
+                    size_t sequence = slot->m_Sequence.load(std::memory_order_acquire);
+                    auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                    if (difference == 0)
+                    {
+                        if (m_Enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        {
+                            break;
+                        }
+                    }
+                    else if (difference < 0)
+                    {
+                        // full, the writer is behind
+                        m_Dropped.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    else
+                    {
+                        position = m_Enqueue.load(std::memory_order_relaxed);
+                    }
+                }
+
+                slot->m_Level = level;
+                vsnprintf(slot->m_Text, LOG_MESSAGE_SIZE, format, arguments);
+                slot->m_Sequence.store(position + 1, std::memory_order_release);
+
+                // the writer only needs a notification when it went to sleep on an empty queue
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (m_Sleeping.load(std::memory_order_relaxed))
+                {
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    m_Condition.notify_one();
+                }
+            }
+
+            void Flush()
+            {
+                std::lock_guard<std::mutex> lock(m_WriteMutex);
+                Drain();
+            }
+
+            uint64_t GetDropped() const
+            {
+                return m_DroppedTotal.load(std::memory_order_relaxed) + m_Dropped.load(std::memory_order_relaxed);
+            }
+
+        private:
+            struct Slot
+            {
+                std::atomic<size_t> m_Sequence;
+                LogLevel m_Level;
+                char m_Text[LOG_MESSAGE_SIZE];
+            };
+
+            bool IsReady() const
+            {
+                auto& slot = m_Slots[m_Dequeue & (LOG_QUEUE_SIZE - 1)];
+                return slot.m_Sequence.load(std::memory_order_acquire) == m_Dequeue + 1;
+            }
+
+            void Run()
+            {
+                while (true)
+                {
+                    {
+                        std::unique_lock<std::mutex> lock(m_Mutex);
+                        m_Sleeping.store(true, std::memory_order_relaxed);
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+                        m_Condition.wait(lock, [this]()
+                        {
+                            std::lock_guard<std::mutex> writeLock(m_WriteMutex);
+                            return IsReady();
+                        });
+                        m_Sleeping.store(false, std::memory_order_relaxed);
+                    }
+                    Flush();
+                }
+            }
+
+            // consumer side, called with m_WriteMutex held
+            void Drain()
+            {
+                bool written = false;
+                while (IsReady())
+                {
+                    auto& slot = m_Slots[m_Dequeue & (LOG_QUEUE_SIZE - 1)];
+                    Print(slot.m_Level, slot.m_Text);
+                    slot.m_Sequence.store(m_Dequeue + LOG_QUEUE_SIZE, std::memory_order_release);
+                    m_Dequeue++;
+                    written = true;
+                }
+
+                uint64_t dropped = m_Dropped.exchange(0, std::memory_order_relaxed);
+                if (dropped)
+                {
+                    m_DroppedTotal.fetch_add(dropped, std::memory_order_relaxed);
+                    fprintf(stderr, "libpamanager: %llu log messages dropped\n",
+                            static_cast<unsigned long long>(dropped));
+                }
+                if (written)
+                {
+                    fflush(stdout);
+                }
+            }
+
+            static void Print(LogLevel level, const char* text)
+            {
+                // LOG_MESSAGE callers used to pass printf format strings with their own line feed
+                size_t length = strlen(text);
+                const char* lineFeed = (length && (text[length - 1] == '\n')) ? "" : "\n";
+                switch (level)
+                {
+                    case LogLevel::ERROR:
+                        fprintf(stderr, "%s%s", text, lineFeed);
+                        break;
+                    case LogLevel::MESSAGE:
+                        fprintf(stdout, "%s%s", text, lineFeed);
+                        break;
+                    default:
+                        fprintf(stdout, "\033[%dm%s\033[%dm%s", GetColor(level), text, Color::FG_DEFAULT, lineFeed);
+                        break;
+                }
+            }
+
+            static int GetColor(LogLevel level)
+            {
+                switch (level)
+                {
+                    case LogLevel::TRACE:
+                        return Color::FG_BLUE;
+                    case LogLevel::INFO:
+                        return Color::FG_GREEN;
+                    case LogLevel::WARN:
+                        return Color::FG_RED;
+                    case LogLevel::CRITICAL:
+                        return Color::FG_YELLOW;
+                    default:
+                        return Color::FG_DEFAULT;
+                }
+            }
+
+            Slot m_Slots[LOG_QUEUE_SIZE];
+
+            // producers and the writer on separate cache lines
+            alignas(64) std::atomic<size_t> m_Enqueue{0};
+            std::atomic<uint64_t> m_Dropped{0};
+            alignas(64) size_t m_Dequeue = 0;
+            std::atomic<uint64_t> m_DroppedTotal{0};
+
+            std::atomic<bool> m_Sleeping{false};
+            std::mutex m_Mutex;
+            std::condition_variable m_Condition;
+            std::mutex m_WriteMutex; // the writer thread and Flush()
+        };
+
+        // never destroyed, other threads may still log during exit
+        LogQueue& GetLogQueue()
+        {
+            static LogQueue* logQueue = new LogQueue();
+            return *logQueue;
+        }
+    }
+
+    void Logger::Write(LogLevel level, const char* format, ...)
+    {
+        va_list arguments;
+        va_start(arguments, format);
+        GetLogQueue().Push(level, format, arguments);
+        va_end(arguments);
+    }
+
+    void Logger::Flush()
+    {
+        GetLogQueue().Flush();
+    }
+
+    uint64_t Logger::GetDroppedMessages()
+    {
+        return GetLogQueue().GetDropped();
+    }
+}
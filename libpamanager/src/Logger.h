@@ -0,0 +1,89 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace LibPAmanager
+{
+    enum class LogLevel : int
+    {
+        TRACE,
+        MESSAGE,
+        INFO,
+        WARN,
+        CRITICAL,
+        ERROR,
+        OFF
+    };
+
+    //
+    // asynchronous logger: a log call formats into a preallocated lock-free ring buffer,
+    // a background thread writes to stdout (stderr for errors); when the buffer is full
+    // messages are dropped and counted instead of blocking the caller
+    //
+    class Logger
+    {
+    public:
+        // runtime level, TRACE in verbose builds, ERROR otherwise
+        static void SetLevel(LogLevel level) { m_Level.store(level, std::memory_order_relaxed); }
+        static LogLevel GetLevel() { return m_Level.load(std::memory_order_relaxed); }
+        static bool IsEnabled(LogLevel level) { return level >= m_Level.load(std::memory_order_relaxed); }
+
+        static void Write(LogLevel level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+        // blocks until all queued messages are written, also called at exit
+        static void Flush();
+        static uint64_t GetDroppedMessages();
+
+    private:
+        static std::atomic<LogLevel> m_Level;
+    };
+}
+
+//
+// compile-time level: calls below it are removed, e.g. -DLIBPAMANAGER_LOG_LEVEL=5 keeps errors only;
+// by default all calls are compiled in and filtered at runtime
+//
+#ifndef LIBPAMANAGER_LOG_LEVEL
+    #define LIBPAMANAGER_LOG_LEVEL 0
+#endif
+
+// the arguments are only evaluated if the level is enabled
+#define LIBPAMANAGER_LOG(level, ...)                                                                          \
+    do                                                                                                        \
+    {                                                                                                         \
+        if ((static_cast<int>(level) >= LIBPAMANAGER_LOG_LEVEL) && LibPAmanager::Logger::IsEnabled(level))    \
+        {                                                                                                     \
+            LibPAmanager::Logger::Write(level, __VA_ARGS__);                                                  \
+        }                                                                                                     \
+    } while (false)
+
+// printf-style format and arguments
+#define LOG_TRACE(...)    LIBPAMANAGER_LOG(LibPAmanager::LogLevel::TRACE, __VA_ARGS__)
+#define LOG_MESSAGE(...)  LIBPAMANAGER_LOG(LibPAmanager::LogLevel::MESSAGE, __VA_ARGS__)
+#define LOG_INFO(...)     LIBPAMANAGER_LOG(LibPAmanager::LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARN(...)     LIBPAMANAGER_LOG(LibPAmanager::LogLevel::WARN, __VA_ARGS__)
+#define LOG_CRITICAL(...) LIBPAMANAGER_LOG(LibPAmanager::LogLevel::CRITICAL, __VA_ARGS__)
+#define PRINT_ERROR(...)  LIBPAMANAGER_LOG(LibPAmanager::LogLevel::ERROR, __VA_ARGS__)
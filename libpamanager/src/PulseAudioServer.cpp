@@ -0,0 +1,361 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <string>
+
+#include "PulseAudioServer.h"
+
+namespace LibPAmanager
+{
+    namespace
+    {
+        class PulsePeakStream : public PeakStream
+        {
+        public:
+            PulsePeakStream(pa_stream* stream, PeakCallback callback, PeakStreamEndedCallback endedCallback,
+                            void* userdata)
+                : m_Stream(stream), m_Callback(callback), m_EndedCallback(endedCallback), m_Userdata(userdata)
+            {
+                pa_stream_set_read_callback(m_Stream, ReadCallback, this);
+                pa_stream_set_state_callback(m_Stream, StateCallback, this);
+            }
+
+            ~PulsePeakStream() override
+            {
+                pa_stream_set_read_callback(m_Stream, nullptr, nullptr);
+                pa_stream_set_state_callback(m_Stream, nullptr, nullptr);
+                pa_stream_disconnect(m_Stream);
+                pa_stream_unref(m_Stream);
+            }
+
+        private:
+            // failed to connect, or killed by the server; our own disconnect is not reported
+            static void StateCallback(pa_stream* stream, void* userdata)
+            {
+                auto peakStream = static_cast<PulsePeakStream*>(userdata);
+                auto state = pa_stream_get_state(stream);
+                if ((state == PA_STREAM_FAILED) || (state == PA_STREAM_TERMINATED))
+                {
+                    pa_stream_set_read_callback(stream, nullptr, nullptr);
+                    pa_stream_set_state_callback(stream, nullptr, nullptr);
+                    peakStream->m_EndedCallback(peakStream->m_Userdata);
+                }
+            }
+
+            static void ReadCallback(pa_stream* stream, size_t length, void* userdata)
+            {
+                auto peakStream = static_cast<PulsePeakStream*>(userdata);
+                while (pa_stream_readable_size(stream) > 0)
+                {
+                    const void* data;
+                    if ((pa_stream_peek(stream, &data, &length) < 0) || !length)
+                    {
+                        return;
+                    }
+                    // a hole in the stream has no data
+                    if (data)
+                    {
+                        peakStream->m_Callback(static_cast<const float*>(data), length / sizeof(float),
+                                               peakStream->m_Userdata);
+                    }
+                    pa_stream_drop(stream);
+                }
+            }
+
+        private:
+            pa_stream* m_Stream;
+            PeakCallback m_Callback;
+            PeakStreamEndedCallback m_EndedCallback;
+            void* m_Userdata;
+        };
+    }
+
+    PulseAudioServer::~PulseAudioServer()
+    {
+        DropOperations();
+        if (m_Context)
+        {
+            pa_context_disconnect(m_Context);
+            pa_context_unref(m_Context);
+        }
+    }
+
+    bool PulseAudioServer::Connect(const char* server, pa_context_notify_cb_t stateCallback, void* userdata)
+    {
+        // a reconnect: a failed context cannot be connected again
+        if (m_Context)
+        {
+            DropOperations();
+            pa_context_set_state_callback(m_Context, nullptr, nullptr);
+            pa_context_disconnect(m_Context);
+            pa_context_unref(m_Context);
+        }
+
+        // Create a connection to the server, nullptr selects the default server
+        m_Context = pa_context_new(m_MainloopAPI, "Device list");
+
+        // This function defines a callback so the server will tell us its state
+        pa_context_set_state_callback(m_Context, stateCallback, userdata);
+
+        // This function connects to the pulse audio server
+        return pa_context_connect(m_Context, server, PA_CONTEXT_NOFLAGS, nullptr) >= 0;
+    }
+
+    pa_context_state_t PulseAudioServer::GetState() const
+    {
+        return m_Context ? pa_context_get_state(m_Context) : PA_CONTEXT_UNCONNECTED;
+    }
+
+    int PulseAudioServer::GetErrno() const
+    {
+        int error = GetOperationError();
+        if (error != PA_OK)
+        {
+            return error;
+        }
+        return m_Context ? pa_context_errno(m_Context) : PA_ERR_BADSTATE;
+    }
+
+    //
+    // the operation is kept until libpulse reports it done, or the tracker cancels it
+    //
+    bool PulseAudioServer::Issue(OperationType type, uint key, std::function<void()> fail,
+                                 const std::function<pa_operation*()>& request)
+    {
+        if (!AdmitOperation())
+        {
+            return false;
+        }
+        pa_operation* operation = request();
+        if (!operation)
+        {
+            return false;
+        }
+        pa_operation_set_state_callback(operation, OperationStateCallback, this);
+        m_PulseOperations[operation] = TrackOperation(type, key, [this, operation]() { CancelOperation(operation); },
+                                                      std::move(fail));
+        return true;
+    }
+
+    void PulseAudioServer::CancelOperation(pa_operation* operation)
+    {
+        m_PulseOperations.erase(operation);
+        pa_operation_set_state_callback(operation, nullptr, nullptr);
+        pa_operation_cancel(operation);
+        pa_operation_unref(operation);
+    }
+
+    void PulseAudioServer::OperationStateCallback(pa_operation* operation, void* userdata)
+    {
+        auto server = static_cast<PulseAudioServer*>(userdata);
+        auto state = pa_operation_get_state(operation);
+        auto pulseOperation = server->m_PulseOperations.find(operation);
+        if ((state == PA_OPERATION_RUNNING) || (pulseOperation == server->m_PulseOperations.end()))
+        {
+            return;
+        }
+        uint64_t id = pulseOperation->second;
+        server->m_PulseOperations.erase(pulseOperation);
+
+        // libpulse holds a reference of its own while it calls back
+        pa_operation_set_state_callback(operation, nullptr, nullptr);
+        pa_operation_unref(operation);
+
+        if (state == PA_OPERATION_DONE)
+        {
+            // the reply has been delivered
+            server->FinishOperation(id);
+        }
+        else
+        {
+            // libpulse cancels the operations of a failed context without a reply
+            server->FailOperation(id, PA_ERR_CONNECTIONTERMINATED);
+        }
+    }
+
+    bool PulseAudioServer::GetServerInfo(pa_server_info_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::QUERY, PA_INVALID_INDEX, FailReply(callback, userdata),
+                     [&]() { return pa_context_get_server_info(m_Context, callback, userdata); });
+    }
+
+    bool PulseAudioServer::GetSinkInfoList(pa_sink_info_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::QUERY, PA_INVALID_INDEX, FailReply(callback, userdata),
+                     [&]() { return pa_context_get_sink_info_list(m_Context, callback, userdata); });
+    }
+
+    bool PulseAudioServer::GetSinkInfoByIndex(uint index, pa_sink_info_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::QUERY, index, FailReply(callback, userdata),
+                     [&]() { return pa_context_get_sink_info_by_index(m_Context, index, callback, userdata); });
+    }
+
+    bool PulseAudioServer::GetSourceInfoList(pa_source_info_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::QUERY, PA_INVALID_INDEX, FailReply(callback, userdata),
+                     [&]() { return pa_context_get_source_info_list(m_Context, callback, userdata); });
+    }
+
+    bool PulseAudioServer::GetSourceInfoByIndex(uint index, pa_source_info_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::QUERY, index, FailReply(callback, userdata),
+                     [&]() { return pa_context_get_source_info_by_index(m_Context, index, callback, userdata); });
+    }
+
+    bool PulseAudioServer::Subscribe(pa_subscription_mask_t mask, pa_context_subscribe_cb_t callback, void* userdata,
+                                     pa_context_success_cb_t successCallback, void* successUserdata)
+    {
+        pa_context_set_subscribe_callback(m_Context, callback, userdata);
+        return Issue(OperationType::SUBSCRIBE, PA_INVALID_INDEX, FailReply(successCallback, successUserdata),
+                     [&]() { return pa_context_subscribe(m_Context, mask, successCallback, successUserdata); });
+    }
+
+    bool PulseAudioServer::SetDefaultSink(const char* name, pa_context_success_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::SET_DEFAULT_SINK, 0, FailReply(callback, userdata),
+                     [&]() { return pa_context_set_default_sink(m_Context, name, callback, userdata); });
+    }
+
+    bool PulseAudioServer::SetSinkVolumeByIndex(uint index, const pa_cvolume* volume, pa_context_success_cb_t callback,
+                                                void* userdata)
+    {
+        return Issue(OperationType::SET_SINK_VOLUME, index, FailReply(callback, userdata),
+                     [&]()
+                     { return pa_context_set_sink_volume_by_index(m_Context, index, volume, callback, userdata); });
+    }
+
+    bool PulseAudioServer::GetSinkInputInfoList(pa_sink_input_info_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::QUERY, PA_INVALID_INDEX, FailReply(callback, userdata),
+                     [&]() { return pa_context_get_sink_input_info_list(m_Context, callback, userdata); });
+    }
+
+    bool PulseAudioServer::GetSinkInputInfo(uint index, pa_sink_input_info_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::QUERY, index, FailReply(callback, userdata),
+                     [&]() { return pa_context_get_sink_input_info(m_Context, index, callback, userdata); });
+    }
+
+    bool PulseAudioServer::GetSourceOutputInfoList(pa_source_output_info_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::QUERY, PA_INVALID_INDEX, FailReply(callback, userdata),
+                     [&]() { return pa_context_get_source_output_info_list(m_Context, callback, userdata); });
+    }
+
+    bool PulseAudioServer::GetSourceOutputInfo(uint index, pa_source_output_info_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::QUERY, index, FailReply(callback, userdata),
+                     [&]() { return pa_context_get_source_output_info(m_Context, index, callback, userdata); });
+    }
+
+    bool PulseAudioServer::MoveSinkInput(uint index, uint sinkIndex, pa_context_success_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::MOVE_STREAM, index, FailReply(callback, userdata),
+                     [&]()
+                     { return pa_context_move_sink_input_by_index(m_Context, index, sinkIndex, callback, userdata); });
+    }
+
+    bool PulseAudioServer::MoveSourceOutput(uint index, uint sourceIndex, pa_context_success_cb_t callback,
+                                            void* userdata)
+    {
+        return Issue(OperationType::MOVE_STREAM, index, FailReply(callback, userdata),
+                     [&]()
+                     {
+                         return pa_context_move_source_output_by_index(m_Context, index, sourceIndex, callback,
+                                                                       userdata);
+                     });
+    }
+
+    bool PulseAudioServer::SetSinkInputVolume(uint index, const pa_cvolume* volume, pa_context_success_cb_t callback,
+                                              void* userdata)
+    {
+        return Issue(OperationType::SET_STREAM_VOLUME, index, FailReply(callback, userdata),
+                     [&]() { return pa_context_set_sink_input_volume(m_Context, index, volume, callback, userdata); });
+    }
+
+    bool PulseAudioServer::SetSourceOutputVolume(uint index, const pa_cvolume* volume,
+                                                 pa_context_success_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::SET_STREAM_VOLUME, index, FailReply(callback, userdata),
+                     [&]()
+                     { return pa_context_set_source_output_volume(m_Context, index, volume, callback, userdata); });
+    }
+
+    bool PulseAudioServer::GetCardInfoList(pa_card_info_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::QUERY, PA_INVALID_INDEX, FailReply(callback, userdata),
+                     [&]() { return pa_context_get_card_info_list(m_Context, callback, userdata); });
+    }
+
+    bool PulseAudioServer::GetCardInfoByIndex(uint index, pa_card_info_cb_t callback, void* userdata)
+    {
+        return Issue(OperationType::QUERY, index, FailReply(callback, userdata),
+                     [&]() { return pa_context_get_card_info_by_index(m_Context, index, callback, userdata); });
+    }
+
+    bool PulseAudioServer::SetCardProfileByIndex(uint index, const char* profile, pa_context_success_cb_t callback,
+                                                 void* userdata)
+    {
+        return Issue(OperationType::SET_CARD_PROFILE, index, FailReply(callback, userdata),
+                     [&]()
+                     { return pa_context_set_card_profile_by_index(m_Context, index, profile, callback, userdata); });
+    }
+
+    //
+    // the server does the peak detection and resamples to rate, mono float; a fragment of a few
+    // peaks keeps the wakeups low, and the stream does not keep an idle device from suspending
+    //
+    std::unique_ptr<PeakStream> PulseAudioServer::OpenPeakStream(uint sourceIndex, uint rate, uint fragment,
+                                                                 PeakCallback callback,
+                                                                 PeakStreamEndedCallback endedCallback, void* userdata)
+    {
+        pa_sample_spec sampleSpec;
+        sampleSpec.format = PA_SAMPLE_FLOAT32;
+        sampleSpec.rate = rate;
+        sampleSpec.channels = 1;
+
+        pa_proplist* proplist = pa_proplist_new();
+        pa_proplist_sets(proplist, LEVEL_METER_PROPERTY, "1");
+        pa_stream* stream = pa_stream_new_with_proplist(m_Context, "Peak detect", &sampleSpec, nullptr, proplist);
+        pa_proplist_free(proplist);
+        if (!stream)
+        {
+            return nullptr;
+        }
+        auto peakStream = std::make_unique<PulsePeakStream>(stream, callback, endedCallback, userdata);
+
+        pa_buffer_attr bufferAttributes;
+        bufferAttributes.maxlength = static_cast<uint32_t>(-1);
+        bufferAttributes.tlength = static_cast<uint32_t>(-1);
+        bufferAttributes.prebuf = static_cast<uint32_t>(-1);
+        bufferAttributes.minreq = static_cast<uint32_t>(-1);
+        bufferAttributes.fragsize = fragment * sizeof(float);
+        auto flags = static_cast<pa_stream_flags_t>(PA_STREAM_DONT_MOVE | PA_STREAM_PEAK_DETECT |
+                                                    PA_STREAM_ADJUST_LATENCY | PA_STREAM_DONT_INHIBIT_AUTO_SUSPEND);
+        if (pa_stream_connect_record(stream, std::to_string(sourceIndex).c_str(), &bufferAttributes, flags) < 0)
+        {
+            return nullptr;
+        }
+        return peakStream;
+    }
+}
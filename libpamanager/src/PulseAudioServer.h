@@ -0,0 +1,84 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <unordered_map>
+
+#include "AudioServer.h"
+
+namespace LibPAmanager
+{
+    //
+    // AudioServer backed by a libpulse context
+    //
+    class PulseAudioServer : public AudioServer
+    {
+    public:
+        PulseAudioServer() {}
+        ~PulseAudioServer() override;
+
+        bool Connect(const char* server, pa_context_notify_cb_t stateCallback, void* userdata) override;
+        pa_context_state_t GetState() const override;
+        int GetErrno() const override;
+
+        bool GetServerInfo(pa_server_info_cb_t callback, void* userdata) override;
+        bool GetSinkInfoList(pa_sink_info_cb_t callback, void* userdata) override;
+        bool GetSinkInfoByIndex(uint index, pa_sink_info_cb_t callback, void* userdata) override;
+        bool GetSourceInfoList(pa_source_info_cb_t callback, void* userdata) override;
+        bool GetSourceInfoByIndex(uint index, pa_source_info_cb_t callback, void* userdata) override;
+        bool Subscribe(pa_subscription_mask_t mask, pa_context_subscribe_cb_t callback, void* userdata,
+                       pa_context_success_cb_t successCallback, void* successUserdata) override;
+        bool SetDefaultSink(const char* name, pa_context_success_cb_t callback, void* userdata) override;
+        bool SetSinkVolumeByIndex(uint index, const pa_cvolume* volume, pa_context_success_cb_t callback,
+                                  void* userdata) override;
+
+        bool GetSinkInputInfoList(pa_sink_input_info_cb_t callback, void* userdata) override;
+        bool GetSinkInputInfo(uint index, pa_sink_input_info_cb_t callback, void* userdata) override;
+        bool GetSourceOutputInfoList(pa_source_output_info_cb_t callback, void* userdata) override;
+        bool GetSourceOutputInfo(uint index, pa_source_output_info_cb_t callback, void* userdata) override;
+        bool MoveSinkInput(uint index, uint sinkIndex, pa_context_success_cb_t callback, void* userdata) override;
+        bool MoveSourceOutput(uint index, uint sourceIndex, pa_context_success_cb_t callback, void* userdata) override;
+        bool SetSinkInputVolume(uint index, const pa_cvolume* volume, pa_context_success_cb_t callback,
+                                void* userdata) override;
+        bool SetSourceOutputVolume(uint index, const pa_cvolume* volume, pa_context_success_cb_t callback,
+                                   void* userdata) override;
+
+        bool GetCardInfoList(pa_card_info_cb_t callback, void* userdata) override;
+        bool GetCardInfoByIndex(uint index, pa_card_info_cb_t callback, void* userdata) override;
+        bool SetCardProfileByIndex(uint index, const char* profile, pa_context_success_cb_t callback,
+                                   void* userdata) override;
+
+        std::unique_ptr<PeakStream> OpenPeakStream(uint sourceIndex, uint rate, uint fragment, PeakCallback callback,
+                                                   PeakStreamEndedCallback endedCallback, void* userdata) override;
+
+    private:
+        bool Issue(OperationType type, uint key, std::function<void()> fail,
+                   const std::function<pa_operation*()>& request);
+        void CancelOperation(pa_operation* operation);
+        static void OperationStateCallback(pa_operation* operation, void* userdata);
+
+    private:
+        pa_context* m_Context = nullptr;
+        std::unordered_map<pa_operation*, uint64_t> m_PulseOperations; // referenced until done, to the tracker id
+    };
+}
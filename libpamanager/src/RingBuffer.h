@@ -0,0 +1,86 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+namespace LibPAmanager
+{
+    //
+    // bounded single-producer/single-consumer queue, neither side ever blocks;
+    // the capacity is rounded up to a power of two
+    //
+    template<typename T> class RingBuffer
+    {
+    public:
+        explicit RingBuffer(size_t capacity = 256)
+        {
+            size_t size = 1;
+            while (size < capacity)
+            {
+                size <<= 1;
+            }
+            m_Buffer.resize(size);
+            m_Mask = size - 1;
+        }
+
+        // producer side, returns false if the queue is full
+        bool Push(const T& element)
+        {
+            size_t head = m_Head.load(std::memory_order_relaxed);
+            if (head - m_Tail.load(std::memory_order_acquire) > m_Mask)
+            {
+                return false;
+            }
+            m_Buffer[head & m_Mask] = element;
+            m_Head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer side, returns false if the queue is empty
+        bool Pop(T& element)
+        {
+            size_t tail = m_Tail.load(std::memory_order_relaxed);
+            if (tail == m_Head.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            element = std::move(m_Buffer[tail & m_Mask]);
+            m_Tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t Capacity() const { return m_Mask + 1; }
+
+    private:
+        std::vector<T> m_Buffer;
+        size_t m_Mask;
+
+        // producer and consumer indices on separate cache lines
+        alignas(64) std::atomic<size_t> m_Head{0};
+        alignas(64) std::atomic<size_t> m_Tail{0};
+    };
+}
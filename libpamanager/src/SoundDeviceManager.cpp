@@ -20,42 +20,47 @@
    TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
 
+#include <algorithm>
 #include <chrono>
+#include <sstream>
 #include <thread>
+#include <tuple>
 #include <math.h>
 
 #include "libpamanager.h"
 #include "SoundDeviceManager.h"
-
-using namespace std::chrono_literals;
+#include "PulseAudioServer.h"
 
 namespace LibPAmanager
 {
-    bool SoundDeviceManager::m_Ready = false;
     SoundDeviceManager* SoundDeviceManager::m_Instance = nullptr;
-    pa_context* SoundDeviceManager::m_Context = nullptr;
-    pa_mainloop* SoundDeviceManager::m_Mainloop = nullptr;
-    pa_mainloop_api* SoundDeviceManager::m_MainloopAPI = nullptr;
-    SoundDeviceManager::DefaultDevices SoundDeviceManager::m_DefaultDevices = {0, 0, 0, 0};
-    std::function<void(const Event&)> SoundDeviceManager::m_ApplicationEventCallback =
-        SoundDeviceManager::DummyAppEventCallback;
 
-    std::vector<std::string> SoundDeviceManager::m_InputDeviceDescriptions;
-    std::vector<uint> SoundDeviceManager::m_InputDeviceIndicies;
-    std::vector<std::string> SoundDeviceManager::m_InputDeviceNames;
-    uint SoundDeviceManager::m_InputDevices = 0;
+    SoundDeviceManager::SoundDeviceManager(const std::string& server, std::shared_ptr<EventLoop> eventLoop)
+        : m_ServerAddress(server), m_EventLoop(std::move(eventLoop)),
+          m_Snapshot(std::make_shared<const Snapshot>())
+    {
+    }
 
-    std::vector<std::string> SoundDeviceManager::m_OutputDeviceDescriptions;
-    std::vector<uint> SoundDeviceManager::m_OutputDeviceIndicies;
-    std::vector<std::string> SoundDeviceManager::m_OutputDeviceNames;
-    std::vector<uint> SoundDeviceManager::m_OutputDeviceVolumes;
-    uint SoundDeviceManager::m_OutputDevices = 0;
-    bool SoundDeviceManager::m_SetOutputDevice = false;
+    SoundDeviceManager::~SoundDeviceManager()
+    {
+        if (!m_Started)
+        {
+            return;
+        }
 
-    SoundDeviceManager::SoundDeviceManager() {}
+        // the server and its timers belong to the event loop thread
+        auto disconnected = std::make_shared<std::promise<void>>();
+        auto completion = disconnected->get_future();
+        m_EventLoop->Post([this, disconnected]()
+        {
+            Disconnect();
+            disconnected->set_value();
+        });
+        completion.wait();
+    }
 
     //
-    // create/provide singleton
+    // create/provide the process-wide manager
     //
     SoundDeviceManager* SoundDeviceManager::GetInstance()
     {
@@ -66,27 +71,61 @@ namespace LibPAmanager
         return m_Instance;
     }
 
-    void SoundDeviceManager::Start()
+    void SoundDeviceManager::Start(Backend backend, EventDelivery eventDelivery)
     {
-        std::thread pulseAudioThread([this]() { PulseAudioThread(); });
-        pulseAudioThread.detach();
+        std::vector<std::function<void()>> commands;
+        {
+            std::lock_guard<std::mutex> lock(m_CommandQueueMutex);
+            if (m_Started)
+            {
+                return;
+            }
+            // the event loop thread reads these only after it has been posted to below
+            m_EventDelivery = eventDelivery;
+            m_StartTime = std::chrono::steady_clock::now();
+
+            // serve the last known devices until the server has answered
+            if (m_DeviceCache.IsEnabled() && m_DeviceCache.Load(m_CachedTopology))
+            {
+                PublishCachedSnapshot();
+            }
+
+            if (!m_EventLoop)
+            {
+                m_EventLoop = EventLoop::GetShared(backend);
+            }
+            commands.swap(m_CommandQueue);
+            m_Started = true;
+        }
+
+        m_EventLoop->Start();
+        m_EventLoop->Post([this, commands]()
+        {
+            Connect();
+            for (auto& command : commands) // requests issued before Start()
+            {
+                command();
+            }
+        });
     }
 
     void SoundDeviceManager::PrintInputDeviceList() const
     {
         LOG_TRACE("SoundDeviceManager::PrintInputDeviceList:");
-        for (auto device : m_InputDeviceDescriptions)
+        auto snapshot = GetSnapshot();
+        for (auto& record : snapshot->m_InputDeviceRecords)
         {
-            LOG_INFO(device);
+            LOG_INFO("%s", record.m_Description.c_str());
         }
     }
 
     void SoundDeviceManager::PrintOutputDeviceList() const
     {
         LOG_TRACE("SoundDeviceManager::PrintOutputDeviceList:");
-        for (auto device : m_OutputDeviceDescriptions)
+        auto snapshot = GetSnapshot();
+        for (auto& record : snapshot->m_OutputDeviceRecords)
         {
-            LOG_INFO(device);
+            LOG_INFO("%s", record.m_Description.c_str());
         }
     }
 
@@ -115,23 +154,16 @@ namespace LibPAmanager
     void SoundDeviceManager::SinklistCallback(pa_context* context, const pa_sink_info* info, int eol, void* userdata)
     {
         LOG_CRITICAL("SinklistCallback");
+        auto batch = static_cast<RefreshBatch*>(userdata);
+        ScopedLatency latency(batch->m_Manager->m_CallbackTime[Stats::SINK_INFO]);
         // If eol is set to a positive number, the end of the list is reached
         if ((eol > 0) || (!info))
         {
             LOG_MESSAGE("**No more sinks\n");
-            SetDefaultDevices();
-
-            // notify end user app about change
-            if (m_OutputDevices != m_OutputDeviceIndicies.size())
-            {
-                m_OutputDevices = m_OutputDeviceIndicies.size();
-
-                Event event(Event::OUTPUT_DEVICE_LIST_CHANGED);
-                m_ApplicationEventCallback(event);
-            }
+            batch->m_Manager->CompleteRefresh(batch);
             return;
         }
-        AddOutputDevice(info->index, info->description, info->name, info->volume);
+        batch->m_Manager->AddOutputDevice(info);
         LOG_MESSAGE("Sink: name %s, description -->%s<--, index: %d\n", info->name, info->description, info->index);
         PrintProperties(info->proplist);
     }
@@ -142,455 +174,2626 @@ namespace LibPAmanager
     void SoundDeviceManager::SourcelistCallback(pa_context* context, const pa_source_info* info, int eol, void* userdata)
     {
         LOG_WARN("SourcelistCallback");
+        auto batch = static_cast<RefreshBatch*>(userdata);
+        ScopedLatency latency(batch->m_Manager->m_CallbackTime[Stats::SOURCE_INFO]);
         if ((eol > 0) || (!info))
         {
             LOG_MESSAGE("**No more sources\n");
-            SetDefaultDevices();
+            batch->m_Manager->CompleteRefresh(batch);
+            return;
+        }
+        batch->m_Manager->AddInputDevice(info);
+        LOG_MESSAGE("Source: name %s, description -->%s<--, index: %d\n", info->name, info->description, info->index);
+        PrintProperties(info->proplist);
+    }
 
-            // notify end user app about change
-            if (m_InputDevices != m_InputDeviceIndicies.size())
+    // INPUT_DEVICE_ADDED follows the snapshot that has the device, see RaiseDeviceListChanges()
+    void SoundDeviceManager::AddInputDevice(const pa_source_info* info)
+    {
+        auto inputDevice = m_InputDeviceTable.Add(info->index, info->name, info->description);
+        inputDevice->m_Volume = VolumeToPercent(pa_cvolume_max(&info->volume), GetVolumeCurve());
+        inputDevice->m_Monitor = info->monitor_of_sink;
+        inputDevice->m_Card = info->card;
+        inputDevice->m_ChannelMap = info->channel_map;
+        inputDevice->m_CVolume = info->volume;
+    }
+
+    void SoundDeviceManager::SinkInputCallback(pa_context* context, const pa_sink_input_info* info, int eol,
+                                               void* userdata)
+    {
+        auto batch = static_cast<RefreshBatch*>(userdata);
+        ScopedLatency latency(batch->m_Manager->m_CallbackTime[Stats::SINK_INPUT_INFO]);
+        if ((eol > 0) || (!info))
+        {
+            batch->m_Manager->CompleteRefresh(batch);
+            return;
+        }
+        batch->m_Manager->UpdatePlaybackStream(info);
+    }
+
+    void SoundDeviceManager::SourceOutputCallback(pa_context* context, const pa_source_output_info* info, int eol,
+                                                  void* userdata)
+    {
+        auto batch = static_cast<RefreshBatch*>(userdata);
+        ScopedLatency latency(batch->m_Manager->m_CallbackTime[Stats::SOURCE_OUTPUT_INFO]);
+        if ((eol > 0) || (!info))
+        {
+            batch->m_Manager->CompleteRefresh(batch);
+            return;
+        }
+        batch->m_Manager->UpdateRecordStream(info);
+    }
+
+    void SoundDeviceManager::CardCallback(pa_context* context, const pa_card_info* info, int eol, void* userdata)
+    {
+        auto batch = static_cast<RefreshBatch*>(userdata);
+        ScopedLatency latency(batch->m_Manager->m_CallbackTime[Stats::CARD_INFO]);
+        if ((eol > 0) || (!info))
+        {
+            batch->m_Manager->CompleteRefresh(batch);
+            return;
+        }
+        batch->m_Manager->UpdateCard(info);
+    }
+
+    //
+    // the profile and port tables are rebuilt from the card info, the card table keeps
+    // the published ones if nothing changed in them
+    //
+    void SoundDeviceManager::UpdateCard(const pa_card_info* info)
+    {
+        auto text = [](const char* string) { return std::string(string ? string : ""); };
+
+        CardRecord record;
+        record.m_PAIndex = info->index;
+        record.m_Name = text(info->name);
+        const char* description =
+            info->proplist ? pa_proplist_gets(info->proplist, PA_PROP_DEVICE_DESCRIPTION) : nullptr;
+        record.m_Description = description ? description : record.m_Name;
+
+        // profiles2 and active_profile2 carry the availability, the old arrays are deprecated
+        auto profiles = std::make_shared<std::vector<CardProfile>>();
+        profiles->reserve(info->n_profiles);
+        for (uint profile = 0; profile < info->n_profiles; profile++)
+        {
+            if (info->profiles2)
             {
-                m_InputDevices = m_InputDeviceIndicies.size();
+                auto cardProfile = info->profiles2[profile];
+                profiles->push_back({text(cardProfile->name), text(cardProfile->description), cardProfile->n_sinks,
+                                     cardProfile->n_sources, cardProfile->priority, cardProfile->available != 0});
+            }
+            else
+            {
+                auto& cardProfile = info->profiles[profile];
+                profiles->push_back({text(cardProfile.name), text(cardProfile.description), cardProfile.n_sinks,
+                                     cardProfile.n_sources, cardProfile.priority, true});
+            }
+        }
+        if (info->active_profile2)
+        {
+            record.m_ActiveProfile = text(info->active_profile2->name);
+        }
+        else if (info->active_profile)
+        {
+            record.m_ActiveProfile = text(info->active_profile->name);
+        }
 
-                Event event(Event::INPUT_DEVICE_LIST_CHANGED);
-                m_ApplicationEventCallback(event);
+        auto ports = std::make_shared<std::vector<CardPort>>();
+        ports->reserve(info->n_ports);
+        for (uint port = 0; port < info->n_ports; port++)
+        {
+            auto cardPort = info->ports[port];
+            CardPort entry{text(cardPort->name), text(cardPort->description), cardPort->priority, cardPort->available,
+                           cardPort->direction == PA_DIRECTION_OUTPUT, {}};
+            for (uint profile = 0; profile < cardPort->n_profiles; profile++)
+            {
+                const char* name =
+                    cardPort->profiles2 ? cardPort->profiles2[profile]->name : cardPort->profiles[profile]->name;
+                for (uint position = 0; position < profiles->size(); position++)
+                {
+                    if ((*profiles)[position].m_Name == text(name))
+                    {
+                        entry.m_Profiles.push_back(position);
+                        break;
+                    }
+                }
             }
+            ports->push_back(std::move(entry));
+        }
+
+        record.m_Profiles = std::move(profiles);
+        record.m_Ports = std::move(ports);
+        m_CardsChanged |= m_CardTable.Update(std::move(record));
+    }
+
+    StreamRecord SoundDeviceManager::MakeStreamRecord(uint index, uint client, const char* name, pa_proplist* proplist,
+                                                      uint device, int hasVolume, const pa_channel_map& channelMap,
+                                                      const pa_cvolume& volume) const
+    {
+        const char* application = proplist ? pa_proplist_gets(proplist, PA_PROP_APPLICATION_NAME) : nullptr;
+        StreamRecord record;
+        record.m_PAIndex = index;
+        record.m_Client = client;
+        record.m_Application = application ? application : "";
+        record.m_Name = name ? name : "";
+        record.m_Device = device;
+        record.m_HasVolume = hasVolume;
+        record.m_Volume = hasVolume ? VolumeToPercent(pa_cvolume_max(&volume), GetVolumeCurve()) : 0;
+        record.m_ChannelMap = channelMap;
+        record.m_CVolume = volume;
+        return record;
+    }
+
+    void SoundDeviceManager::UpdatePlaybackStream(const pa_sink_input_info* info)
+    {
+        auto record = MakeStreamRecord(info->index, info->client, info->name, info->proplist, info->sink,
+                                       info->has_volume, info->channel_map, info->volume);
+        m_PlaybackStreamsChanged |= m_PlaybackStreams.Update(record);
+    }
+
+    void SoundDeviceManager::UpdateRecordStream(const pa_source_output_info* info)
+    {
+        // the streams of our own level meters are not application streams
+        if (info->proplist && pa_proplist_gets(info->proplist, LEVEL_METER_PROPERTY))
+        {
             return;
         }
-        AddInputDevice(info->index, info->description, info->name);
-        LOG_MESSAGE("Source: name %s, description -->%s<--, index: %d\n", info->name, info->description, info->index);
-        PrintProperties(info->proplist);
+        auto record = MakeStreamRecord(info->index, info->client, info->name, info->proplist, info->source,
+                                       info->has_volume, info->channel_map, info->volume);
+        m_RecordStreamsChanged |= m_RecordStreams.Update(record);
     }
 
     void SoundDeviceManager::SubscribeCallback(pa_context* context, pa_subscription_event_type_t eventType, uint index,
                                                void* userdata)
+    {
+        auto manager = static_cast<SoundDeviceManager*>(userdata);
+        ScopedLatency latency(manager->m_CallbackTime[Stats::SUBSCRIPTION_EVENT]);
+        manager->OnSubscriptionEvent(eventType, index);
+    }
+
+    void SoundDeviceManager::OnSubscriptionEvent(pa_subscription_event_type_t eventType, uint index)
     {
         switch (eventType & PA_SUBSCRIPTION_EVENT_FACILITY_MASK)
         {
             case PA_SUBSCRIPTION_EVENT_SINK:
                 if ((eventType & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
                 {
-                    RemoveOutputDevice(index);
+                    if (auto outputDevice = m_OutputDeviceTable.FindByIndex(index))
+                    {
+                        auto outputDeviceHandle = outputDevice->m_Handle;
+                        m_OutputDeviceTable.Remove(index);
+                        FailPendingVolumeRequests(index);
+                        PublishSnapshot();
+                        SyncLevelMeters();
+                        RaiseEvent(Event(Event::OUTPUT_DEVICE_REMOVED, outputDeviceHandle));
+                        RaiseDeviceListChanges();
+                    }
+                    m_DirtySinks.erase(index);
                     LOG_MESSAGE("Removing sink index %d\n", index);
                 }
                 else
                 {
-                    SetDefaultVolume();
-                    pa_operation* operation;
-                    if (!(operation = pa_context_get_sink_info_by_index(context, index, SinklistCallback, nullptr)))
-                    {
-                        PRINT_ERROR("SubscribeCallback: pa_context_get_sink_info_by_index() failed");
-                        return;
-                    }
-                    pa_operation_unref(operation);
+                    // sink info, default volume and server info per event without coalescing
+                    m_SubscriptionEvents.fetch_add(1, std::memory_order_relaxed);
+                    m_UncoalescedRoundTrips.fetch_add(3, std::memory_order_relaxed);
+                    m_DirtySinks.insert(index);
+                    ScheduleRefresh();
                 }
                 break;
             case PA_SUBSCRIPTION_EVENT_SOURCE:
                 if ((eventType & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
                 {
-                    RemoveInputDevice(index);
+                    if (auto inputDevice = m_InputDeviceTable.FindByIndex(index))
+                    {
+                        auto inputDeviceHandle = inputDevice->m_Handle;
+                        m_InputDeviceTable.Remove(index);
+                        PublishSnapshot();
+                        SyncLevelMeters();
+                        RaiseEvent(Event(Event::INPUT_DEVICE_REMOVED, inputDeviceHandle));
+                        RaiseDeviceListChanges();
+                    }
+                    m_DirtySources.erase(index);
                     LOG_MESSAGE("Removing source index %d\n", index);
                 }
                 else
                 {
-                    pa_operation* operation;
-                    if (!(operation = pa_context_get_source_info_by_index(context, index, SourcelistCallback, nullptr)))
+                    // source info and server info per event without coalescing
+                    m_SubscriptionEvents.fetch_add(1, std::memory_order_relaxed);
+                    m_UncoalescedRoundTrips.fetch_add(2, std::memory_order_relaxed);
+                    m_DirtySources.insert(index);
+                    ScheduleRefresh();
+                }
+                break;
+            case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
+                if ((eventType & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
+                {
+                    if (m_PlaybackStreams.Remove(index))
                     {
-                        PRINT_ERROR("SubscribeCallback: pa_context_get_source_info_by_index() failed");
-                        return;
+                        PublishSnapshot();
+                        RaiseEvent(Event(Event::PLAYBACK_STREAM_LIST_CHANGED));
                     }
-                    pa_operation_unref(operation);
+                    m_DirtySinkInputs.erase(index);
                 }
-                break;
-        }
-    }
-
-    void SoundDeviceManager::ContextStateCallback(pa_context* context, void* userdata)
-    {
-        LOG_WARN("ContextStateCallback");
-        switch (pa_context_get_state(context))
-        {
-            case PA_CONTEXT_UNCONNECTED:
-                LOG_TRACE("ContextStateCallback: PA_CONTEXT_UNCONNECTED");
-                break;
-            case PA_CONTEXT_CONNECTING:
-                LOG_TRACE("ContextStateCallback: PA_CONTEXT_CONNECTING");
-                break;
-            case PA_CONTEXT_AUTHORIZING:
-                LOG_TRACE("ContextStateCallback: PA_CONTEXT_AUTHORIZING");
-                break;
-            case PA_CONTEXT_SETTING_NAME:
-                LOG_TRACE("ContextStateCallback: PA_CONTEXT_SETTING_NAME");
-                break;
-
-            case PA_CONTEXT_READY:
-            {
-                LOG_TRACE("ContextStateCallback: PA_CONTEXT_READY");
-                pa_operation* operation;
-
-                // set up a callback to tell us about source devices
-                if (!(operation = pa_context_get_source_info_list(context, SourcelistCallback, nullptr)))
+                else
                 {
-                    PRINT_ERROR("ContextStateCallback: pa_context_subscribe() failed");
-                    return;
+                    m_SubscriptionEvents.fetch_add(1, std::memory_order_relaxed);
+                    m_UncoalescedRoundTrips.fetch_add(1, std::memory_order_relaxed);
+                    m_DirtySinkInputs.insert(index);
+                    ScheduleRefresh();
                 }
-                pa_operation_unref(operation);
-
-                // set up a callback to tell us about sink devices
-                if (!(operation = pa_context_get_sink_info_list(context, SinklistCallback, nullptr)))
+                break;
+            case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT:
+                if ((eventType & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
                 {
-                    PRINT_ERROR("ContextStateCallback: pa_context_subscribe() failed");
-                    return;
+                    if (m_RecordStreams.Remove(index))
+                    {
+                        PublishSnapshot();
+                        RaiseEvent(Event(Event::RECORD_STREAM_LIST_CHANGED));
+                    }
+                    m_DirtySourceOutputs.erase(index);
                 }
-                pa_operation_unref(operation);
-
-                pa_context_set_subscribe_callback(context, SubscribeCallback, nullptr);
-                pa_subscription_mask_t mask =
-                    (pa_subscription_mask_t)(PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SOURCE);
-                if (!(operation = pa_context_subscribe(context, mask, nullptr, nullptr)))
+                else
                 {
-                    PRINT_ERROR("ContextStateCallback: pa_context_subscribe() failed");
-                    return;
+                    m_SubscriptionEvents.fetch_add(1, std::memory_order_relaxed);
+                    m_UncoalescedRoundTrips.fetch_add(1, std::memory_order_relaxed);
+                    m_DirtySourceOutputs.insert(index);
+                    ScheduleRefresh();
                 }
-                pa_operation_unref(operation);
-
-                break;
-            }
-
-            case PA_CONTEXT_FAILED:
-                LOG_TRACE("ContextStateCallback: PA_CONTEXT_FAILED");
-                break;
-            case PA_CONTEXT_TERMINATED:
-                LOG_TRACE("ContextStateCallback: PA_CONTEXT_TERMINATED");
                 break;
-            default:
-                LOG_TRACE("ContextStateCallback: default");
+            case PA_SUBSCRIPTION_EVENT_CARD:
+                if ((eventType & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
+                {
+                    auto profileSwitch = m_ProfileSwitches.find(index);
+                    if (profileSwitch != m_ProfileSwitches.end())
+                    {
+                        FinishProfileSwitch(profileSwitch->second, false, PA_ERR_NOENTITY);
+                    }
+                    if (m_CardTable.Remove(index))
+                    {
+                        PublishSnapshot();
+                        RaiseEvent(Event(Event::CARD_LIST_CHANGED));
+                    }
+                    m_DirtyCards.erase(index);
+                }
+                else
+                {
+                    m_SubscriptionEvents.fetch_add(1, std::memory_order_relaxed);
+                    m_UncoalescedRoundTrips.fetch_add(1, std::memory_order_relaxed);
+                    m_DirtyCards.insert(index);
+                    ScheduleRefresh();
+                }
                 break;
         }
     }
 
-    void SoundDeviceManager::ContextSuccessCallback(pa_context* context, int success, void* userdata)
-    {
-        if (!success)
-        {
-            PRINT_ERROR("ContextSuccessCallback: failed");
-        }
-    }
-
-    void SoundDeviceManager::ServerInfoCallback(pa_context* context, const pa_server_info* info, void* userdata)
+    //
+    // collect subscription events for the coalescing window, then refresh once
+    //
+    void SoundDeviceManager::ScheduleRefresh()
     {
-        if (!info)
+        if (m_RefreshScheduled)
         {
             return;
         }
-        uint iterator = 0;
-        for (auto inputDevice : m_InputDeviceNames)
+        m_RefreshScheduled = true;
+
+        pa_usec_t window = m_CoalescingWindow.load(std::memory_order_relaxed);
+        if (!m_RefreshTimer)
         {
-            if (inputDevice == info->default_source_name)
-            {
-                m_DefaultDevices.m_InputDeviceIndex = iterator;
-                break;
-            }
-            iterator++;
+            m_RefreshTimer = m_Server->NewTimer(window, RefreshTimerCallback, this);
         }
-        iterator = 0;
-        for (auto outputDevice : m_OutputDeviceNames)
+        else
         {
-            if (outputDevice == info->default_sink_name)
-            {
-                if (m_DefaultDevices.m_OutputDeviceIndex != iterator)
-                {
-                    m_DefaultDevices.m_OutputDeviceIndex = iterator;
-
-                    Event event(Event::OUTPUT_DEVICE_CHANGED);
-                    m_ApplicationEventCallback(event);
-                }
-                break;
-            }
-            iterator++;
+            m_Server->RestartTimer(m_RefreshTimer, window);
         }
-
-        LOG_TRACE(std::string("default input:  ") + m_InputDeviceDescriptions[m_DefaultDevices.m_InputDeviceIndex]);
-        LOG_TRACE(std::string("default output: " + m_OutputDeviceDescriptions[m_DefaultDevices.m_OutputDeviceIndex]));
     }
 
-    void SoundDeviceManager::SetSinkVolumeCallback(pa_context* context, const pa_sink_info* info, int eol, void* userdata)
+    void SoundDeviceManager::RefreshTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent,
+                                                  const struct timeval* tv, void* userdata)
     {
-        pa_cvolume cVolume;
+        auto manager = static_cast<SoundDeviceManager*>(userdata);
+        ScopedLatency latency(manager->m_CallbackTime[Stats::TIMER]);
+        manager->m_RefreshScheduled = false;
+        manager->FlushRefresh();
+    }
 
-        if (eol < 0)
+    void SoundDeviceManager::FlushRefresh()
+    {
+        bool devices = !m_DirtySinks.empty() || !m_DirtySources.empty();
+        if (!devices && m_DirtySinkInputs.empty() && m_DirtySourceOutputs.empty() && m_DirtyCards.empty())
         {
-            auto message = std::string("SetSinkVolumeCallback: Failed to get sink information: ");
-            message += pa_strerror(pa_context_errno(m_Context));
-            PRINT_ERROR(message.c_str());
             return;
         }
 
-        if ((eol) || (!info))
+        // one batch for all facilities, so the server info is queried only once at the end,
+        // and not at all if only streams changed
+        auto batch = new RefreshBatch{this, 1, false, devices, std::chrono::steady_clock::now()};
+        uint64_t roundTrips = devices ? 1 : 0; // server info in CompleteRefresh()
+
+        if (!m_DirtySinks.empty())
         {
-            return;
+            SetDefaultVolume();
+            roundTrips++;
         }
-
-        cVolume = info->volume;
-        uint sinkNumChannels = info->channel_map.channels;
-        for (uint i = 0; i < sinkNumChannels; i++)
+        for (auto index : m_DirtySinks)
         {
-            cVolume.values[i] = m_DefaultDevices.m_OutputDeviceVolumeRequest * PA_VOLUME_NORM / 100;
+            if (!m_Server->GetSinkInfoByIndex(index, SinklistCallback, batch))
+            {
+                PRINT_ERROR("FlushRefresh: GetSinkInfoByIndex() failed");
+                continue;
+            }
+            batch->m_Outstanding++;
+            roundTrips++;
         }
-
-        auto index = std::to_string(m_OutputDeviceIndicies[m_DefaultDevices.m_OutputDeviceIndex]);
-        pa_operation_unref(
-            pa_context_set_sink_volume_by_name(m_Context, index.c_str(), &cVolume, ContextSuccessCallback, nullptr));
-    }
-
-    void SoundDeviceManager::GetSinkVolumeCallback(pa_context* context, const pa_sink_info* info, int eol, void* userdata)
-    {
-        if (info)
+        for (auto index : m_DirtySources)
         {
-            float averageVolume = static_cast<float>(pa_cvolume_avg(&(info->volume)));
-            float volume = round(100 * averageVolume / static_cast<float>(PA_VOLUME_NORM));
-            auto previousVolume = m_DefaultDevices.m_OutputDeviceVolume;
-            m_DefaultDevices.m_OutputDeviceVolume = static_cast<uint>(volume);
-
-            auto currentOutputDevice = m_DefaultDevices.m_OutputDeviceIndex;
-            m_OutputDeviceVolumes[currentOutputDevice] = static_cast<uint>(volume);
-
-            auto message = std::string("GetSinkVolumeCallback, m_OutputDeviceVolume = ");
-            message += std::to_string(m_DefaultDevices.m_OutputDeviceVolume);
-            LOG_CRITICAL(message);
-
-            // notify end user app about change
-            if (!m_Ready)
+            if (!m_Server->GetSourceInfoByIndex(index, SourcelistCallback, batch))
             {
-                m_Ready = true;
-
-                Event event(Event::DEVICE_MANAGER_READY);
-                m_ApplicationEventCallback(event);
+                PRINT_ERROR("FlushRefresh: GetSourceInfoByIndex() failed");
+                continue;
             }
-            else if (m_SetOutputDevice)
+            batch->m_Outstanding++;
+            roundTrips++;
+        }
+        for (auto index : m_DirtySinkInputs)
+        {
+            if (!m_Server->GetSinkInputInfo(index, SinkInputCallback, batch))
             {
-                m_SetOutputDevice = false;
+                PRINT_ERROR("FlushRefresh: GetSinkInputInfo() failed");
+                continue;
             }
-            else if (previousVolume != m_DefaultDevices.m_OutputDeviceVolume)
+            batch->m_Outstanding++;
+            roundTrips++;
+        }
+        for (auto index : m_DirtySourceOutputs)
+        {
+            if (!m_Server->GetSourceOutputInfo(index, SourceOutputCallback, batch))
             {
-                Event event(Event::OUTPUT_DEVICE_VOLUME_CHANGED);
-                m_ApplicationEventCallback(event);
+                PRINT_ERROR("FlushRefresh: GetSourceOutputInfo() failed");
+                continue;
             }
+            batch->m_Outstanding++;
+            roundTrips++;
         }
-    }
-
-    void SoundDeviceManager::AddInputDevice(uint index, const char* description, const char* name)
-    {
-        for (auto deviceIndex : m_InputDeviceIndicies)
+        for (auto index : m_DirtyCards)
         {
-            if (deviceIndex == index)
+            if (!m_Server->GetCardInfoByIndex(index, CardCallback, batch))
             {
-                // already in list
-                return;
+                PRINT_ERROR("FlushRefresh: GetCardInfoByIndex() failed");
+                continue;
             }
+            batch->m_Outstanding++;
+            roundTrips++;
         }
-        m_InputDeviceDescriptions.push_back(description);
-        m_InputDeviceIndicies.push_back(index);
-        m_InputDeviceNames.push_back(name);
+        m_DirtySinks.clear();
+        m_DirtySources.clear();
+        m_DirtySinkInputs.clear();
+        m_DirtySourceOutputs.clear();
+        m_DirtyCards.clear();
+
+        m_Refreshes.fetch_add(1, std::memory_order_relaxed);
+        m_RefreshRoundTrips.fetch_add(roundTrips, std::memory_order_relaxed);
+
+        // drop the reference held while issuing the queries
+        CompleteRefresh(batch);
     }
 
-    void SoundDeviceManager::RemoveInputDevice(uint index)
+    //
+    // called at the end of each introspection list; for a batch only the last one
+    // publishes the registry and sends a single notification per list
+    //
+    void SoundDeviceManager::CompleteRefresh(RefreshBatch* batch)
     {
-        uint iterator = 0;
-        for (auto deviceIndex : m_InputDeviceIndicies)
+        if (batch)
         {
-            if (deviceIndex == index)
+            if (--batch->m_Outstanding > 0)
             {
-                m_InputDeviceDescriptions.erase(m_InputDeviceDescriptions.begin() + iterator);
-                m_InputDeviceIndicies.erase(m_InputDeviceIndicies.begin() + iterator);
-                m_InputDeviceNames.erase(m_InputDeviceNames.begin() + iterator);
                 return;
             }
-            iterator++;
         }
-    }
+        if (m_ConnectionLost || m_ShuttingDown)
+        {
+            // failed with the connection, the resync replaces them, or the manager goes away
+            delete batch;
+            return;
+        }
 
-    void SoundDeviceManager::AddOutputDevice(uint index, const char* description, const char* name, const pa_cvolume& volume)
-    {
-        for (auto deviceIndex : m_OutputDeviceIndicies)
+        bool resynced = false;
+        if (batch && batch->m_Startup)
         {
-            if (deviceIndex == index)
+            // the server info arrived with the batch, no need to ask again
+            ResolveDefaultDevices();
+            m_StartupPending = false;
+            resynced = m_Resync;
+            m_Resync = false;
+
+            // devices of a lost connection the server does not have anymore
+            for (auto outputDevice : m_OutputDeviceTable.RemoveDetached())
             {
-                // already in list
-                return;
+                if (resynced)
+                {
+                    RaiseEvent(Event(Event::OUTPUT_DEVICE_REMOVED, outputDevice));
+                }
+            }
+            for (auto inputDevice : m_InputDeviceTable.RemoveDetached())
+            {
+                if (resynced)
+                {
+                    RaiseEvent(Event(Event::INPUT_DEVICE_REMOVED, inputDevice));
+                }
+            }
+            PublishSnapshot();
+            if (resynced)
+            {
+                CompleteResync();
+            }
+            else
+            {
+                ReconcileTopology(m_CachedTopology, false);
             }
         }
-        m_OutputDeviceDescriptions.push_back(description);
-        m_OutputDeviceIndicies.push_back(index);
-        m_OutputDeviceNames.push_back(name);
-        float averageVolume = static_cast<float>(pa_cvolume_avg(&volume));
-        float outputDeviceVolume = round(100 * averageVolume / static_cast<float>(PA_VOLUME_NORM));
-        m_OutputDeviceVolumes.push_back(outputDeviceVolume);
-    }
-
-    void SoundDeviceManager::RemoveOutputDevice(uint index)
-    {
-        uint iterator = 0;
-        for (auto deviceIndex : m_OutputDeviceIndicies)
+        else
         {
-            if (deviceIndex == index)
+            PublishSnapshot();
+            if (!batch || batch->m_Devices)
             {
-                m_OutputDeviceDescriptions.erase(m_OutputDeviceDescriptions.begin() + iterator);
-                m_OutputDeviceIndicies.erase(m_OutputDeviceIndicies.begin() + iterator);
-                m_OutputDeviceNames.erase(m_OutputDeviceNames.begin() + iterator);
-                return;
+                SetDefaultDevices();
             }
-            iterator++;
         }
-    }
-
-    std::vector<std::string>& SoundDeviceManager::GetInputDeviceList() { return m_InputDeviceDescriptions; }
+        SyncLevelMeters();
 
-    std::vector<std::string>& SoundDeviceManager::GetOutputDeviceList() { return m_OutputDeviceDescriptions; }
+        // notify end user app about change
+        RaiseDeviceListChanges();
+        if (m_PlaybackStreamsChanged)
+        {
+            m_PlaybackStreamsChanged = false;
+            RaiseEvent(Event(Event::PLAYBACK_STREAM_LIST_CHANGED));
+        }
+        if (m_RecordStreamsChanged)
+        {
+            m_RecordStreamsChanged = false;
+            RaiseEvent(Event(Event::RECORD_STREAM_LIST_CHANGED));
+        }
+        if (m_CardsChanged)
+        {
+            m_CardsChanged = false;
+            RaiseEvent(Event(Event::CARD_LIST_CHANGED));
+        }
+        CheckProfileSwitches();
+        if (resynced)
+        {
+            RaiseEvent(Event(Event::CONNECTION_RESTORED));
+        }
 
-    void SoundDeviceManager::SetOutputDevice(const std::string& description)
-    {
-        uint iterator = 0;
-        for (auto device : m_OutputDeviceDescriptions)
+        if (batch)
         {
-            if (device == description)
+            m_OperationRoundTrip[batch->m_Startup ? Stats::STARTUP : Stats::REFRESH].Record(batch->m_Start);
+            if (batch->m_Startup)
             {
-                auto index = std::to_string(m_OutputDeviceIndicies[iterator]);
-                pa_operation* operation;
-                operation = pa_context_set_default_sink(m_Context, index.c_str(), ContextSuccessCallback, nullptr);
-                pa_operation_unref(operation);
-
-                m_DefaultDevices.m_OutputDeviceVolume = m_OutputDeviceVolumes[iterator];
-                m_DefaultDevices.m_OutputDeviceIndex = iterator;
-                m_SetOutputDevice = true;
-
-                std::string message = "SoundDeviceManager::SetOutputDevice: ";
-                message += description + ", index: " + index;
-                LOG_TRACE(message);
-
-                return;
+                CompleteStartup();
             }
-            iterator++;
+            delete batch;
         }
-        LOG_WARN("SoundDeviceManager::SetOutputDevice: sink not found");
     }
 
-    void SoundDeviceManager::SetOutputDevice(const uint outputDevice)
+    SoundDeviceManager::CoalescingStatistics SoundDeviceManager::GetCoalescingStatistics() const
     {
-        if (outputDevice < m_OutputDeviceNames.size())
-        {
-            auto index = std::to_string(m_OutputDeviceIndicies[outputDevice]);
-            pa_operation* operation;
-            operation = pa_context_set_default_sink(m_Context, index.c_str(), ContextSuccessCallback, nullptr);
-            pa_operation_unref(operation);
-
-            m_DefaultDevices.m_OutputDeviceVolume = m_OutputDeviceVolumes[outputDevice];
-            m_DefaultDevices.m_OutputDeviceIndex = outputDevice;
-            m_SetOutputDevice = true;
+        CoalescingStatistics statistics;
+        statistics.m_SubscriptionEvents = m_SubscriptionEvents.load(std::memory_order_relaxed);
+        statistics.m_Refreshes = m_Refreshes.load(std::memory_order_relaxed);
+        statistics.m_RoundTrips = m_RefreshRoundTrips.load(std::memory_order_relaxed);
+        uint64_t uncoalescedRoundTrips = m_UncoalescedRoundTrips.load(std::memory_order_relaxed);
+        statistics.m_RoundTripsSaved =
+            uncoalescedRoundTrips > statistics.m_RoundTrips ? uncoalescedRoundTrips - statistics.m_RoundTrips : 0;
+        return statistics;
+    }
 
-            std::string description = m_OutputDeviceDescriptions[outputDevice];
-            std::string message = "SoundDeviceManager::SetOutputDevice: ";
-            message += description + ", index: " + index;
-            LOG_TRACE(message);
+    SoundDeviceManager::OperationStatistics SoundDeviceManager::GetOperationStatistics() const
+    {
+        OperationStatistics statistics;
+        statistics.m_InFlight = m_OperationCounters.m_InFlight.load(std::memory_order_relaxed);
+        statistics.m_MaxInFlight = m_OperationCounters.m_MaxInFlight.load(std::memory_order_relaxed);
+        statistics.m_Issued = m_OperationCounters.m_Issued.load(std::memory_order_relaxed);
+        statistics.m_TimedOut = m_OperationCounters.m_TimedOut.load(std::memory_order_relaxed);
+        statistics.m_Superseded = m_OperationCounters.m_Superseded.load(std::memory_order_relaxed);
+        statistics.m_Rejected = m_OperationCounters.m_Rejected.load(std::memory_order_relaxed);
+        statistics.m_Cancelled = m_OperationCounters.m_Cancelled.load(std::memory_order_relaxed);
+        return statistics;
+    }
+
+    void SoundDeviceManager::SetOperationTimeout(OperationType type, std::chrono::milliseconds timeout)
+    {
+        m_OperationTimeouts[static_cast<int>(type)].store(static_cast<pa_usec_t>(timeout.count()) * PA_USEC_PER_MSEC,
+                                                          std::memory_order_relaxed);
+    }
+
+    void SoundDeviceManager::SetMaxOperationsInFlight(uint maxOperations)
+    {
+        m_MaxOperations.store(maxOperations, std::memory_order_relaxed);
+    }
+
+    //
+    // safe to call from any thread, the histograms are read with relaxed loads while they are being recorded
+    //
+    SoundDeviceManager::Stats SoundDeviceManager::GetStats() const
+    {
+        Stats stats;
+        for (uint operation = 0; operation < Stats::OPERATIONS; operation++)
+        {
+            stats.m_OperationRoundTrip[operation] = m_OperationRoundTrip[operation].GetStatistics();
+        }
+        for (uint callback = 0; callback < Stats::CALLBACKS; callback++)
+        {
+            stats.m_CallbackTime[callback] = m_CallbackTime[callback].GetStatistics();
+        }
+        stats.m_MainloopIteration = m_EventLoop ? m_EventLoop->GetIterationStatistics() : LatencyStatistics{};
+        stats.m_ApplicationCallback = m_ApplicationCallbackTime.GetStatistics();
+        stats.m_Coalescing = GetCoalescingStatistics();
+        stats.m_Operations = GetOperationStatistics();
+        stats.m_EventOverflows = GetEventOverflowCount();
+        stats.m_Reconnects = m_Reconnects.load(std::memory_order_relaxed);
+        stats.m_ReconnectAttempts = m_ReconnectAttempts.load(std::memory_order_relaxed);
+
+        auto snapshot = GetSnapshot();
+        stats.m_OutputDevices = snapshot->m_OutputDeviceRecords.size();
+        stats.m_InputDevices = snapshot->m_InputDeviceRecords.size();
+        stats.m_PlaybackStreams = snapshot->m_PlaybackStreams ? snapshot->m_PlaybackStreams->size() : 0;
+        stats.m_RecordStreams = snapshot->m_RecordStreams ? snapshot->m_RecordStreams->size() : 0;
+        stats.m_Cards = snapshot->m_Cards ? snapshot->m_Cards->size() : 0;
+        return stats;
+    }
+
+    const char* SoundDeviceManager::Stats::GetName(Operation operation)
+    {
+        switch (operation)
+        {
+            case SET_DEFAULT_SINK:
+                return "set_default_sink";
+            case SET_SINK_VOLUME:
+                return "set_sink_volume";
+            case STREAM_COMMAND:
+                return "stream_command";
+            case SET_CARD_PROFILE:
+                return "set_card_profile";
+            case REFRESH:
+                return "refresh";
+            case STARTUP:
+                return "startup";
+            case RECONNECT:
+                return "reconnect";
+            default:
+                return "invalid operation";
+        }
+    }
+
+    const char* SoundDeviceManager::Stats::GetName(Callback callback)
+    {
+        switch (callback)
+        {
+            case SERVER_INFO:
+                return "server_info";
+            case SINK_INFO:
+                return "sink_info";
+            case SOURCE_INFO:
+                return "source_info";
+            case SINK_INPUT_INFO:
+                return "sink_input_info";
+            case SOURCE_OUTPUT_INFO:
+                return "source_output_info";
+            case CARD_INFO:
+                return "card_info";
+            case SUBSCRIPTION_EVENT:
+                return "subscription_event";
+            case CONTEXT_STATE:
+                return "context_state";
+            case OPERATION_SUCCESS:
+                return "operation_success";
+            case TIMER:
+                return "timer";
+            default:
+                return "invalid callback";
+        }
+    }
+
+    std::string SoundDeviceManager::Stats::ToJSON() const
+    {
+        std::stringstream json;
+        json << "{\"operation_round_trip\": {";
+        for (uint operation = 0; operation < OPERATIONS; operation++)
+        {
+            json << (operation ? ", " : "") << "\"" << GetName(static_cast<Operation>(operation))
+                 << "\": " << LibPAmanager::ToJSON(m_OperationRoundTrip[operation]);
+        }
+        json << "}, \"callback_time\": {";
+        for (uint callback = 0; callback < CALLBACKS; callback++)
+        {
+            json << (callback ? ", " : "") << "\"" << GetName(static_cast<Callback>(callback))
+                 << "\": " << LibPAmanager::ToJSON(m_CallbackTime[callback]);
+        }
+        json << "}, \"mainloop_iteration\": " << LibPAmanager::ToJSON(m_MainloopIteration)
+             << ", \"application_callback\": " << LibPAmanager::ToJSON(m_ApplicationCallback)
+             << ", \"subscription_events\": " << m_Coalescing.m_SubscriptionEvents
+             << ", \"refreshes\": " << m_Coalescing.m_Refreshes << ", \"round_trips\": " << m_Coalescing.m_RoundTrips
+             << ", \"round_trips_saved\": " << m_Coalescing.m_RoundTripsSaved
+             << ", \"operations_in_flight\": " << m_Operations.m_InFlight
+             << ", \"max_operations_in_flight\": " << m_Operations.m_MaxInFlight
+             << ", \"operations_issued\": " << m_Operations.m_Issued
+             << ", \"operations_timed_out\": " << m_Operations.m_TimedOut
+             << ", \"operations_superseded\": " << m_Operations.m_Superseded
+             << ", \"operations_rejected\": " << m_Operations.m_Rejected
+             << ", \"operations_cancelled\": " << m_Operations.m_Cancelled
+             << ", \"event_overflows\": " << m_EventOverflows << ", \"reconnects\": " << m_Reconnects
+             << ", \"reconnect_attempts\": " << m_ReconnectAttempts << ", \"output_devices\": " << m_OutputDevices
+             << ", \"input_devices\": " << m_InputDevices << ", \"playback_streams\": " << m_PlaybackStreams
+             << ", \"record_streams\": " << m_RecordStreams << ", \"cards\": " << m_Cards << "}";
+        return json.str();
+    }
+
+    void SoundDeviceManager::SetCoalescingWindow(std::chrono::microseconds window)
+    {
+        m_CoalescingWindow.store(static_cast<pa_usec_t>(window.count()), std::memory_order_relaxed);
+    }
+
+    void SoundDeviceManager::ContextStateCallback(pa_context* context, void* userdata)
+    {
+        auto manager = static_cast<SoundDeviceManager*>(userdata);
+        ScopedLatency latency(manager->m_CallbackTime[Stats::CONTEXT_STATE]);
+        manager->OnContextState();
+    }
+
+    void SoundDeviceManager::OnContextState()
+    {
+        LOG_WARN("ContextStateCallback");
+        if (!m_Server || m_ShuttingDown)
+        {
+            // disconnecting in Disconnect()
+            return;
+        }
+        switch (m_Server->GetState())
+        {
+            case PA_CONTEXT_UNCONNECTED:
+                LOG_TRACE("ContextStateCallback: PA_CONTEXT_UNCONNECTED");
+                break;
+            case PA_CONTEXT_CONNECTING:
+                LOG_TRACE("ContextStateCallback: PA_CONTEXT_CONNECTING");
+                break;
+            case PA_CONTEXT_AUTHORIZING:
+                LOG_TRACE("ContextStateCallback: PA_CONTEXT_AUTHORIZING");
+                break;
+            case PA_CONTEXT_SETTING_NAME:
+                LOG_TRACE("ContextStateCallback: PA_CONTEXT_SETTING_NAME");
+                break;
+
+            case PA_CONTEXT_READY:
+            {
+                LOG_TRACE("ContextStateCallback: PA_CONTEXT_READY");
+                if (m_ConnectionLost)
+                {
+                    // streams and cards are queried anew, the devices are found again by name
+                    m_ConnectionLost = false;
+                    m_ReconnectAttempt = 0;
+                    m_PlaybackStreams.Clear();
+                    m_RecordStreams.Clear();
+                    m_CardTable.Clear();
+                }
+                // all startup queries are issued at once, the last reply completes the startup;
+                // the default volume comes with the sink list, it needs no round trip of its own
+                auto batch = new RefreshBatch{this, 1, true, true, std::chrono::steady_clock::now()};
+                m_StartupPending = true;
+                if (m_Server->GetServerInfo(StartupServerInfoCallback, batch))
+                {
+                    batch->m_Outstanding++;
+                }
+                else
+                {
+                    PRINT_ERROR("ContextStateCallback: GetServerInfo() failed");
+                }
+
+                // set up a callback to tell us about source devices
+                if (m_Server->GetSourceInfoList(SourcelistCallback, batch))
+                {
+                    batch->m_Outstanding++;
+                }
+                else
+                {
+                    PRINT_ERROR("ContextStateCallback: GetSourceInfoList() failed");
+                }
+
+                // set up a callback to tell us about sink devices
+                if (m_Server->GetSinkInfoList(SinklistCallback, batch))
+                {
+                    batch->m_Outstanding++;
+                }
+                else
+                {
+                    PRINT_ERROR("ContextStateCallback: GetSinkInfoList() failed");
+                }
+
+                // application streams
+                if (m_Server->GetSinkInputInfoList(SinkInputCallback, batch))
+                {
+                    batch->m_Outstanding++;
+                }
+                else
+                {
+                    PRINT_ERROR("ContextStateCallback: GetSinkInputInfoList() failed");
+                }
+                if (m_Server->GetSourceOutputInfoList(SourceOutputCallback, batch))
+                {
+                    batch->m_Outstanding++;
+                }
+                else
+                {
+                    PRINT_ERROR("ContextStateCallback: GetSourceOutputInfoList() failed");
+                }
+
+                // cards with their profiles and ports
+                if (m_Server->GetCardInfoList(CardCallback, batch))
+                {
+                    batch->m_Outstanding++;
+                }
+                else
+                {
+                    PRINT_ERROR("ContextStateCallback: GetCardInfoList() failed");
+                }
+
+                pa_subscription_mask_t mask =
+                    (pa_subscription_mask_t)(PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SOURCE |
+                                             PA_SUBSCRIPTION_MASK_SINK_INPUT | PA_SUBSCRIPTION_MASK_SOURCE_OUTPUT |
+                                             PA_SUBSCRIPTION_MASK_CARD);
+                if (m_Server->Subscribe(mask, SubscribeCallback, this, SubscribeSuccessCallback, batch))
+                {
+                    batch->m_Outstanding++;
+                }
+                else
+                {
+                    PRINT_ERROR("ContextStateCallback: Subscribe() failed");
+                }
+
+                if (!m_Ready && !m_StartupTimer)
+                {
+                    m_StartupTimer = m_Server->NewTimer(m_StartupTimeout.load(std::memory_order_relaxed),
+                                                        StartupTimeoutCallback, this);
+                }
+
+                // drop the reference held while issuing the queries
+                CompleteRefresh(batch);
+                break;
+            }
+
+            case PA_CONTEXT_FAILED:
+                LOG_TRACE("ContextStateCallback: PA_CONTEXT_FAILED");
+                OnConnectionLost();
+                break;
+            case PA_CONTEXT_TERMINATED:
+                LOG_TRACE("ContextStateCallback: PA_CONTEXT_TERMINATED");
+                OnConnectionLost();
+                break;
+            default:
+                LOG_TRACE("ContextStateCallback: default");
+                break;
+        }
+    }
+
+    void SoundDeviceManager::ContextSuccessCallback(pa_context* context, int success, void* userdata)
+    {
+        auto pendingCommand = static_cast<PendingCommand*>(userdata);
+        auto manager = pendingCommand->m_Manager;
+        ScopedLatency latency(manager->m_CallbackTime[Stats::OPERATION_SUCCESS]);
+        manager->m_OperationRoundTrip[Stats::SET_DEFAULT_SINK].Record(pendingCommand->m_Start);
+        int error = success ? PA_OK : manager->m_Server->GetErrno();
+        if (!success)
+        {
+            PRINT_ERROR("ContextSuccessCallback: failed");
+        }
+
+        for (auto& promise : pendingCommand->m_Promises)
+        {
+            Complete(promise, success, error);
+        }
+        delete pendingCommand;
+    }
+
+    void SoundDeviceManager::SubscribeSuccessCallback(pa_context* context, int success, void* userdata)
+    {
+        if (!success)
+        {
+            PRINT_ERROR("SubscribeSuccessCallback: failed");
+        }
+        auto batch = static_cast<RefreshBatch*>(userdata);
+        auto manager = batch->m_Manager;
+        ScopedLatency latency(manager->m_CallbackTime[Stats::OPERATION_SUCCESS]);
+        manager->CompleteRefresh(batch);
+    }
+
+    //
+    // raise DEVICE_MANAGER_READY exactly once, when the startup batch is done or the timeout expired
+    //
+    void SoundDeviceManager::CompleteStartup()
+    {
+        if (m_Ready || m_ShuttingDown)
+        {
+            return;
+        }
+        if (m_StartupTimer)
+        {
+            m_Server->FreeTimer(m_StartupTimer);
+            m_StartupTimer = nullptr;
+        }
+
+        auto timeToReady = std::chrono::steady_clock::now() - m_StartTime;
+        m_TimeToReadyUs.store(std::chrono::duration_cast<std::chrono::microseconds>(timeToReady).count(),
+                              std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(m_ReadyMutex);
+            m_Ready.store(true, std::memory_order_release);
+        }
+        m_ReadyCondition.notify_all();
+
+        RaiseEvent(Event(Event::DEVICE_MANAGER_READY, m_DefaultDevices.m_OutputDevice));
+    }
+
+    void SoundDeviceManager::StartupTimeoutCallback(pa_mainloop_api* api, pa_time_event* timeEvent,
+                                                    const struct timeval* tv, void* userdata)
+    {
+        // go ahead with whatever has arrived, late replies update the registry as usual
+        PRINT_ERROR("StartupTimeoutCallback: the sound server did not answer all startup queries in time");
+        auto manager = static_cast<SoundDeviceManager*>(userdata);
+        ScopedLatency latency(manager->m_CallbackTime[Stats::TIMER]);
+        manager->CompleteStartup();
+    }
+
+    bool SoundDeviceManager::WaitUntilReady(std::chrono::milliseconds timeout) const
+    {
+        std::unique_lock<std::mutex> lock(m_ReadyMutex);
+        return m_ReadyCondition.wait_for(lock, timeout, [this]() { return m_Ready.load(std::memory_order_acquire); });
+    }
+
+    std::chrono::microseconds SoundDeviceManager::GetTimeToReady() const
+    {
+        return std::chrono::microseconds(m_TimeToReadyUs.load(std::memory_order_relaxed));
+    }
+
+    // takes effect at the next connection, call before Start()
+    void SoundDeviceManager::SetStartupTimeout(std::chrono::milliseconds timeout)
+    {
+        m_StartupTimeout.store(static_cast<pa_usec_t>(timeout.count()) * PA_USEC_PER_MSEC, std::memory_order_relaxed);
+    }
+
+    void SoundDeviceManager::Complete(const Promise& promise, bool success, int error)
+    {
+        // internal requests such as ramp steps have no caller waiting
+        if (promise)
+        {
+            promise->set_value({success, error, std::chrono::steady_clock::now()});
+        }
+    }
+
+    void SoundDeviceManager::FailPendingVolumeRequests(uint index)
+    {
+        auto pendingVolumeRequests = m_PendingVolumeRequests.find(index);
+        if (pendingVolumeRequests != m_PendingVolumeRequests.end())
+        {
+            for (auto& promise : pendingVolumeRequests->second)
+            {
+                Complete(promise, false, PA_ERR_NOENTITY);
+            }
+            m_PendingVolumeRequests.erase(pendingVolumeRequests);
+        }
+    }
+
+    void SoundDeviceManager::ServerInfoCallback(pa_context* context, const pa_server_info* info, void* userdata)
+    {
+        auto manager = static_cast<SoundDeviceManager*>(userdata);
+        ScopedLatency latency(manager->m_CallbackTime[Stats::SERVER_INFO]);
+        manager->OnServerInfo(info);
+    }
+
+    void SoundDeviceManager::StartupServerInfoCallback(pa_context* context, const pa_server_info* info, void* userdata)
+    {
+        auto batch = static_cast<RefreshBatch*>(userdata);
+        auto manager = batch->m_Manager;
+        ScopedLatency latency(manager->m_CallbackTime[Stats::SERVER_INFO]);
+        manager->OnServerInfo(info);
+        manager->CompleteRefresh(batch);
+    }
+
+    void SoundDeviceManager::OnServerInfo(const pa_server_info* info)
+    {
+        if (info)
+        {
+            // the defaults rarely change, compare before interning
+            std::string_view defaultSourceName(info->default_source_name ? info->default_source_name : "");
+            std::string_view defaultSinkName(info->default_sink_name ? info->default_sink_name : "");
+            if (m_DefaultSourceName != defaultSourceName)
+            {
+                m_DefaultSourceName = InternedString(defaultSourceName);
+            }
+            if (m_DefaultSinkName != defaultSinkName)
+            {
+                m_DefaultSinkName = InternedString(defaultSinkName);
+            }
+            ResolveDefaultDevices();
+        }
+    }
+
+    void SoundDeviceManager::ResolveDefaultDevices()
+    {
+        if (auto inputDevice = m_InputDeviceTable.FindByName(m_DefaultSourceName))
+        {
+            m_DefaultDevices.m_InputDevice = inputDevice->m_Handle;
+            LOG_TRACE("default input:  %s", inputDevice->m_Description.c_str());
+        }
+        if (auto outputDevice = m_OutputDeviceTable.FindByName(m_DefaultSinkName))
+        {
+            if (m_DefaultDevices.m_OutputDevice != outputDevice->m_Handle)
+            {
+                m_DefaultDevices.m_OutputDevice = outputDevice->m_Handle;
+                m_DefaultDevices.m_OutputDeviceVolume = outputDevice->m_Volume;
+                PublishSnapshot();
+
+                // the initial default is reported by ReconcileTopology()
+                if (!m_StartupPending)
+                {
+                    RaiseEvent(Event(Event::OUTPUT_DEVICE_CHANGED, outputDevice->m_Handle));
+                }
+            }
+            LOG_TRACE("default output: %s", outputDevice->m_Description.c_str());
+        }
+    }
+
+    void SoundDeviceManager::SetSinkVolumeCallback(pa_context* context, int success, void* userdata)
+    {
+        auto pendingCommand = static_cast<PendingCommand*>(userdata);
+        auto manager = pendingCommand->m_Manager;
+        ScopedLatency latency(manager->m_CallbackTime[Stats::OPERATION_SUCCESS]);
+        manager->m_OperationRoundTrip[Stats::SET_SINK_VOLUME].Record(pendingCommand->m_Start);
+        manager->OnSetSinkVolume(success, pendingCommand);
+    }
+
+    void SoundDeviceManager::OnSetSinkVolume(bool success, PendingCommand* pendingCommand)
+    {
+        int error = success ? PA_OK : m_Server->GetErrno();
+        if (!success)
+        {
+            PRINT_ERROR("SetSinkVolumeCallback: failed: %s", pa_strerror(error));
+        }
+
+        uint index = pendingCommand->m_Index;
+        for (auto& promise : pendingCommand->m_Promises)
+        {
+            Complete(promise, success, error);
+        }
+        delete pendingCommand;
+
+        auto outputDevice = m_OutputDeviceTable.FindByIndex(index);
+        if (!outputDevice)
+        {
+            // sink removed while the operation was in flight
+            return;
+        }
+        outputDevice->m_VolumeInFlight = false;
+        if (outputDevice->m_VolumeRequestPending)
+        {
+            SendSinkVolume(outputDevice);
+        }
+    }
+
+    void SoundDeviceManager::SendSinkVolume(DeviceRecord* outputDevice)
+    {
+        pa_cvolume cVolume = outputDevice->m_VolumeRequest;
+
+        // all requests coalesced into this operation complete together
+        auto pendingCommand = new PendingCommand{this, outputDevice->m_PAIndex, {}, std::chrono::steady_clock::now()};
+        pendingCommand->m_Promises.swap(m_PendingVolumeRequests[outputDevice->m_PAIndex]);
+
+        if (!m_Server->SetSinkVolumeByIndex(outputDevice->m_PAIndex, &cVolume, SetSinkVolumeCallback, pendingCommand))
+        {
+            PRINT_ERROR("SendSinkVolume: SetSinkVolumeByIndex() failed");
+            int error = m_Server->GetErrno();
+            for (auto& promise : pendingCommand->m_Promises)
+            {
+                Complete(promise, false, error);
+            }
+            delete pendingCommand;
+            outputDevice->m_VolumeRequestPending = false;
+            return;
+        }
+
+        outputDevice->m_CVolume = cVolume;
+        outputDevice->m_VolumeRequestPending = false;
+        outputDevice->m_VolumeInFlight = true;
+    }
+
+    void SoundDeviceManager::GetSinkVolumeCallback(pa_context* context, const pa_sink_info* info, int eol, void* userdata)
+    {
+        auto manager = static_cast<SoundDeviceManager*>(userdata);
+        ScopedLatency latency(manager->m_CallbackTime[Stats::SINK_INFO]);
+        manager->OnSinkVolume(info);
+    }
+
+    void SoundDeviceManager::OnSinkVolume(const pa_sink_info* info)
+    {
+        if (info)
+        {
+            // the loudest channel is the volume, the other channels follow it with the balance
+            uint volume = VolumeToPercent(pa_cvolume_max(&info->volume), GetVolumeCurve());
+            auto previousVolume = m_DefaultDevices.m_OutputDeviceVolume;
+            m_DefaultDevices.m_OutputDeviceVolume = volume;
+
+            DeviceHandle outputDeviceHandle;
+            if (auto outputDevice = m_OutputDeviceTable.FindByIndex(info->index))
+            {
+                outputDevice->m_Volume = volume;
+                outputDevice->m_CVolume = info->volume;
+                outputDevice->m_ChannelMap = info->channel_map;
+                outputDeviceHandle = outputDevice->m_Handle;
+            }
+            PublishSnapshot();
+
+            LOG_CRITICAL("GetSinkVolumeCallback, m_OutputDeviceVolume = %u", m_DefaultDevices.m_OutputDeviceVolume);
+
+            // notify end user app about change
+            if (m_SetOutputDevice)
+            {
+                m_SetOutputDevice = false;
+            }
+            else if (m_Ready && previousVolume != m_DefaultDevices.m_OutputDeviceVolume)
+            {
+                RaiseEvent(Event(Event::OUTPUT_DEVICE_VOLUME_CHANGED, outputDeviceHandle, previousVolume,
+                                 m_DefaultDevices.m_OutputDeviceVolume));
+            }
+        }
+    }
+
+    // OUTPUT_DEVICE_ADDED follows the snapshot that has the device, see RaiseDeviceListChanges()
+    void SoundDeviceManager::AddOutputDevice(const pa_sink_info* info)
+    {
+        auto outputDevice = m_OutputDeviceTable.Add(info->index, info->name, info->description);
+        outputDevice->m_Volume = VolumeToPercent(pa_cvolume_max(&info->volume), GetVolumeCurve());
+        outputDevice->m_Monitor = info->monitor_source;
+        outputDevice->m_Card = info->card;
+        outputDevice->m_ChannelMap = info->channel_map;
+        outputDevice->m_CVolume = info->volume;
+    }
+
+    //
+    // readers take a reference-counted snapshot, the lists inside are never modified
+    //
+    std::shared_ptr<const SoundDeviceManager::Snapshot> SoundDeviceManager::GetSnapshot() const
+    {
+        return std::atomic_load_explicit(&m_Snapshot, std::memory_order_acquire);
+    }
+
+    SoundDeviceManager::DeviceList SoundDeviceManager::GetInputDeviceList() const
+    {
+        auto snapshot = GetSnapshot();
+        return DeviceList(snapshot, &snapshot->m_InputDevices);
+    }
+
+    SoundDeviceManager::DeviceList SoundDeviceManager::GetOutputDeviceList() const
+    {
+        auto snapshot = GetSnapshot();
+        return DeviceList(snapshot, &snapshot->m_OutputDevices);
+    }
+
+    SoundDeviceManager::StreamList SoundDeviceManager::GetPlaybackStreams() const
+    {
+        auto streams = GetSnapshot()->m_PlaybackStreams;
+        return streams ? streams : std::make_shared<const std::vector<StreamRecord>>();
+    }
+
+    SoundDeviceManager::StreamList SoundDeviceManager::GetRecordStreams() const
+    {
+        auto streams = GetSnapshot()->m_RecordStreams;
+        return streams ? streams : std::make_shared<const std::vector<StreamRecord>>();
+    }
+
+    SoundDeviceManager::CardList SoundDeviceManager::GetCards() const
+    {
+        auto cards = GetSnapshot()->m_Cards;
+        return cards ? cards : std::make_shared<const std::vector<CardRecord>>();
+    }
+
+    //
+    // build a new snapshot from the PA thread's working copy and swap it in
+    //
+    void SoundDeviceManager::PublishSnapshot()
+    {
+        auto snapshot = std::make_shared<Snapshot>();
+        snapshot->m_InputDevices.reserve(m_InputDeviceTable.Size());
+        snapshot->m_InputDeviceRecords.reserve(m_InputDeviceTable.Size());
+        m_InputDeviceTable.ForEach([&](const DeviceRecord& record)
+        {
+            snapshot->m_InputDevices.push_back(record.m_Description.View());
+            snapshot->m_InputDeviceRecords.push_back(record);
+        });
+        snapshot->m_OutputDevices.reserve(m_OutputDeviceTable.Size());
+        snapshot->m_OutputDeviceRecords.reserve(m_OutputDeviceTable.Size());
+        m_OutputDeviceTable.ForEach([&](const DeviceRecord& record)
+        {
+            snapshot->m_OutputDevices.push_back(record.m_Description.View());
+            snapshot->m_OutputDeviceRecords.push_back(record);
+        });
+
+        snapshot->m_OutputDeviceVolume = 0;
+        snapshot->m_OutputDeviceCVolume = {};
+        snapshot->m_OutputDeviceChannelMap = {};
+        if (auto outputDevice = m_OutputDeviceTable.Get(m_DefaultDevices.m_OutputDevice))
+        {
+            snapshot->m_DefaultOutputDeviceHandle = outputDevice->m_Handle;
+            snapshot->m_DefaultOutputDevice = outputDevice->m_Description.View();
+            snapshot->m_OutputDeviceVolume = outputDevice->m_Volume;
+            snapshot->m_OutputDeviceCVolume = outputDevice->m_CVolume;
+            snapshot->m_OutputDeviceChannelMap = outputDevice->m_ChannelMap;
+        }
+        snapshot->m_PlaybackStreams = m_PlaybackStreams.Publish();
+        snapshot->m_RecordStreams = m_RecordStreams.Publish();
+        snapshot->m_Cards = m_CardTable.Publish();
+        snapshot->m_Stale = m_Resync;
+
+        std::atomic_store_explicit(&m_Snapshot, std::shared_ptr<const Snapshot>(std::move(snapshot)),
+                                   std::memory_order_release);
+        ScheduleCacheStore();
+    }
+
+    //
+    // stale snapshot from the device cache, replaced by the first live snapshot
+    //
+    void SoundDeviceManager::PublishCachedSnapshot()
+    {
+        auto snapshot = std::make_shared<Snapshot>();
+        snapshot->m_Stale = true;
+        snapshot->m_OutputDeviceVolume = 0;
+        snapshot->m_OutputDeviceCVolume = {};
+        snapshot->m_OutputDeviceChannelMap = {};
+        snapshot->m_PlaybackStreams = m_PlaybackStreams.Publish();
+        snapshot->m_RecordStreams = m_RecordStreams.Publish();
+
+        auto addDevices = [](const std::vector<DeviceCache::Device>& devices,
+                             std::vector<std::string_view>& descriptions, std::vector<DeviceRecord>& records)
+        {
+            descriptions.reserve(devices.size());
+            records.reserve(devices.size());
+            for (auto& device : devices)
+            {
+                DeviceRecord record{};
+                record.m_PAIndex = PA_INVALID_INDEX;
+                record.m_Name = InternedString(device.m_Name);
+                record.m_Description = InternedString(device.m_Description);
+                record.m_Volume = device.m_Volume;
+                descriptions.push_back(record.m_Description.View());
+                records.push_back(std::move(record));
+            }
+        };
+        addDevices(m_CachedTopology.m_InputDevices, snapshot->m_InputDevices, snapshot->m_InputDeviceRecords);
+        addDevices(m_CachedTopology.m_OutputDevices, snapshot->m_OutputDevices, snapshot->m_OutputDeviceRecords);
+
+        for (auto& device : m_CachedTopology.m_OutputDevices)
+        {
+            if (device.m_Name == m_CachedTopology.m_DefaultOutputDevice)
+            {
+                snapshot->m_DefaultOutputDevice = InternedString(device.m_Description).View();
+                snapshot->m_OutputDeviceVolume = device.m_Volume;
+                break;
+            }
+        }
+
+        std::atomic_store_explicit(&m_Snapshot, std::shared_ptr<const Snapshot>(std::move(snapshot)),
+                                   std::memory_order_release);
+    }
+
+    //
+    // after the startup queries: notify only what differs from the devices served from the cache,
+    // or from the devices of a lost connection; the latter kept their records, so the changes
+    // of the device tables are exact, while the cached devices are matched by name
+    //
+    void SoundDeviceManager::ReconcileTopology(DeviceCache::Topology& topology, bool resync)
+    {
+        auto reconcile = [this, resync](DeviceTable& table, const std::vector<DeviceCache::Device>& cachedDevices,
+                                        Event::EventType addedEvent, Event::EventType listChangedEvent)
+        {
+            auto change = table.TakeChanges();
+            if (!resync)
+            {
+                // the table was empty before the startup queries, all its devices are added
+                std::unordered_map<std::string_view, const DeviceCache::Device*> cachedDeviceMap;
+                for (auto& device : cachedDevices)
+                {
+                    cachedDeviceMap[device.m_Name] = &device;
+                }
+
+                std::vector<DeviceRecord> added;
+                size_t found = 0;
+                for (auto& record : change.m_Added)
+                {
+                    auto cachedDevice = cachedDeviceMap.find(record.m_Name);
+                    if (cachedDevice == cachedDeviceMap.end())
+                    {
+                        added.push_back(std::move(record));
+                        continue;
+                    }
+                    found++;
+                    if (cachedDevice->second->m_Description != record.m_Description)
+                    {
+                        change.m_Modified.push_back(std::move(record));
+                    }
+                }
+                change.m_Added = std::move(added);
+                change.m_Reset = found < cachedDeviceMap.size();
+            }
+
+            for (auto& record : change.m_Added)
+            {
+                RaiseEvent(Event(addedEvent, record.m_Handle));
+            }
+            if (!change.IsEmpty())
+            {
+                RaiseEvent(Event(listChangedEvent, std::make_shared<const DeviceListChange>(std::move(change))));
+            }
+        };
+        reconcile(m_OutputDeviceTable, topology.m_OutputDevices, Event::OUTPUT_DEVICE_ADDED,
+                  Event::OUTPUT_DEVICE_LIST_CHANGED);
+        reconcile(m_InputDeviceTable, topology.m_InputDevices, Event::INPUT_DEVICE_ADDED,
+                  Event::INPUT_DEVICE_LIST_CHANGED);
+
+        auto outputDevice = m_OutputDeviceTable.Get(m_DefaultDevices.m_OutputDevice);
+        if (outputDevice && !topology.m_DefaultOutputDevice.empty())
+        {
+            if (outputDevice->m_Name != topology.m_DefaultOutputDevice)
+            {
+                RaiseEvent(Event(Event::OUTPUT_DEVICE_CHANGED, outputDevice->m_Handle));
+            }
+            else
+            {
+                for (auto& device : topology.m_OutputDevices)
+                {
+                    if ((device.m_Name == outputDevice->m_Name) && (device.m_Volume != outputDevice->m_Volume))
+                    {
+                        RaiseEvent(Event(Event::OUTPUT_DEVICE_VOLUME_CHANGED, outputDevice->m_Handle,
+                                         device.m_Volume, outputDevice->m_Volume));
+                        break;
+                    }
+                }
+            }
+        }
+        topology = DeviceCache::Topology();
+    }
+
+    void SoundDeviceManager::ScheduleCacheStore()
+    {
+        if (!m_DeviceCache.IsEnabled() || m_StartupPending || m_CacheStoreScheduled)
+        {
+            return;
+        }
+        m_CacheStoreScheduled = true;
+
+        if (!m_CacheStoreTimer)
+        {
+            m_CacheStoreTimer = m_Server->NewTimer(CACHE_STORE_DELAY, CacheStoreTimerCallback, this);
+        }
+        else
+        {
+            m_Server->RestartTimer(m_CacheStoreTimer, CACHE_STORE_DELAY);
+        }
+    }
+
+    void SoundDeviceManager::CacheStoreTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent,
+                                                     const struct timeval* tv, void* userdata)
+    {
+        auto manager = static_cast<SoundDeviceManager*>(userdata);
+        ScopedLatency latency(manager->m_CallbackTime[Stats::TIMER]);
+        manager->StoreCache();
+    }
+
+    void SoundDeviceManager::StoreCache()
+    {
+        m_CacheStoreScheduled = false;
+        m_DeviceCache.Store(CaptureTopology());
+    }
+
+    DeviceCache::Topology SoundDeviceManager::CaptureTopology() const
+    {
+        DeviceCache::Topology topology;
+        m_InputDeviceTable.ForEach([&](const DeviceRecord& record)
+        {
+            topology.m_InputDevices.push_back(
+                {std::string(record.m_Name), std::string(record.m_Description), record.m_Volume});
+        });
+        m_OutputDeviceTable.ForEach([&](const DeviceRecord& record)
+        {
+            topology.m_OutputDevices.push_back(
+                {std::string(record.m_Name), std::string(record.m_Description), record.m_Volume});
+        });
+        if (auto inputDevice = m_InputDeviceTable.Get(m_DefaultDevices.m_InputDevice))
+        {
+            topology.m_DefaultInputDevice = std::string(inputDevice->m_Name);
+        }
+        if (auto outputDevice = m_OutputDeviceTable.Get(m_DefaultDevices.m_OutputDevice))
+        {
+            topology.m_DefaultOutputDevice = std::string(outputDevice->m_Name);
+        }
+        return topology;
+    }
+
+    void SoundDeviceManager::SetDeviceCacheFile(const std::string& filename)
+    {
+        m_DeviceCache.SetFile(filename);
+    }
+
+    Completion SoundDeviceManager::SetOutputDevice(std::string_view description)
+    {
+        auto promise = std::make_shared<std::promise<CommandResult>>();
+        auto completion = promise->get_future();
+        PostCommand([this, description = std::string(description), promise]()
+        {
+            if (auto outputDevice = m_OutputDeviceTable.FindByDescription(description))
+            {
+                ApplyOutputDevice(outputDevice->m_Handle, promise);
+                return;
+            }
+            LOG_WARN("SoundDeviceManager::SetOutputDevice: sink not found");
+            Complete(promise, false, PA_ERR_NOENTITY);
+        });
+        return completion;
+    }
+
+    Completion SoundDeviceManager::SetOutputDevice(DeviceHandle outputDevice)
+    {
+        auto promise = std::make_shared<std::promise<CommandResult>>();
+        auto completion = promise->get_future();
+        PostCommand([this, outputDevice, promise]() { ApplyOutputDevice(outputDevice, promise); });
+        return completion;
+    }
+
+    void SoundDeviceManager::ApplyOutputDevice(DeviceHandle outputDevice, Promise promise)
+    {
+        auto record = m_OutputDeviceTable.Get(outputDevice);
+        if (!record)
+        {
+            LOG_WARN("SoundDeviceManager::SetOutputDevice: stale device handle");
+            Complete(promise, false, PA_ERR_NOENTITY);
+            return;
+        }
+
+        auto pendingCommand = new PendingCommand{this, record->m_PAIndex, {promise}, std::chrono::steady_clock::now()};
+        if (!m_Server->SetDefaultSink(record->m_Name.c_str(), ContextSuccessCallback, pendingCommand))
+        {
+            PRINT_ERROR("ApplyOutputDevice: SetDefaultSink() failed");
+            Complete(promise, false, m_Server->GetErrno());
+            delete pendingCommand;
+            return;
+        }
+
+        m_DefaultDevices.m_OutputDeviceVolume = record->m_Volume;
+        m_DefaultDevices.m_OutputDevice = outputDevice;
+        m_SetOutputDevice = true;
+        PublishSnapshot();
+
+        LOG_TRACE("SoundDeviceManager::SetOutputDevice: %s, index: %u", record->m_Description.c_str(), record->m_PAIndex);
+    }
+
+    //
+    // run a request on the event loop thread, requests issued before Start() wait for the connection
+    //
+    void SoundDeviceManager::PostCommand(std::function<void()> command)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_CommandQueueMutex);
+            if (!m_Started)
+            {
+                m_CommandQueue.push_back(std::move(command));
+                return;
+            }
+        }
+        m_EventLoop->Post(std::move(command));
+    }
+
+    SoundDeviceManager::LockStatistics SoundDeviceManager::GetLockStatistics() const
+    {
+        if (!m_EventLoop)
+        {
+            return LockStatistics{0, 0, 0};
+        }
+        return m_EventLoop->GetLockStatistics();
+    }
+
+    void SoundDeviceManager::SetDefaultDevices()
+    {
+        if (!m_Server->GetServerInfo(ServerInfoCallback, this))
+        {
+            PRINT_ERROR("SetDefaultDevices: GetServerInfo() failed");
+        }
+    }
+
+    std::string_view SoundDeviceManager::GetDefaultOutputDevice() const
+    {
+        return GetSnapshot()->m_DefaultOutputDevice;
+    }
+
+    void SoundDeviceManager::SetDefaultVolume()
+    {
+        auto outputDevice = m_OutputDeviceTable.Get(m_DefaultDevices.m_OutputDevice);
+        if (!outputDevice)
+        {
+            return;
+        }
+
+        if (!m_Server->GetSinkInfoByIndex(outputDevice->m_PAIndex, GetSinkVolumeCallback, this))
+        {
+            PRINT_ERROR("SetDefaultVolume: GetSinkInfoByIndex() failed");
+        }
+    }
+
+    uint SoundDeviceManager::GetVolume() const
+    {
+        return GetSnapshot()->m_OutputDeviceVolume;
+    }
+
+    Completion SoundDeviceManager::SetVolume(uint volume)
+    {
+        if (volume > 100)
+        {
+            volume = 100;
+            PRINT_ERROR("SetVolume: Clamping output volume to 100. Permissible input range: 0 - 100");
+        }
+        auto promise = std::make_shared<std::promise<CommandResult>>();
+        auto completion = promise->get_future();
+        PostCommand([this, volume, promise]()
+        {
+            StopVolumeRamp(PA_ERR_KILLED);
+            pa_volume_t paVolume = PercentToVolume(volume, GetVolumeCurve());
+            RequestSinkVolume(promise, [paVolume](pa_cvolume& cVolume, const DeviceRecord&)
+            {
+                // keeps the balance between the channels
+                return pa_cvolume_scale(&cVolume, paVolume) != nullptr;
+            });
+        });
+        return completion;
+    }
+
+    Completion SoundDeviceManager::SetChannelVolumes(const std::vector<uint>& volumes)
+    {
+        auto promise = std::make_shared<std::promise<CommandResult>>();
+        auto completion = promise->get_future();
+        PostCommand([this, volumes, promise]()
+        {
+            StopVolumeRamp(PA_ERR_KILLED);
+            auto curve = GetVolumeCurve();
+            RequestSinkVolume(promise, [&volumes, curve](pa_cvolume& cVolume, const DeviceRecord&)
+            {
+                if (volumes.size() != cVolume.channels)
+                {
+                    return false;
+                }
+                for (uint channel = 0; channel < cVolume.channels; channel++)
+                {
+                    cVolume.values[channel] = PercentToVolume(volumes[channel], curve);
+                }
+                return true;
+            });
+        });
+        return completion;
+    }
+
+    std::vector<uint> SoundDeviceManager::GetChannelVolumes() const
+    {
+        auto snapshot = GetSnapshot();
+        auto curve = GetVolumeCurve();
+        std::vector<uint> volumes(snapshot->m_OutputDeviceCVolume.channels);
+        for (uint channel = 0; channel < volumes.size(); channel++)
+        {
+            volumes[channel] = VolumeToPercent(snapshot->m_OutputDeviceCVolume.values[channel], curve);
+        }
+        return volumes;
+    }
+
+    Completion SoundDeviceManager::SetBalance(float balance)
+    {
+        auto promise = std::make_shared<std::promise<CommandResult>>();
+        auto completion = promise->get_future();
+        PostCommand([this, balance, promise]()
+        {
+            StopVolumeRamp(PA_ERR_KILLED);
+            RequestSinkVolume(promise, [balance](pa_cvolume& cVolume, const DeviceRecord& outputDevice)
+            {
+                return pa_cvolume_set_balance(&cVolume, &outputDevice.m_ChannelMap, balance) != nullptr;
+            });
+        });
+        return completion;
+    }
+
+    float SoundDeviceManager::GetBalance() const
+    {
+        auto snapshot = GetSnapshot();
+        if (!snapshot->m_OutputDeviceCVolume.channels)
+        {
+            return 0.0f;
+        }
+        return pa_cvolume_get_balance(&snapshot->m_OutputDeviceCVolume, &snapshot->m_OutputDeviceChannelMap);
+    }
+
+    void SoundDeviceManager::SetVolumeCurve(VolumeCurve curve)
+    {
+        PostCommand([this, curve]()
+        {
+            m_VolumeCurve.store(curve, std::memory_order_relaxed);
+
+            // percent values of the registry follow the new curve
+            for (auto table : {&m_InputDeviceTable, &m_OutputDeviceTable})
+            {
+                table->ForEach([curve](DeviceRecord& record)
+                {
+                    record.m_Volume = VolumeToPercent(pa_cvolume_max(&record.m_CVolume), curve);
+                });
+            }
+            for (auto streamTable : {&m_PlaybackStreams, &m_RecordStreams})
+            {
+                std::vector<StreamRecord> records;
+                streamTable->ForEach([&records](const StreamRecord& record) { records.push_back(record); });
+                for (auto& record : records)
+                {
+                    record.m_Volume = record.m_HasVolume ? VolumeToPercent(pa_cvolume_max(&record.m_CVolume), curve) : 0;
+                    streamTable->Update(record);
+                }
+            }
+            if (auto outputDevice = m_OutputDeviceTable.Get(m_DefaultDevices.m_OutputDevice))
+            {
+                m_DefaultDevices.m_OutputDeviceVolume = outputDevice->m_Volume;
+            }
+            PublishSnapshot();
+        });
+    }
+
+    //
+    // latest wins: while a set operation is in flight only the newest request is kept,
+    // superseded requests complete together with the operation that carries the newest value;
+    // update() starts from the newest requested volume, or the cached one, no query needed
+    //
+    void SoundDeviceManager::RequestSinkVolume(const Promise& promise,
+                                               std::function<bool(pa_cvolume&, const DeviceRecord&)> update)
+    {
+        auto outputDevice = m_OutputDeviceTable.Get(m_DefaultDevices.m_OutputDevice);
+        if (!outputDevice)
+        {
+            Complete(promise, false, PA_ERR_NOENTITY);
+            return;
+        }
+
+        pa_cvolume cVolume = outputDevice->m_VolumeRequestPending ? outputDevice->m_VolumeRequest : outputDevice->m_CVolume;
+        if (!update(cVolume, *outputDevice) || !pa_cvolume_valid(&cVolume))
+        {
+            Complete(promise, false, PA_ERR_INVALID);
+            return;
+        }
+
+        outputDevice->m_VolumeRequest = cVolume;
+        outputDevice->m_VolumeRequestPending = true;
+        if (promise)
+        {
+            m_PendingVolumeRequests[outputDevice->m_PAIndex].push_back(promise);
+        }
+        if (!outputDevice->m_VolumeInFlight)
+        {
+            SendSinkVolume(outputDevice);
+        }
+    }
+
+    Completion SoundDeviceManager::RampVolume(uint volume, std::chrono::milliseconds duration, VolumeCurve curve)
+    {
+        auto promise = std::make_shared<std::promise<CommandResult>>();
+        auto completion = promise->get_future();
+        PostCommand([this, volume, duration, curve, promise]()
+        {
+            auto outputDevice = m_OutputDeviceTable.Get(m_DefaultDevices.m_OutputDevice);
+            if (!outputDevice)
+            {
+                Complete(promise, false, PA_ERR_NOENTITY);
+                return;
+            }
+            if (m_VolumeRampActive && (m_VolumeRampSink != outputDevice->m_PAIndex))
+            {
+                StopVolumeRamp(PA_ERR_NOENTITY);
+            }
+
+            auto now = VolumeRamp::Clock::now();
+            pa_volume_t target = PercentToVolume(volume, GetVolumeCurve());
+            m_VolumeRampPromises.push_back(promise);
+            if (m_VolumeRampActive)
+            {
+                // retarget from the current position, the running timer takes the next step
+                m_VolumeRamp.Start(m_VolumeRamp.GetVolume(now), target, duration, curve, now);
+                return;
+            }
+
+            m_VolumeRampActive = true;
+            m_VolumeRampSink = outputDevice->m_PAIndex;
+            m_VolumeRampChannels = outputDevice->m_VolumeRequestPending ? outputDevice->m_VolumeRequest : outputDevice->m_CVolume;
+            m_VolumeRampLastStep = PA_VOLUME_INVALID;
+            m_VolumeRamp.Start(pa_cvolume_max(&m_VolumeRampChannels), target, duration, curve, now);
+            StepVolumeRamp();
+        });
+        return completion;
+    }
+
+    void SoundDeviceManager::CancelVolumeRamp()
+    {
+        PostCommand([this]() { StopVolumeRamp(PA_ERR_KILLED); });
+    }
+
+    void SoundDeviceManager::SetVolumeRampRate(uint updatesPerSecond)
+    {
+        m_VolumeRampInterval.store(PA_USEC_PER_SEC / std::max(updatesPerSecond, 1u), std::memory_order_relaxed);
+    }
+
+    //
+    // one step per timer expiry: steps that do not change the volume are skipped, and at most
+    // one set operation is in flight, a step taken meanwhile replaces the previous one
+    //
+    void SoundDeviceManager::StepVolumeRamp()
+    {
+        auto outputDevice = m_OutputDeviceTable.Get(m_DefaultDevices.m_OutputDevice);
+        if (!outputDevice || (outputDevice->m_PAIndex != m_VolumeRampSink))
+        {
+            // the default output device was removed or changed
+            StopVolumeRamp(PA_ERR_NOENTITY);
+            return;
+        }
+
+        auto now = VolumeRamp::Clock::now();
+        bool finished = m_VolumeRamp.IsFinished(now);
+        pa_volume_t volume = m_VolumeRamp.GetVolume(now);
+        if (finished)
+        {
+            // the ramp, and the ramps it retargeted, complete with the operation carrying the target
+            auto& pendingVolumeRequests = m_PendingVolumeRequests[m_VolumeRampSink];
+            pendingVolumeRequests.insert(pendingVolumeRequests.end(), m_VolumeRampPromises.begin(),
+                                         m_VolumeRampPromises.end());
+            m_VolumeRampPromises.clear();
+            m_VolumeRampActive = false;
+        }
+
+        if (finished || (volume != m_VolumeRampLastStep))
+        {
+            m_VolumeRampLastStep = volume;
+            auto& channels = m_VolumeRampChannels;
+            RequestSinkVolume(nullptr, [&channels, volume](pa_cvolume& cVolume, const DeviceRecord&)
+            {
+                // keeps the balance of the start, even through silence
+                cVolume = channels;
+                return pa_cvolume_scale(&cVolume, volume) != nullptr;
+            });
+        }
+
+        if (!finished)
+        {
+            auto interval = m_VolumeRampInterval.load(std::memory_order_relaxed);
+            if (!m_VolumeRampTimer)
+            {
+                m_VolumeRampTimer = m_Server->NewTimer(interval, VolumeRampTimerCallback, this);
+            }
+            else
+            {
+                m_Server->RestartTimer(m_VolumeRampTimer, interval);
+            }
+        }
+    }
+
+    void SoundDeviceManager::VolumeRampTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent,
+                                                     const struct timeval* tv, void* userdata)
+    {
+        auto manager = static_cast<SoundDeviceManager*>(userdata);
+        ScopedLatency latency(manager->m_CallbackTime[Stats::TIMER]);
+        if (manager->m_VolumeRampActive)
+        {
+            manager->StepVolumeRamp();
+        }
+    }
+
+    // the volume stays where the ramp was, a pending timer expiry finds the ramp inactive
+    void SoundDeviceManager::StopVolumeRamp(int error)
+    {
+        if (!m_VolumeRampActive)
+        {
+            return;
+        }
+        m_VolumeRampActive = false;
+        for (auto& promise : m_VolumeRampPromises)
+        {
+            Complete(promise, false, error);
+        }
+        m_VolumeRampPromises.clear();
+    }
+
+    Completion SoundDeviceManager::MovePlaybackStreams(const std::vector<uint>& streams, DeviceHandle outputDevice)
+    {
+        auto promise = std::make_shared<std::promise<CommandResult>>();
+        auto completion = promise->get_future();
+        PostCommand([this, streams, outputDevice, promise]()
+        {
+            auto device = m_OutputDeviceTable.Get(outputDevice);
+            if (!device)
+            {
+                Complete(promise, false, PA_ERR_NOENTITY);
+                return;
+            }
+            uint sinkIndex = device->m_PAIndex;
+            IssueBulkCommand(promise, streams, [this, sinkIndex](uint stream, BulkCommand* bulkCommand)
+            {
+                return m_Server->MoveSinkInput(stream, sinkIndex, BulkCommandCallback, bulkCommand) ? PA_OK
+                                                                                                    : m_Server->GetErrno();
+            });
+        });
+        return completion;
+    }
+
+    Completion SoundDeviceManager::MoveRecordStreams(const std::vector<uint>& streams, DeviceHandle inputDevice)
+    {
+        auto promise = std::make_shared<std::promise<CommandResult>>();
+        auto completion = promise->get_future();
+        PostCommand([this, streams, inputDevice, promise]()
+        {
+            auto device = m_InputDeviceTable.Get(inputDevice);
+            if (!device)
+            {
+                Complete(promise, false, PA_ERR_NOENTITY);
+                return;
+            }
+            uint sourceIndex = device->m_PAIndex;
+            IssueBulkCommand(promise, streams, [this, sourceIndex](uint stream, BulkCommand* bulkCommand)
+            {
+                return m_Server->MoveSourceOutput(stream, sourceIndex, BulkCommandCallback, bulkCommand)
+                           ? PA_OK
+                           : m_Server->GetErrno();
+            });
+        });
+        return completion;
+    }
+
+    Completion SoundDeviceManager::SetPlaybackStreamVolume(const std::vector<uint>& streams, uint volume)
+    {
+        return SetStreamVolume(m_PlaybackStreams, streams, volume, &AudioServer::SetSinkInputVolume);
+    }
+
+    Completion SoundDeviceManager::SetRecordStreamVolume(const std::vector<uint>& streams, uint volume)
+    {
+        return SetStreamVolume(m_RecordStreams, streams, volume, &AudioServer::SetSourceOutputVolume);
+    }
+
+    Completion SoundDeviceManager::SetStreamVolume(StreamTable& streamTable, const std::vector<uint>& streams,
+                                                   uint volume,
+                                                   bool (AudioServer::*setVolume)(uint, const pa_cvolume*,
+                                                                                  pa_context_success_cb_t, void*))
+    {
+        auto promise = std::make_shared<std::promise<CommandResult>>();
+        auto completion = promise->get_future();
+        PostCommand([this, &streamTable, streams, volume, setVolume, promise]()
+        {
+            pa_volume_t paVolume = PercentToVolume(volume, GetVolumeCurve());
+            IssueBulkCommand(promise, streams,
+                             [this, &streamTable, paVolume, setVolume](uint stream, BulkCommand* bulkCommand)
+            {
+                // the channel layout comes from the registry, the balance of the stream is kept
+                auto record = streamTable.Find(stream);
+                if (!record)
+                {
+                    return static_cast<int>(PA_ERR_NOENTITY);
+                }
+                if (!record->m_HasVolume)
+                {
+                    return static_cast<int>(PA_ERR_NOTSUPPORTED);
+                }
+                pa_cvolume cVolume = record->m_CVolume;
+                pa_cvolume_scale(&cVolume, paVolume);
+                return ((*m_Server).*setVolume)(stream, &cVolume, BulkCommandCallback, bulkCommand)
+                           ? static_cast<int>(PA_OK)
+                           : m_Server->GetErrno();
+            });
+        });
+        return completion;
+    }
+
+    //
+    // pipelined: all operations are in flight at the same time, instead of one round trip per stream
+    //
+    void SoundDeviceManager::IssueBulkCommand(const Promise& promise, const std::vector<uint>& streams,
+                                              std::function<int(uint stream, BulkCommand* bulkCommand)> issue)
+    {
+        auto bulkCommand = new BulkCommand{this, 1, PA_OK, promise, std::chrono::steady_clock::now()};
+        for (auto stream : streams)
+        {
+            int error = issue(stream, bulkCommand);
+            if (error == PA_OK)
+            {
+                bulkCommand->m_Outstanding++;
+            }
+            else if (bulkCommand->m_Error == PA_OK)
+            {
+                bulkCommand->m_Error = error;
+            }
+        }
+
+        // drop the reference held while issuing the operations
+        CompleteBulkCommand(bulkCommand, true);
+    }
+
+    void SoundDeviceManager::BulkCommandCallback(pa_context* context, int success, void* userdata)
+    {
+        auto bulkCommand = static_cast<BulkCommand*>(userdata);
+        auto manager = bulkCommand->m_Manager;
+        ScopedLatency latency(manager->m_CallbackTime[Stats::OPERATION_SUCCESS]);
+        manager->CompleteBulkCommand(bulkCommand, success);
+    }
+
+    void SoundDeviceManager::CompleteBulkCommand(BulkCommand* bulkCommand, bool success)
+    {
+        if (!success && (bulkCommand->m_Error == PA_OK))
+        {
+            bulkCommand->m_Error = m_Server->GetErrno();
+        }
+        if (--bulkCommand->m_Outstanding > 0)
+        {
+            return;
+        }
+        m_OperationRoundTrip[Stats::STREAM_COMMAND].Record(bulkCommand->m_Start);
+        Complete(bulkCommand->m_Promise, bulkCommand->m_Error == PA_OK, bulkCommand->m_Error);
+        delete bulkCommand;
+    }
+
+    Completion SoundDeviceManager::SetCardProfile(uint card, const std::string& profile)
+    {
+        auto promise = std::make_shared<std::promise<CommandResult>>();
+        auto completion = promise->get_future();
+        PostCommand([this, card, profile, promise]()
+        {
+            auto cardRecord = m_CardTable.Find(card);
+            auto cardProfile = cardRecord ? cardRecord->FindProfile(profile) : nullptr;
+            if (!cardProfile)
+            {
+                Complete(promise, false, PA_ERR_NOENTITY);
+                return;
+            }
+
+            // the last request for a card wins
+            auto pending = m_ProfileSwitches.find(card);
+            if (pending != m_ProfileSwitches.end())
+            {
+                FinishProfileSwitch(pending->second, false, PA_ERR_KILLED);
+            }
+
+            auto profileSwitch = new ProfileSwitch{this,  card,  profile, cardProfile->m_Sinks, cardProfile->m_Sources,
+                                                   false, false, promise, std::chrono::steady_clock::now()};
+            if (!m_Server->SetCardProfileByIndex(card, profile.c_str(), SetCardProfileCallback, profileSwitch))
+            {
+                PRINT_ERROR("SetCardProfile: SetCardProfileByIndex() failed");
+                m_ProfileSwitchCount.fetch_add(1, std::memory_order_relaxed);
+                m_ProfileSwitchFailures.fetch_add(1, std::memory_order_relaxed);
+                Complete(promise, false, m_Server->GetErrno());
+                delete profileSwitch;
+                return;
+            }
+            m_ProfileSwitches[card] = profileSwitch;
+            ScheduleProfileSwitchTimeout();
+        });
+        return completion;
+    }
+
+    void SoundDeviceManager::SetCardProfileCallback(pa_context* context, int success, void* userdata)
+    {
+        auto profileSwitch = static_cast<ProfileSwitch*>(userdata);
+        auto manager = profileSwitch->m_Manager;
+        ScopedLatency latency(manager->m_CallbackTime[Stats::OPERATION_SUCCESS]);
+        manager->m_OperationRoundTrip[Stats::SET_CARD_PROFILE].Record(profileSwitch->m_Start);
+        manager->OnSetCardProfile(success, profileSwitch);
+    }
+
+    void SoundDeviceManager::OnSetCardProfile(bool success, ProfileSwitch* profileSwitch)
+    {
+        profileSwitch->m_Acknowledged = true;
+        if (profileSwitch->m_Finished)
+        {
+            // superseded or failed while in flight
+            delete profileSwitch;
+            return;
+        }
+        if (!success)
+        {
+            FinishProfileSwitch(profileSwitch, false, m_Server->GetErrno());
+            return;
+        }
+
+        // the devices may already be registered, the card change may still be on its way
+        CheckProfileSwitches();
+    }
+
+    //
+    // a switch is usable once the card reports the profile and its sinks and sources are in the registry
+    //
+    void SoundDeviceManager::CheckProfileSwitches()
+    {
+        std::vector<ProfileSwitch*> finished;
+        for (auto& pending : m_ProfileSwitches)
+        {
+            auto profileSwitch = pending.second;
+            auto card = m_CardTable.Find(profileSwitch->m_Card);
+            if (!profileSwitch->m_Acknowledged || !card || (card->m_ActiveProfile != profileSwitch->m_Profile))
+            {
+                continue;
+            }
+            uint sinks = 0;
+            uint sources = 0;
+            m_OutputDeviceTable.ForEach([&](const DeviceRecord& record)
+            {
+                sinks += record.m_Card == profileSwitch->m_Card ? 1 : 0;
+            });
+            m_InputDeviceTable.ForEach([&](const DeviceRecord& record)
+            {
+                sources += (record.m_Card == profileSwitch->m_Card) && (record.m_Monitor == PA_INVALID_INDEX) ? 1 : 0;
+            });
+            if ((sinks == profileSwitch->m_Sinks) && (sources == profileSwitch->m_Sources))
+            {
+                finished.push_back(profileSwitch);
+            }
+        }
+        for (auto profileSwitch : finished)
+        {
+            FinishProfileSwitch(profileSwitch, true, PA_OK);
+        }
+    }
 
-            return;
+    void SoundDeviceManager::FinishProfileSwitch(ProfileSwitch* profileSwitch, bool success, int error)
+    {
+        auto pending = m_ProfileSwitches.find(profileSwitch->m_Card);
+        if ((pending != m_ProfileSwitches.end()) && (pending->second == profileSwitch))
+        {
+            m_ProfileSwitches.erase(pending);
+        }
+
+        m_ProfileSwitchCount.fetch_add(1, std::memory_order_relaxed);
+        if (success)
+        {
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                                 profileSwitch->m_Start)
+                               .count();
+            m_LastProfileSwitchLatencyUs.store(latency, std::memory_order_relaxed);
+            m_TotalProfileSwitchLatencyUs.fetch_add(latency, std::memory_order_relaxed);
+            if (latency > m_MaxProfileSwitchLatencyUs.load(std::memory_order_relaxed))
+            {
+                m_MaxProfileSwitchLatencyUs.store(latency, std::memory_order_relaxed);
+            }
+        }
+        else
+        {
+            m_ProfileSwitchFailures.fetch_add(1, std::memory_order_relaxed);
+        }
+        Complete(profileSwitch->m_Promise, success, error);
+
+        // an operation still in flight deletes it when its reply arrives
+        profileSwitch->m_Finished = true;
+        if (profileSwitch->m_Acknowledged)
+        {
+            delete profileSwitch;
         }
     }
 
-    void SoundDeviceManager::Mainloop()
+    // one timer for all pending switches, armed for the oldest one
+    void SoundDeviceManager::ScheduleProfileSwitchTimeout()
     {
-        int ret;
-        if (pa_mainloop_iterate(m_Mainloop, 0, &ret) < 0)
+        if (m_ProfileSwitches.empty())
         {
-            PRINT_ERROR("Mainloop: pa_mainloop_run() failed.");
             return;
         }
-        std::this_thread::sleep_for(16ms);
+        auto oldest = std::chrono::steady_clock::time_point::max();
+        for (auto& pending : m_ProfileSwitches)
+        {
+            oldest = std::min(oldest, pending.second->m_Start);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - oldest);
+        pa_usec_t delay = PROFILE_SWITCH_TIMEOUT > static_cast<pa_usec_t>(elapsed.count())
+                              ? PROFILE_SWITCH_TIMEOUT - elapsed.count()
+                              : 0;
+        if (!m_ProfileSwitchTimer)
+        {
+            m_ProfileSwitchTimer = m_Server->NewTimer(delay, ProfileSwitchTimerCallback, this);
+        }
+        else
+        {
+            m_Server->RestartTimer(m_ProfileSwitchTimer, delay);
+        }
     }
 
-    void SoundDeviceManager::SetDefaultDevices()
+    void SoundDeviceManager::ProfileSwitchTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent,
+                                                        const struct timeval* tv, void* userdata)
+    {
+        auto manager = static_cast<SoundDeviceManager*>(userdata);
+        ScopedLatency latency(manager->m_CallbackTime[Stats::TIMER]);
+        auto now = std::chrono::steady_clock::now();
+        auto timeout = std::chrono::microseconds(PROFILE_SWITCH_TIMEOUT);
+
+        std::vector<ProfileSwitch*> expired;
+        for (auto& pending : manager->m_ProfileSwitches)
+        {
+            if (now - pending.second->m_Start >= timeout)
+            {
+                expired.push_back(pending.second);
+            }
+        }
+        for (auto profileSwitch : expired)
+        {
+            manager->FinishProfileSwitch(profileSwitch, false, PA_ERR_TIMEOUT);
+        }
+        manager->ScheduleProfileSwitchTimeout();
+    }
+
+    SoundDeviceManager::ProfileSwitchStatistics SoundDeviceManager::GetProfileSwitchStatistics() const
     {
-        pa_operation* operation = pa_context_get_server_info(m_Context, &ServerInfoCallback, nullptr);
-        pa_operation_unref(operation);
+        ProfileSwitchStatistics statistics;
+        statistics.m_Switches = m_ProfileSwitchCount.load(std::memory_order_relaxed);
+        statistics.m_Failures = m_ProfileSwitchFailures.load(std::memory_order_relaxed);
+        statistics.m_LastLatency =
+            std::chrono::microseconds(m_LastProfileSwitchLatencyUs.load(std::memory_order_relaxed));
+        statistics.m_MaxLatency = std::chrono::microseconds(m_MaxProfileSwitchLatencyUs.load(std::memory_order_relaxed));
+        statistics.m_TotalLatency =
+            std::chrono::microseconds(m_TotalProfileSwitchLatencyUs.load(std::memory_order_relaxed));
+        return statistics;
     }
 
-    std::string& SoundDeviceManager::GetDefaultOutputDevice() const
+    void SoundDeviceManager::EnableLevelMeters(bool enable)
     {
-        auto currentOutputDevice = m_DefaultDevices.m_OutputDeviceIndex;
-        return m_OutputDeviceDescriptions[currentOutputDevice];
+        PostCommand([this, enable]()
+        {
+            m_LevelMetersEnabled = enable;
+            if (enable)
+            {
+                SyncLevelMeters();
+            }
+            else
+            {
+                CloseLevelMeters();
+            }
+        });
     }
 
-    void SoundDeviceManager::SetDefaultVolume()
+    void SoundDeviceManager::SetLevelMeterRate(uint updatesPerSecond)
     {
-        auto index = std::to_string(m_OutputDeviceIndicies[m_DefaultDevices.m_OutputDeviceIndex]);
+        PostCommand([this, updatesPerSecond]()
+        {
+            m_LevelMeterRate = std::max(updatesPerSecond, 1u);
 
-        pa_operation* operation;
-        operation = pa_context_get_sink_info_by_name(m_Context, index.c_str(), GetSinkVolumeCallback, nullptr);
-        pa_operation_unref(operation);
+            // the streams are opened with their rate, reopen them
+            if (m_LevelMetersEnabled)
+            {
+                CloseLevelMeters();
+                SyncLevelMeters();
+            }
+        });
     }
 
-    uint SoundDeviceManager::GetVolume() const
+    SoundDeviceManager::LevelList SoundDeviceManager::GetLevels() const
     {
-        auto currentOutputDevice = m_DefaultDevices.m_OutputDeviceIndex;
-        return m_OutputDeviceVolumes[currentOutputDevice];
+        auto levels = std::atomic_load_explicit(&m_Levels, std::memory_order_acquire);
+        return levels ? levels : std::make_shared<const std::vector<DeviceLevel>>();
     }
 
-    void SoundDeviceManager::SetVolume(uint volume)
+    //
+    // one meter per sink monitor and per source that is not itself a monitor,
+    // opened and closed as the devices come and go
+    //
+    void SoundDeviceManager::SyncLevelMeters()
     {
-        if (volume > 100)
+        if (!m_LevelMetersEnabled || !m_Server || m_ConnectionLost)
         {
-            m_DefaultDevices.m_OutputDeviceVolumeRequest = 100;
-            PRINT_ERROR("SetVolume: Clamping output volume to 100. Permissible input range: 0 - 100");
+            return;
         }
-        else
+
+        // devices of a lost connection not found again yet have no PA index
+        std::unordered_map<uint, std::pair<DeviceHandle, bool>> sources;
+        m_OutputDeviceTable.ForEach([&sources](const DeviceRecord& record)
+        {
+            if ((record.m_PAIndex != PA_INVALID_INDEX) && (record.m_Monitor != PA_INVALID_INDEX))
+            {
+                sources[record.m_Monitor] = {record.m_Handle, true};
+            }
+        });
+        m_InputDeviceTable.ForEach([&sources](const DeviceRecord& record)
+        {
+            if ((record.m_PAIndex != PA_INVALID_INDEX) && (record.m_Monitor == PA_INVALID_INDEX))
+            {
+                sources[record.m_PAIndex] = {record.m_Handle, false};
+            }
+        });
+
+        for (auto levelMeter = m_LevelMeters.begin(); levelMeter != m_LevelMeters.end();)
+        {
+            if (!sources.count(levelMeter->first))
+            {
+                levelMeter = m_LevelMeters.erase(levelMeter);
+                m_LevelsChanged = true;
+            }
+            else
+            {
+                ++levelMeter;
+            }
+        }
+        for (auto& source : sources)
+        {
+            if (m_LevelMeters.count(source.first))
+            {
+                continue;
+            }
+            auto levelMeter = std::make_unique<LevelMeter>();
+            levelMeter->m_Source = source.first;
+            levelMeter->m_Device = source.second.first;
+            levelMeter->m_Output = source.second.second;
+            levelMeter->m_Level = {0.0f};
+            levelMeter->m_IdleUpdates = 0;
+            levelMeter->m_Ended = false;
+            levelMeter->m_Failures = 0;
+            levelMeter->m_ReopenIn = 0;
+            if (!OpenLevelMeter(*levelMeter))
+            {
+                continue;
+            }
+            m_LevelMeters[source.first] = std::move(levelMeter);
+            m_LevelsChanged = true;
+        }
+
+        PublishLevels();
+        if (!m_LevelMeters.empty() && !m_LevelTimerScheduled)
+        {
+            m_LevelTimerScheduled = true;
+            pa_usec_t interval = PA_USEC_PER_SEC / m_LevelMeterRate;
+            if (!m_LevelTimer)
+            {
+                m_LevelTimer = m_Server->NewTimer(interval, LevelTimerCallback, this);
+            }
+            else
+            {
+                m_Server->RestartTimer(m_LevelTimer, interval);
+            }
+        }
+    }
+
+    bool SoundDeviceManager::OpenLevelMeter(LevelMeter& levelMeter)
+    {
+        levelMeter.m_Stream = m_Server->OpenPeakStream(levelMeter.m_Source, m_LevelMeterRate * PEAKS_PER_LEVEL_UPDATE,
+                                                       PEAKS_PER_LEVEL_UPDATE, LevelMeterCallback,
+                                                       LevelMeterEndedCallback, &levelMeter);
+        if (!levelMeter.m_Stream)
+        {
+            PRINT_ERROR("OpenLevelMeter: OpenPeakStream() failed");
+            return false;
+        }
+        return true;
+    }
+
+    void SoundDeviceManager::CloseLevelMeters()
+    {
+        if (m_LevelMeters.empty())
+        {
+            return;
+        }
+        m_LevelMeters.clear();
+        m_LevelsChanged = true;
+        PublishLevels();
+    }
+
+    void SoundDeviceManager::LevelMeterCallback(const float* samples, size_t count, void* userdata)
+    {
+        static_cast<LevelMeter*>(userdata)->m_Accumulator.Add(samples, count);
+    }
+
+    // the stream is still in its callback, UpdateLevels() replaces it
+    void SoundDeviceManager::LevelMeterEndedCallback(void* userdata)
+    {
+        static_cast<LevelMeter*>(userdata)->m_Ended = true;
+    }
+
+    void SoundDeviceManager::LevelTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent,
+                                                const struct timeval* tv, void* userdata)
+    {
+        auto manager = static_cast<SoundDeviceManager*>(userdata);
+        ScopedLatency latency(manager->m_CallbackTime[Stats::TIMER]);
+        manager->m_LevelTimerScheduled = false;
+        if (manager->m_LevelMeters.empty())
         {
-            m_DefaultDevices.m_OutputDeviceVolumeRequest = volume;
+            return;
         }
-        auto index = std::to_string(m_OutputDeviceIndicies[m_DefaultDevices.m_OutputDeviceIndex]);
+        manager->UpdateLevels();
+        manager->m_LevelTimerScheduled = true;
+        manager->m_Server->RestartTimer(timeEvent, PA_USEC_PER_SEC / manager->m_LevelMeterRate);
+    }
+
+    //
+    // once per update: the peaks received since the last one make the new level; a stream the server
+    // ended, e.g. killed with pactl, is reopened with a delay that doubles while it keeps failing,
+    // the meter of a source that went away is removed by SyncLevelMeters()
+    //
+    void SoundDeviceManager::UpdateLevels()
+    {
+        for (auto& levelMeter : m_LevelMeters)
+        {
+            auto& meter = *levelMeter.second;
+            if (meter.m_Ended)
+            {
+                meter.m_Stream.reset();
+                meter.m_Ended = false;
+                meter.m_ReopenIn = std::min(1u << std::min(meter.m_Failures, 6u), MAX_LEVEL_METER_REOPEN_DELAY);
+                meter.m_Failures++;
+            }
+            else if (!meter.m_Stream && (--meter.m_ReopenIn == 0) && !OpenLevelMeter(meter))
+            {
+                meter.m_ReopenIn = MAX_LEVEL_METER_REOPEN_DELAY;
+            }
 
-        pa_operation* operation;
-        operation = pa_context_get_sink_info_by_name(m_Context, index.c_str(), SetSinkVolumeCallback, nullptr);
-        pa_operation_unref(operation);
+            Level level = meter.m_Level;
+            if (!meter.m_Accumulator.IsEmpty())
+            {
+                level = meter.m_Accumulator.GetLevel();
+                meter.m_Accumulator.Reset();
+                meter.m_IdleUpdates = 0;
+                meter.m_Failures = 0;
+            }
+            else if (++meter.m_IdleUpdates >= 2)
+            {
+                // a suspended device delivers no peaks
+                level = {0.0f};
+            }
+            if (level.m_Peak != meter.m_Level.m_Peak)
+            {
+                meter.m_Level = level;
+                m_LevelsChanged = true;
+            }
+        }
+        PublishLevels();
     }
 
-    void SoundDeviceManager::CycleNextOutputDevice()
+    //
+    // the list is rebuilt only when a level or the set of meters changed, silence costs no allocation
+    //
+    void SoundDeviceManager::PublishLevels()
     {
-        auto outputDevice = m_DefaultDevices.m_OutputDeviceIndex;
-        outputDevice++;
-        if (outputDevice == m_OutputDeviceNames.size())
+        if (!m_LevelsChanged)
+        {
+            return;
+        }
+        m_LevelsChanged = false;
+
+        auto levels = std::make_shared<std::vector<DeviceLevel>>();
+        levels->reserve(m_LevelMeters.size());
+        for (auto& levelMeter : m_LevelMeters)
         {
-            outputDevice = 0;
+            levels->push_back({levelMeter.second->m_Device, levelMeter.second->m_Output, levelMeter.second->m_Level});
         }
-        SetOutputDevice(outputDevice);
+        std::atomic_store_explicit(&m_Levels, LevelList(std::move(levels)), std::memory_order_release);
     }
 
+    Completion SoundDeviceManager::CycleNextOutputDevice()
+    {
+        auto promise = std::make_shared<std::promise<CommandResult>>();
+        auto completion = promise->get_future();
+        PostCommand([this, promise]()
+        {
+            auto outputDevice = m_OutputDeviceTable.Next(m_DefaultDevices.m_OutputDevice);
+            if (!outputDevice.IsValid())
+            {
+                Complete(promise, false, PA_ERR_NOENTITY);
+                return;
+            }
+            ApplyOutputDevice(outputDevice, promise);
+        });
+        return completion;
+    }
+
+    //
+    // the callback is replaced as a whole, the thread that delivers events reads it without a lock
+    //
     void SoundDeviceManager::SetCallback(std::function<void(const Event& eventType)> callback)
     {
-        m_ApplicationEventCallback = callback;
+        auto eventCallback = std::make_shared<const EventCallback>(callback ? std::move(callback)
+                                                                            : EventCallback(DummyAppEventCallback));
+        std::atomic_store_explicit(&m_ApplicationEventCallback, std::move(eventCallback), std::memory_order_release);
     }
 
     // use SetCallback to replace this function
     void SoundDeviceManager::DummyAppEventCallback(const Event&) {}
 
-    void SoundDeviceManager::PulseAudioThread()
+    //
+    // deliver an event, in queue mode the PA thread never waits on application code
+    //
+    void SoundDeviceManager::RaiseEvent(const Event& event)
+    {
+        if (m_ShuttingDown)
+        {
+            // the failure callbacks of the requests cancelled by Disconnect()
+            return;
+        }
+        if (m_EventDelivery == EventDelivery::CALLBACK)
+        {
+            auto callback = std::atomic_load_explicit(&m_ApplicationEventCallback, std::memory_order_acquire);
+            ScopedLatency latency(m_ApplicationCallbackTime);
+            (*callback)(event);
+            return;
+        }
+        if (!m_EventQueue.Push(event))
+        {
+            m_EventOverflows.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    //
+    // the changes of the device tables since the last list changed events, collected on the PA thread,
+    // so a receiver does not have to compare the whole lists; during startup the differences to the
+    // device cache are reported instead; called after PublishSnapshot(), so a receiver of an added
+    // event finds the device in GetSnapshot()
+    //
+    void SoundDeviceManager::RaiseDeviceListChanges()
+    {
+        if (m_StartupPending)
+        {
+            return;
+        }
+        auto outputDevices = m_OutputDeviceTable.TakeChanges();
+        for (auto& record : outputDevices.m_Added)
+        {
+            RaiseEvent(Event(Event::OUTPUT_DEVICE_ADDED, record.m_Handle));
+        }
+        if (!outputDevices.IsEmpty())
+        {
+            RaiseEvent(Event(Event::OUTPUT_DEVICE_LIST_CHANGED,
+                             std::make_shared<const DeviceListChange>(std::move(outputDevices))));
+        }
+        auto inputDevices = m_InputDeviceTable.TakeChanges();
+        for (auto& record : inputDevices.m_Added)
+        {
+            RaiseEvent(Event(Event::INPUT_DEVICE_ADDED, record.m_Handle));
+        }
+        if (!inputDevices.IsEmpty())
+        {
+            RaiseEvent(Event(Event::INPUT_DEVICE_LIST_CHANGED,
+                             std::make_shared<const DeviceListChange>(std::move(inputDevices))));
+        }
+    }
+
+    // single consumer: call from one application thread only
+    bool SoundDeviceManager::PollEvent(Event& event)
+    {
+        return m_EventQueue.Pop(event);
+    }
+
+    // run the callback on the calling thread for all queued events
+    size_t SoundDeviceManager::DispatchEvents()
     {
-        // Create a mainloop API and connection to the default server
-        m_Mainloop = pa_mainloop_new();
-        m_MainloopAPI = pa_mainloop_get_api(m_Mainloop);
-        m_Context = pa_context_new(m_MainloopAPI, "Device list");
+        size_t numberOfEvents = 0;
+        Event event;
+        auto callback = std::atomic_load_explicit(&m_ApplicationEventCallback, std::memory_order_acquire);
+        while (m_EventQueue.Pop(event))
+        {
+            ScopedLatency latency(m_ApplicationCallbackTime);
+            (*callback)(event);
+            numberOfEvents++;
+        }
+        return numberOfEvents;
+    }
 
-        // This function connects to the pulse audio server
-        pa_context_connect(m_Context, nullptr, (pa_context_flags_t)0, nullptr);
+    void SoundDeviceManager::Connect()
+    {
+        if (!m_Server)
+        {
+            m_Server = std::make_unique<PulseAudioServer>();
+        }
+        m_Server->SetMainloopAPI(m_EventLoop->GetAPI());
+        m_Server->SetOperationCounters(&m_OperationCounters);
+        m_Server->SetMaxOperations(m_MaxOperations.load(std::memory_order_relaxed));
+        for (int type = 0; type < static_cast<int>(OperationType::TYPES); type++)
+        {
+            pa_usec_t timeout = m_OperationTimeouts[type].load(std::memory_order_relaxed);
+            if (timeout)
+            {
+                m_Server->SetOperationTimeout(static_cast<OperationType>(type), timeout);
+            }
+        }
 
-        // This function defines a callback so the server will tell us its state
-        pa_context_set_state_callback(m_Context, ContextStateCallback, nullptr);
+        // the server will tell us its state
+        const char* server = m_ServerAddress.empty() ? nullptr : m_ServerAddress.c_str();
+        if (!m_Server->Connect(server, ContextStateCallback, this))
+        {
+            PRINT_ERROR("Connect: failed to connect to the sound server");
+        }
+    }
 
-        while (true)
+    void SoundDeviceManager::Disconnect()
+    {
+        if (!m_Server)
+        {
+            return;
+        }
+        // the requests cancelled below complete with their failure callbacks, which must not
+        // publish or notify anything anymore
+        m_ShuttingDown = true;
+        AbortConnection(PA_ERR_CONNECTIONTERMINATED);
+        for (auto timer : {&m_RefreshTimer, &m_StartupTimer, &m_CacheStoreTimer, &m_VolumeRampTimer, &m_LevelTimer,
+                           &m_ProfileSwitchTimer, &m_ReconnectTimer})
+        {
+            if (*timer)
+            {
+                m_Server->FreeTimer(*timer);
+                *timer = nullptr;
+            }
+        }
+        m_Server.reset();
+    }
+
+    //
+    // no reply will come for the requests in flight, their callbacks clean up; everything
+    // else that lives on the connection is dropped
+    //
+    void SoundDeviceManager::AbortConnection(int error)
+    {
+        m_Server->CancelOperations(error);
+        StopVolumeRamp(error);
+        CloseLevelMeters(); // the streams belong to the connection
+
+        // switches acknowledged by the server that still wait for their devices
+        std::vector<ProfileSwitch*> profileSwitches;
+        for (auto& pending : m_ProfileSwitches)
+        {
+            profileSwitches.push_back(pending.second);
+        }
+        for (auto profileSwitch : profileSwitches)
+        {
+            profileSwitch->m_Acknowledged = true;
+            FinishProfileSwitch(profileSwitch, false, error);
+        }
+
+        for (auto& pendingVolumeRequests : m_PendingVolumeRequests)
+        {
+            for (auto& promise : pendingVolumeRequests.second)
+            {
+                Complete(promise, false, error);
+            }
+        }
+        m_PendingVolumeRequests.clear();
+    }
+
+    //
+    // the server went away, e.g. it was restarted: the registry stays with the readers, marked stale,
+    // until the startup queries of the new connection have resynced it
+    //
+    void SoundDeviceManager::OnConnectionLost()
+    {
+        if (m_ConnectionLost)
+        {
+            // a reconnect attempt failed
+            ScheduleReconnect();
+            return;
+        }
+        PRINT_ERROR("OnConnectionLost: lost the connection to the sound server, reconnecting");
+        m_ConnectionLost = true;
+        m_ConnectionLostTime = std::chrono::steady_clock::now();
+        AbortConnection(PA_ERR_CONNECTIONTERMINATED);
+
+        // pending subscription events refer to PA indices of the lost connection
+        m_DirtySinks.clear();
+        m_DirtySources.clear();
+        m_DirtySinkInputs.clear();
+        m_DirtySourceOutputs.clear();
+        m_DirtyCards.clear();
+
+        // a connection lost during the resync is compared with the state before the first loss;
+        // before the first startup completed there is nothing to compare with
+        if (m_Ready && !m_Resync)
+        {
+            m_Resync = true;
+            m_ResyncTopology = CaptureTopology();
+            m_ResyncPlaybackStreams = m_PlaybackStreams.Publish();
+            m_ResyncRecordStreams = m_RecordStreams.Publish();
+            m_ResyncCards = m_CardTable.Publish();
+        }
+        m_OutputDeviceTable.Detach();
+        m_InputDeviceTable.Detach();
+        PublishSnapshot();
+
+        RaiseEvent(Event(Event::CONNECTION_LOST));
+        ScheduleReconnect();
+    }
+
+    //
+    // jittered exponential backoff: half of the delay is random, so that the clients of a
+    // restarted server do not all come back at the same time
+    //
+    void SoundDeviceManager::ScheduleReconnect()
+    {
+        if (m_ReconnectScheduled)
+        {
+            return;
+        }
+        m_ReconnectScheduled = true;
+
+        pa_usec_t delay = std::min(RECONNECT_MIN_DELAY << std::min(m_ReconnectAttempt, 16u), RECONNECT_MAX_DELAY);
+        delay = delay / 2 + std::uniform_int_distribution<pa_usec_t>(0, delay / 2)(m_ReconnectJitter);
+        m_ReconnectAttempt++;
+        if (!m_ReconnectTimer)
+        {
+            m_ReconnectTimer = m_Server->NewTimer(delay, ReconnectTimerCallback, this);
+        }
+        else
+        {
+            m_Server->RestartTimer(m_ReconnectTimer, delay);
+        }
+    }
+
+    void SoundDeviceManager::ReconnectTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent,
+                                                    const struct timeval* tv, void* userdata)
+    {
+        auto manager = static_cast<SoundDeviceManager*>(userdata);
+        ScopedLatency latency(manager->m_CallbackTime[Stats::TIMER]);
+        manager->m_ReconnectScheduled = false;
+        manager->Reconnect();
+    }
+
+    void SoundDeviceManager::Reconnect()
+    {
+        LOG_INFO("Reconnect: attempt %u", m_ReconnectAttempt);
+        m_ReconnectAttempts.fetch_add(1, std::memory_order_relaxed);
+        const char* server = m_ServerAddress.empty() ? nullptr : m_ServerAddress.c_str();
+        if (!m_Server->Connect(server, ContextStateCallback, this))
         {
-            Mainloop();
+            PRINT_ERROR("Reconnect: failed to connect to the sound server");
+            ScheduleReconnect();
         }
     }
 
+    //
+    // after the startup queries of a new connection: report only what differs from the lost one;
+    // the devices found again have kept their handles, streams and cards are compared by content
+    //
+    void SoundDeviceManager::CompleteResync()
+    {
+        ReconcileTopology(m_ResyncTopology, true);
+
+        auto streamKeys = [](const StreamTable::StreamList& streams)
+        {
+            std::vector<std::tuple<std::string, std::string, uint>> keys;
+            if (streams)
+            {
+                for (auto& stream : *streams)
+                {
+                    keys.emplace_back(stream.m_Application, stream.m_Name, stream.m_Volume);
+                }
+            }
+            std::sort(keys.begin(), keys.end());
+            return keys;
+        };
+        auto cardKeys = [](const CardTable::CardList& cards)
+        {
+            std::vector<std::pair<std::string, std::string>> keys;
+            if (cards)
+            {
+                for (auto& card : *cards)
+                {
+                    keys.emplace_back(card.m_Name, card.m_ActiveProfile);
+                }
+            }
+            std::sort(keys.begin(), keys.end());
+            return keys;
+        };
+        m_PlaybackStreamsChanged = streamKeys(m_ResyncPlaybackStreams) != streamKeys(m_PlaybackStreams.Publish());
+        m_RecordStreamsChanged = streamKeys(m_ResyncRecordStreams) != streamKeys(m_RecordStreams.Publish());
+        m_CardsChanged = cardKeys(m_ResyncCards) != cardKeys(m_CardTable.Publish());
+        m_ResyncPlaybackStreams.reset();
+        m_ResyncRecordStreams.reset();
+        m_ResyncCards.reset();
+
+        m_Reconnects.fetch_add(1, std::memory_order_relaxed);
+        m_OperationRoundTrip[Stats::RECONNECT].Record(m_ConnectionLostTime);
+    }
+
+    void SoundDeviceManager::SetAudioServer(std::unique_ptr<AudioServer> server)
+    {
+        m_Server = std::move(server);
+    }
+
     std::string Event::PrintType() const
     {
         switch (m_EventType)
@@ -605,6 +2808,24 @@ namespace LibPAmanager
                 return "OUTPUT_DEVICE_LIST_CHANGED";
             case INPUT_DEVICE_LIST_CHANGED:
                 return "INPUT_DEVICE_LIST_CHANGED";
+            case OUTPUT_DEVICE_ADDED:
+                return "OUTPUT_DEVICE_ADDED";
+            case OUTPUT_DEVICE_REMOVED:
+                return "OUTPUT_DEVICE_REMOVED";
+            case INPUT_DEVICE_ADDED:
+                return "INPUT_DEVICE_ADDED";
+            case INPUT_DEVICE_REMOVED:
+                return "INPUT_DEVICE_REMOVED";
+            case PLAYBACK_STREAM_LIST_CHANGED:
+                return "PLAYBACK_STREAM_LIST_CHANGED";
+            case RECORD_STREAM_LIST_CHANGED:
+                return "RECORD_STREAM_LIST_CHANGED";
+            case CARD_LIST_CHANGED:
+                return "CARD_LIST_CHANGED";
+            case CONNECTION_LOST:
+                return "CONNECTION_LOST";
+            case CONNECTION_RESTORED:
+                return "CONNECTION_RESTORED";
             default:
                 return "invalid event";
         }
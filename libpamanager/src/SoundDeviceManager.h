@@ -22,88 +22,572 @@
 
 #pragma once
 
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <functional>
 #include <pulse/pulseaudio.h>
 
+#include "AudioServer.h"
+#include "CardTable.h"
+#include "DeviceCache.h"
+#include "DeviceTable.h"
+#include "EventLoop.h"
+#include "LevelMeter.h"
+#include "RingBuffer.h"
+#include "Statistics.h"
+#include "StreamTable.h"
+#include "VolumeCurve.h"
+#include "VolumeRamp.h"
+
 namespace LibPAmanager
 {
+    // outcome of a command, delivered once the server has acknowledged it
+    struct CommandResult
+    {
+        bool m_Success;
+        int m_Error; // PA_OK or a pa_error_code
+        std::chrono::steady_clock::time_point m_Timestamp;
+    };
+    using Completion = std::future<CommandResult>;
+
     class Event;
+
+    //
+    // device registry and controls for one PulseAudio server; all state is per instance,
+    // managers that share an EventLoop are driven by the same thread
+    //
     class SoundDeviceManager
     {
     public:
+        using Backend = EventLoop::Backend;
+
+        // immutable view of the device registry, published by the PA thread; the device strings are
+        // interned, their views stay valid beyond the snapshot
+        struct Snapshot
+        {
+            std::vector<std::string_view> m_InputDevices;
+            std::vector<std::string_view> m_OutputDevices;
+            std::vector<DeviceRecord> m_InputDeviceRecords;
+            std::vector<DeviceRecord> m_OutputDeviceRecords;
+            DeviceHandle m_DefaultOutputDeviceHandle;
+            std::string_view m_DefaultOutputDevice;
+            uint m_OutputDeviceVolume;
+            pa_cvolume m_OutputDeviceCVolume;
+            pa_channel_map m_OutputDeviceChannelMap;
+            StreamTable::StreamList m_PlaybackStreams;
+            StreamTable::StreamList m_RecordStreams;
+            CardTable::CardList m_Cards;
+            bool m_Stale = false; // from the device cache or a lost connection, not yet confirmed by the server
+        };
+        using DeviceList = std::shared_ptr<const std::vector<std::string_view>>;
+        using StreamList = StreamTable::StreamList;
+        using CardList = CardTable::CardList;
+
+        enum class EventDelivery
+        {
+            CALLBACK, // the callback runs on the PA thread for every event
+            QUEUE     // events are queued, the application calls PollEvent() or DispatchEvents()
+        };
+
+        using LockStatistics = EventLoop::LockStatistics;
+
+        // latency from the request until the card has switched and the sinks and sources of the profile are registered
+        struct ProfileSwitchStatistics
+        {
+            uint64_t m_Switches;
+            uint64_t m_Failures;
+            std::chrono::microseconds m_LastLatency;
+            std::chrono::microseconds m_MaxLatency;
+            std::chrono::microseconds m_TotalLatency;
+        };
+
+        // level of a sink (measured on its monitor source) or of a source
+        struct DeviceLevel
+        {
+            DeviceHandle m_Device;
+            bool m_Output;
+            Level m_Level;
+        };
+        using LevelList = std::shared_ptr<const std::vector<DeviceLevel>>;
+
+        struct CoalescingStatistics
+        {
+            uint64_t m_SubscriptionEvents; // sink/source new and change events received
+            uint64_t m_Refreshes;          // batched refreshes issued
+            uint64_t m_RoundTrips;         // server queries issued by those refreshes
+            uint64_t m_RoundTripsSaved;    // compared to one query set per event
+        };
+
+        struct OperationStatistics
+        {
+            uint64_t m_InFlight;    // server requests waiting for their reply
+            uint64_t m_MaxInFlight;
+            uint64_t m_Issued;
+            uint64_t m_TimedOut;    // failed with PA_ERR_TIMEOUT
+            uint64_t m_Superseded;  // failed with PA_ERR_KILLED by a newer request for the same target
+            uint64_t m_Rejected;    // refused over the in-flight cap or while disconnecting
+            uint64_t m_Cancelled;   // failed when the connection ended
+        };
+
+        // counters and latency histograms, cheap enough to stay enabled in release builds
+        struct Stats
+        {
+            enum Operation
+            {
+                SET_DEFAULT_SINK,
+                SET_SINK_VOLUME,
+                STREAM_COMMAND,   // bulk moves and volume changes, until the last reply
+                SET_CARD_PROFILE, // until the server acknowledged it
+                REFRESH,          // coalesced refresh, until the last reply
+                STARTUP,          // startup queries, until the last reply
+                RECONNECT,        // from the loss of the connection until the registry is resynced
+                OPERATIONS
+            };
+            enum Callback
+            {
+                SERVER_INFO,
+                SINK_INFO,
+                SOURCE_INFO,
+                SINK_INPUT_INFO,
+                SOURCE_OUTPUT_INFO,
+                CARD_INFO,
+                SUBSCRIPTION_EVENT,
+                CONTEXT_STATE,
+                OPERATION_SUCCESS,
+                TIMER,
+                CALLBACKS
+            };
+
+            LatencyStatistics m_OperationRoundTrip[OPERATIONS];
+            LatencyStatistics m_CallbackTime[CALLBACKS]; // time spent in the static libpulse callbacks
+            LatencyStatistics m_MainloopIteration;       // of the event loop, not available for THREADED_MAINLOOP
+            LatencyStatistics m_ApplicationCallback;     // event callbacks of the application
+            CoalescingStatistics m_Coalescing;
+            OperationStatistics m_Operations;
+            uint64_t m_EventOverflows;
+            uint64_t m_Reconnects;        // connections restored and resynced
+            uint64_t m_ReconnectAttempts;
+            size_t m_OutputDevices;
+            size_t m_InputDevices;
+            size_t m_PlaybackStreams;
+            size_t m_RecordStreams;
+            size_t m_Cards;
+
+            static const char* GetName(Operation operation);
+            static const char* GetName(Callback callback);
+            std::string ToJSON() const;
+        };
+
+    public:
+        // server: a PulseAudio server string such as "unix:/run/user/1000/pulse/native", empty for the default;
+        // eventLoop: nullptr selects the process-wide event loop of the backend passed to Start()
+        explicit SoundDeviceManager(const std::string& server = std::string(),
+                                    std::shared_ptr<EventLoop> eventLoop = nullptr);
+        ~SoundDeviceManager(); // do not destroy a manager from its event loop thread
+        SoundDeviceManager(const SoundDeviceManager&) = delete;
+        SoundDeviceManager& operator=(const SoundDeviceManager&) = delete;
+
+        // process-wide manager for the default server
         static SoundDeviceManager* GetInstance();
-        void Start();
+
+        // the backend is ignored when the manager was given an event loop; only the first call has an effect
+        void Start(Backend backend = Backend::MAINLOOP, EventDelivery eventDelivery = EventDelivery::CALLBACK);
         uint GetVolume() const;
-        void SetVolume(uint volume);
-        void CycleNextOutputDevice();
+        Completion SetVolume(uint volume);
+        Completion CycleNextOutputDevice();
+
+        // per-channel volumes of the default output device, in the order of its channel map
+        Completion SetChannelVolumes(const std::vector<uint>& volumes);
+        std::vector<uint> GetChannelVolumes() const;
+        // -1.0 left ... 0.0 center ... 1.0 right, the overall volume is kept
+        Completion SetBalance(float balance);
+        float GetBalance() const;
+        // applies to all percent values of the API
+        void SetVolumeCurve(VolumeCurve curve);
+        VolumeCurve GetVolumeCurve() const { return m_VolumeCurve.load(std::memory_order_relaxed); }
+
+        // fades the default output device to volume (percent of the volume curve) on the event loop thread,
+        // the fade itself is linear on the percent scale of curve; a new ramp retargets a running one from
+        // where it is, SetVolume(), SetChannelVolumes() and SetBalance() cancel it;
+        // completes when the server has the target, fails with PA_ERR_KILLED when cancelled
+        Completion RampVolume(uint volume, std::chrono::milliseconds duration, VolumeCurve curve = VolumeCurve::DECIBEL);
+        void CancelVolumeRamp();
+        // upper bound of the volume updates a ramp sends to the server, default 50
+        void SetVolumeRampRate(uint updatesPerSecond);
+
+        // application streams by PA index: sink inputs (playback) and source outputs (record)
+        StreamList GetPlaybackStreams() const;
+        StreamList GetRecordStreams() const;
+        // the operations for all streams are issued at once, the completion follows the last
+        // reply and carries the first error
+        Completion MovePlaybackStreams(const std::vector<uint>& streams, DeviceHandle outputDevice);
+        Completion MoveRecordStreams(const std::vector<uint>& streams, DeviceHandle inputDevice);
+        Completion SetPlaybackStreamVolume(const std::vector<uint>& streams, uint volume);
+        Completion SetRecordStreamVolume(const std::vector<uint>& streams, uint volume);
+
+        // sound cards by PA index, with their profiles and ports
+        CardList GetCards() const;
+        // completes when the card has switched and the sinks and sources of the profile are in the registry,
+        // fails with PA_ERR_TIMEOUT if they did not appear in time and with PA_ERR_KILLED when superseded
+        Completion SetCardProfile(uint card, const std::string& profile);
+        ProfileSwitchStatistics GetProfileSwitchStatistics() const;
+
+        // level meters on all sinks and sources: peak detect record streams opened by the server at a low rate;
+        // GetLevels() does not block, the list is replaced at most updatesPerSecond times per second
+        void EnableLevelMeters(bool enable);
+        void SetLevelMeterRate(uint updatesPerSecond); // default 20
+        LevelList GetLevels() const;
+
         void PrintInputDeviceList() const;
         void PrintOutputDeviceList() const;
-        bool IsReady() const { return m_Ready; }
-        std::string& GetDefaultOutputDevice() const;
-        std::vector<std::string>& GetInputDeviceList();
-        std::vector<std::string>& GetOutputDeviceList();
-        void SetOutputDevice(const std::string& description);
+        bool IsReady() const { return m_Ready.load(std::memory_order_acquire); }
+        bool WaitUntilReady(std::chrono::milliseconds timeout) const;
+        std::chrono::microseconds GetTimeToReady() const; // negative until ready
+        void SetStartupTimeout(std::chrono::milliseconds timeout);
+        std::string_view GetDefaultOutputDevice() const;
+        DeviceList GetInputDeviceList() const;
+        DeviceList GetOutputDeviceList() const;
+        std::shared_ptr<const Snapshot> GetSnapshot() const;
+        Completion SetOutputDevice(std::string_view description);
+        Completion SetOutputDevice(DeviceHandle outputDevice);
+        // from any thread, also after Start(); a callback already running completes with the old function
         void SetCallback(std::function<void(const Event&)> callback);
+        bool PollEvent(Event& event);
+        size_t DispatchEvents();
+        uint64_t GetEventOverflowCount() const { return m_EventOverflows.load(std::memory_order_relaxed); }
+        LockStatistics GetLockStatistics() const;
+        CoalescingStatistics GetCoalescingStatistics() const;
+        OperationStatistics GetOperationStatistics() const;
+        Stats GetStats() const;
+        void SetCoalescingWindow(std::chrono::microseconds window);
+
+        // requests that miss the deadline of their type are cancelled and fail with PA_ERR_TIMEOUT, beyond
+        // maxOperations in flight new requests fail with PA_ERR_BUSY; take effect at the next connection
+        void SetOperationTimeout(OperationType type, std::chrono::milliseconds timeout);
+        void SetMaxOperationsInFlight(uint maxOperations);
+
+        // keep the last known devices in this file and show them at Start(); call before Start()
+        void SetDeviceCacheFile(const std::string& filename);
+
+        // replace the libpulse backend, e.g. with a MockAudioServer; call before Start()
+        void SetAudioServer(std::unique_ptr<AudioServer> server);
+
+        const std::string& GetServer() const { return m_ServerAddress; }
 
     private:
-        SoundDeviceManager();
-        void PulseAudioThread();
-
-        static void Mainloop();
-        static void SetDefaultVolume();
-        static void SetDefaultDevices();
-        static void RemoveInputDevice(uint index);
-        static void RemoveOutputDevice(uint index);
+        using Promise = std::shared_ptr<std::promise<CommandResult>>;
+
+        // introspection queries of one refresh, the last one to finish completes the refresh;
+        // the startup batch also carries the server info and the subscription
+        struct RefreshBatch
+        {
+            SoundDeviceManager* m_Manager;
+            uint m_Outstanding;
+            bool m_Startup;
+            bool m_Devices; // sinks or sources were refreshed, the server info follows
+            std::chrono::steady_clock::time_point m_Start;
+        };
+
+        // callers waiting for the same server operation, passed as userdata
+        struct PendingCommand
+        {
+            SoundDeviceManager* m_Manager;
+            uint m_Index;
+            std::vector<Promise> m_Promises;
+            std::chrono::steady_clock::time_point m_Start;
+        };
+
+        // a card profile switch, acknowledged by the server and finished when its devices are registered
+        // or it failed; the one of the two that comes last deletes it
+        struct ProfileSwitch
+        {
+            SoundDeviceManager* m_Manager;
+            uint m_Card;
+            std::string m_Profile;
+            uint m_Sinks;
+            uint m_Sources;
+            bool m_Acknowledged;
+            bool m_Finished;
+            Promise m_Promise;
+            std::chrono::steady_clock::time_point m_Start;
+        };
+
+        // peak detect stream of one metered source, the peaks are collected until the next publish
+        struct LevelMeter
+        {
+            uint m_Source;
+            DeviceHandle m_Device;
+            bool m_Output;
+            std::unique_ptr<PeakStream> m_Stream;
+            LevelAccumulator m_Accumulator;
+            Level m_Level;
+            uint m_IdleUpdates; // updates without peaks, the level drops to zero after two
+            bool m_Ended;       // the server ended the stream, it is reopened after m_ReopenIn updates
+            uint m_Failures;    // ended since the last peaks, doubles the delay of the next reopen
+            uint m_ReopenIn;
+        };
+
+        // operations issued together for one caller, the last reply completes the promise
+        struct BulkCommand
+        {
+            SoundDeviceManager* m_Manager;
+            uint m_Outstanding;
+            int m_Error; // the first error
+            Promise m_Promise;
+            std::chrono::steady_clock::time_point m_Start;
+        };
+
+    private:
+        void Connect();
+        void Disconnect();
+        void PostCommand(std::function<void()> command);
+        void SetDefaultVolume();
+        void SetDefaultDevices();
+        void ResolveDefaultDevices();
+        void CompleteStartup();
+        void PublishSnapshot();
+        void PublishCachedSnapshot();
+        void ReconcileTopology(DeviceCache::Topology& topology, bool resync);
+        DeviceCache::Topology CaptureTopology() const;
+        void ScheduleCacheStore();
+        void StoreCache();
+        void ScheduleRefresh();
+        void FlushRefresh();
+        void CompleteRefresh(RefreshBatch* batch);
+        void RaiseEvent(const Event& event);
+        void RaiseDeviceListChanges();
+        void ApplyOutputDevice(DeviceHandle outputDevice, Promise promise);
+        void FailPendingVolumeRequests(uint index);
+        void AddOutputDevice(const pa_sink_info* info);
+        void AddInputDevice(const pa_source_info* info);
+        void RequestSinkVolume(const Promise& promise, std::function<bool(pa_cvolume&, const DeviceRecord&)> update);
+        void SendSinkVolume(DeviceRecord* outputDevice);
+        void StepVolumeRamp();
+        void IssueBulkCommand(const Promise& promise, const std::vector<uint>& streams,
+                              std::function<int(uint stream, BulkCommand* bulkCommand)> issue);
+        void CompleteBulkCommand(BulkCommand* bulkCommand, bool success);
+        Completion SetStreamVolume(StreamTable& streamTable, const std::vector<uint>& streams, uint volume,
+                                   bool (AudioServer::*setVolume)(uint, const pa_cvolume*, pa_context_success_cb_t,
+                                                                  void*));
+        void UpdatePlaybackStream(const pa_sink_input_info* info);
+        void UpdateRecordStream(const pa_source_output_info* info);
+        StreamRecord MakeStreamRecord(uint index, uint client, const char* name, pa_proplist* proplist, uint device,
+                                      int hasVolume, const pa_channel_map& channelMap, const pa_cvolume& volume) const;
+        void StopVolumeRamp(int error);
+        void UpdateCard(const pa_card_info* info);
+        void CheckProfileSwitches();
+        void FinishProfileSwitch(ProfileSwitch* profileSwitch, bool success, int error);
+        void ScheduleProfileSwitchTimeout();
+        void SyncLevelMeters();
+        bool OpenLevelMeter(LevelMeter& levelMeter);
+        void CloseLevelMeters();
+        void UpdateLevels();
+        void PublishLevels();
+        static void Complete(const Promise& promise, bool success, int error);
         static void DummyAppEventCallback(const Event&);
-        static void SetOutputDevice(const uint outputDevice);
         static void PrintProperties(pa_proplist* props, bool verbose = false);
-        static void AddInputDevice(uint index, const char* description, const char* name);
-        static void AddOutputDevice(uint index, const char* description, const char* name, const pa_cvolume& volume);
 
-        // callback functions
+        // event handlers, called by the callback functions below
+        void OnContextState();
+        void OnConnectionLost();
+        void AbortConnection(int error);
+        void ScheduleReconnect();
+        void Reconnect();
+        void CompleteResync();
+        void OnServerInfo(const pa_server_info* info);
+        void OnSubscriptionEvent(pa_subscription_event_type_t eventType, uint index);
+        void OnSinkVolume(const pa_sink_info* info);
+        void OnSetSinkVolume(bool success, PendingCommand* pendingCommand);
+        void OnSetCardProfile(bool success, ProfileSwitch* profileSwitch);
+
+        // callback functions, userdata is the manager, a RefreshBatch, a PendingCommand or a BulkCommand
         static void ServerInfoCallback(pa_context* context, const pa_server_info* info, void* userdata);
+        static void StartupServerInfoCallback(pa_context* context, const pa_server_info* info, void* userdata);
         static void SinklistCallback(pa_context* context, const pa_sink_info* info, int eol, void* userdata);
         static void SourcelistCallback(pa_context* context, const pa_source_info* info, int eol, void* userdata);
+        static void SinkInputCallback(pa_context* context, const pa_sink_input_info* info, int eol, void* userdata);
+        static void SourceOutputCallback(pa_context* context, const pa_source_output_info* info, int eol,
+                                         void* userdata);
+        static void CardCallback(pa_context* context, const pa_card_info* info, int eol, void* userdata);
+        static void SetCardProfileCallback(pa_context* context, int success, void* userdata);
+        static void BulkCommandCallback(pa_context* context, int success, void* userdata);
         static void SubscribeCallback(pa_context* context, pa_subscription_event_type_t eventType, uint index, void* userdata);
         static void GetSinkVolumeCallback(pa_context *context, const pa_sink_info *info, int eol, void *userdata);
-        static void SetSinkVolumeCallback(pa_context *context, const pa_sink_info *info, int eol, void *userdata);
+        static void SetSinkVolumeCallback(pa_context* context, int success, void* userdata);
         static void ContextSuccessCallback(pa_context* context, int success, void* userdata);
+        static void SubscribeSuccessCallback(pa_context* context, int success, void* userdata);
         static void ContextStateCallback(pa_context* context, void* userdata);
+        static void RefreshTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent, const struct timeval* tv,
+                                         void* userdata);
+        static void StartupTimeoutCallback(pa_mainloop_api* api, pa_time_event* timeEvent, const struct timeval* tv,
+                                           void* userdata);
+        static void CacheStoreTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent, const struct timeval* tv,
+                                            void* userdata);
+        static void VolumeRampTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent, const struct timeval* tv,
+                                            void* userdata);
+        static void ProfileSwitchTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent, const struct timeval* tv,
+                                               void* userdata);
+        static void ReconnectTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent, const struct timeval* tv,
+                                           void* userdata);
+        static void LevelMeterCallback(const float* samples, size_t count, void* userdata);
+        static void LevelMeterEndedCallback(void* userdata);
+        static void LevelTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent, const struct timeval* tv,
+                                       void* userdata);
 
     private:
-        static bool m_Ready;
         static SoundDeviceManager* m_Instance;
-        static pa_context* m_Context;
-
-        static pa_mainloop*     m_Mainloop;
-        static pa_mainloop_api* m_MainloopAPI;
-
-        // input devices
-        static std::vector<std::string> m_InputDeviceDescriptions;
-        static std::vector<uint> m_InputDeviceIndicies;
-        static std::vector<std::string> m_InputDeviceNames;
-        static uint m_InputDevices;
-        // output devices
-        static std::vector<std::string> m_OutputDeviceDescriptions;
-        static std::vector<uint> m_OutputDeviceIndicies;
-        static std::vector<std::string> m_OutputDeviceNames;
-        static std::vector<uint> m_OutputDeviceVolumes;
-        static uint m_OutputDevices;
-        static bool m_SetOutputDevice;
+
+        std::string m_ServerAddress;
+        // server requests; the counters outlive the server and are kept across connections
+        OperationCounters m_OperationCounters;
+        std::atomic<pa_usec_t> m_OperationTimeouts[static_cast<int>(OperationType::TYPES)] = {}; // 0: the default
+        std::atomic<uint> m_MaxOperations{AudioServer::DEFAULT_MAX_OPERATIONS};
+        std::unique_ptr<AudioServer> m_Server;
+        std::shared_ptr<EventLoop> m_EventLoop;
+
+        // requests issued before Start(), handed to the event loop after connecting
+        std::mutex m_CommandQueueMutex;
+        std::vector<std::function<void()>> m_CommandQueue;
+        bool m_Started = false;
+
+        std::atomic<bool> m_Ready{false};
+        mutable std::mutex m_ReadyMutex;
+        mutable std::condition_variable m_ReadyCondition;
+        std::chrono::steady_clock::time_point m_StartTime;
+        std::atomic<int64_t> m_TimeToReadyUs{-1};
+        std::atomic<pa_usec_t> m_StartupTimeout{5 * PA_USEC_PER_SEC};
+        pa_time_event* m_StartupTimer = nullptr;
+        bool m_StartupPending = false;
+
+        // reconnect after the server went away, with jittered exponential backoff; the registry is kept
+        // meanwhile and resynced by the startup queries of the new connection
+        static constexpr pa_usec_t RECONNECT_MIN_DELAY = 100 * PA_USEC_PER_MSEC;
+        static constexpr pa_usec_t RECONNECT_MAX_DELAY = 30 * PA_USEC_PER_SEC;
+        bool m_ConnectionLost = false;
+        bool m_ShuttingDown = false; // Disconnect() from the destructor, batches and events are dropped
+        bool m_Resync = false; // the startup queries resync the registry of the lost connection
+        uint m_ReconnectAttempt = 0;
+        bool m_ReconnectScheduled = false;
+        pa_time_event* m_ReconnectTimer = nullptr;
+        std::minstd_rand m_ReconnectJitter{std::random_device()()};
+        std::chrono::steady_clock::time_point m_ConnectionLostTime;
+        DeviceCache::Topology m_ResyncTopology;
+        StreamTable::StreamList m_ResyncPlaybackStreams;
+        StreamTable::StreamList m_ResyncRecordStreams;
+        CardTable::CardList m_ResyncCards;
+        std::atomic<uint64_t> m_Reconnects{0};
+        std::atomic<uint64_t> m_ReconnectAttempts{0};
+
+        // device registry, only accessed on the PA thread
+        DeviceTable m_InputDeviceTable;
+        DeviceTable m_OutputDeviceTable;
+        bool m_SetOutputDevice = false;
+
+        // application streams, refreshed per PA index like the devices
+        StreamTable m_PlaybackStreams;
+        StreamTable m_RecordStreams;
+        std::unordered_set<uint> m_DirtySinkInputs;
+        std::unordered_set<uint> m_DirtySourceOutputs;
+        bool m_PlaybackStreamsChanged = false;
+        bool m_RecordStreamsChanged = false;
+
+        // cards, refreshed per PA index like the devices; profile switches waiting for their devices by card
+        static constexpr pa_usec_t PROFILE_SWITCH_TIMEOUT = 5 * PA_USEC_PER_SEC;
+        CardTable m_CardTable;
+        std::unordered_set<uint> m_DirtyCards;
+        bool m_CardsChanged = false;
+        std::unordered_map<uint, ProfileSwitch*> m_ProfileSwitches;
+        pa_time_event* m_ProfileSwitchTimer = nullptr;
+        std::atomic<uint64_t> m_ProfileSwitchCount{0};
+        std::atomic<uint64_t> m_ProfileSwitchFailures{0};
+        std::atomic<int64_t> m_LastProfileSwitchLatencyUs{0};
+        std::atomic<int64_t> m_MaxProfileSwitchLatencyUs{0};
+        std::atomic<int64_t> m_TotalProfileSwitchLatencyUs{0};
+
+        // defaults as reported by the server, resolved against the tables once the devices are known
+        InternedString m_DefaultSourceName;
+        InternedString m_DefaultSinkName;
+
+        // PA indices with pending subscription events, refreshed together when the window expires
+        std::unordered_set<uint> m_DirtySinks;
+        std::unordered_set<uint> m_DirtySources;
+        pa_time_event* m_RefreshTimer = nullptr;
+        bool m_RefreshScheduled = false;
+        std::atomic<pa_usec_t> m_CoalescingWindow{2 * PA_USEC_PER_MSEC};
+        std::atomic<uint64_t> m_SubscriptionEvents{0};
+        std::atomic<uint64_t> m_Refreshes{0};
+        std::atomic<uint64_t> m_RefreshRoundTrips{0};
+        std::atomic<uint64_t> m_UncoalescedRoundTrips{0};
+
+        std::atomic<VolumeCurve> m_VolumeCurve{VolumeCurve::CUBIC};
+
+        // promises of volume requests not yet sent, by PA index of the sink
+        std::unordered_map<uint, std::vector<Promise>> m_PendingVolumeRequests;
+
+        // volume ramp of the default output device, one step per timer expiry, steps are latest-wins requests
+        VolumeRamp m_VolumeRamp;
+        bool m_VolumeRampActive = false;
+        uint m_VolumeRampSink = PA_INVALID_INDEX;
+        pa_cvolume m_VolumeRampChannels = {}; // channel volumes at the start, scaled by every step
+        pa_volume_t m_VolumeRampLastStep = PA_VOLUME_INVALID;
+        std::vector<Promise> m_VolumeRampPromises;
+        pa_time_event* m_VolumeRampTimer = nullptr;
+        std::atomic<pa_usec_t> m_VolumeRampInterval{20 * PA_USEC_PER_MSEC};
+
+        // level meters by PA index of the metered source, the levels are published once per update
+        static constexpr uint PEAKS_PER_LEVEL_UPDATE = 4;
+        static constexpr uint MAX_LEVEL_METER_REOPEN_DELAY = 64; // updates
+        bool m_LevelMetersEnabled = false;
+        uint m_LevelMeterRate = 20;
+        bool m_LevelsChanged = false;
+        std::unordered_map<uint, std::unique_ptr<LevelMeter>> m_LevelMeters;
+        pa_time_event* m_LevelTimer = nullptr;
+        bool m_LevelTimerScheduled = false;
+        LevelList m_Levels;
+
+        // last known devices, written at most once per CACHE_STORE_DELAY
+        static constexpr pa_usec_t CACHE_STORE_DELAY = PA_USEC_PER_SEC;
+        DeviceCache m_DeviceCache;
+        DeviceCache::Topology m_CachedTopology;
+        pa_time_event* m_CacheStoreTimer = nullptr;
+        bool m_CacheStoreScheduled = false;
+
+        // readers load this pointer, the PA thread replaces it after every change
+        std::shared_ptr<const Snapshot> m_Snapshot;
 
         // callback to alert end user application about events
-        static std::function<void(const Event&)> m_ApplicationEventCallback;
+        using EventCallback = std::function<void(const Event&)>;
+        std::shared_ptr<const EventCallback> m_ApplicationEventCallback =
+            std::make_shared<const EventCallback>(DummyAppEventCallback);
+
+        // events waiting for the application in EventDelivery::QUEUE mode
+        EventDelivery m_EventDelivery = EventDelivery::CALLBACK;
+        RingBuffer<Event> m_EventQueue{256};
+        std::atomic<uint64_t> m_EventOverflows{0};
+
+        // see GetStats()
+        LatencyHistogram m_OperationRoundTrip[Stats::OPERATIONS];
+        LatencyHistogram m_CallbackTime[Stats::CALLBACKS];
+        LatencyHistogram m_ApplicationCallbackTime;
 
     private:
         struct DefaultDevices
         {
-            uint m_InputDeviceIndex;
-            uint m_OutputDeviceIndex;
+            DeviceHandle m_InputDevice;
+            DeviceHandle m_OutputDevice;
             uint m_OutputDeviceVolume;
-            uint m_OutputDeviceVolumeRequest;
         };
-        static DefaultDevices m_DefaultDevices;
+        DefaultDevices m_DefaultDevices = {{}, {}, 0};
 
     };
 
@@ -115,19 +599,51 @@ namespace LibPAmanager
             DEVICE_MANAGER_READY,
             OUTPUT_DEVICE_CHANGED,
             OUTPUT_DEVICE_VOLUME_CHANGED,
-            OUTPUT_DEVICE_LIST_CHANGED,
-            INPUT_DEVICE_LIST_CHANGED
+            OUTPUT_DEVICE_LIST_CHANGED, // GetDeviceListChange() tells what changed
+            INPUT_DEVICE_LIST_CHANGED,
+            OUTPUT_DEVICE_ADDED,
+            OUTPUT_DEVICE_REMOVED,
+            INPUT_DEVICE_ADDED,
+            INPUT_DEVICE_REMOVED,
+            PLAYBACK_STREAM_LIST_CHANGED,
+            RECORD_STREAM_LIST_CHANGED,
+            CARD_LIST_CHANGED,  // cards added or removed, or a profile or port changed
+            CONNECTION_LOST,    // the server went away, reconnecting; the device lists are kept meanwhile
+            CONNECTION_RESTORED // resynced, the events for what changed meanwhile precede it
         };
 
     public:
-        Event(EventType eventType) : m_EventType(eventType) {}
+        Event() : m_EventType(DEVICE_MANAGER_READY) {}
+        Event(EventType eventType, DeviceHandle device = DeviceHandle(), uint oldVolume = 0, uint newVolume = 0)
+            : m_EventType(eventType), m_Device(device), m_OldVolume(oldVolume), m_NewVolume(newVolume)
+        {
+        }
+        Event(EventType eventType, std::shared_ptr<const DeviceListChange> deviceListChange)
+            : m_EventType(eventType), m_OldVolume(0), m_NewVolume(0), m_DeviceListChange(std::move(deviceListChange))
+        {
+        }
+        Event(const Event&) = default;
+        Event(Event&&) = default;
+        Event& operator=(const Event&) = default;
+        Event& operator=(Event&&) = default;
         virtual ~Event() {}
 
         auto GetType() const { return m_EventType; }
         std::string PrintType() const;
 
+        // payload: the device concerned and, for volume changes, the old and new volume
+        DeviceHandle GetDevice() const { return m_Device; }
+        uint GetOldVolume() const { return m_OldVolume; }
+        uint GetNewVolume() const { return m_NewVolume; }
+        // list changed events of the devices: the added, removed and modified devices, nullptr otherwise
+        const std::shared_ptr<const DeviceListChange>& GetDeviceListChange() const { return m_DeviceListChange; }
+
     private:
         EventType m_EventType;
+        DeviceHandle m_Device;
+        uint m_OldVolume;
+        uint m_NewVolume;
+        std::shared_ptr<const DeviceListChange> m_DeviceListChange;
 
     };
 }
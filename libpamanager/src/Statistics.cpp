@@ -0,0 +1,145 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <algorithm>
+#include <sstream>
+
+#include "libpamanager.h"
+#include "Statistics.h"
+
+namespace LibPAmanager
+{
+    namespace
+    {
+        // threads are spread over the shards in the order they first record
+        uint GetThreadShard(uint shards)
+        {
+            static std::atomic<uint> nextShard{0};
+            thread_local uint shard = nextShard.fetch_add(1, std::memory_order_relaxed);
+            return shard % shards;
+        }
+    }
+
+    // values below SUB_BUCKETS are exact, above that the top SUB_BUCKET_BITS below the leading bit select the bucket
+    uint LatencyHistogram::GetBucket(uint64_t value)
+    {
+        if (value < SUB_BUCKETS)
+        {
+            return static_cast<uint>(value);
+        }
+        uint leadingBit = 63 - __builtin_clzll(value);
+        if (leadingBit >= MAX_BITS)
+        {
+            return BUCKETS - 1;
+        }
+        uint shift = leadingBit - SUB_BUCKET_BITS;
+        uint subBucket = static_cast<uint>(value >> shift) & (SUB_BUCKETS - 1);
+        return (shift + 1) * SUB_BUCKETS + subBucket;
+    }
+
+    // the highest value that falls into the bucket
+    uint64_t LatencyHistogram::GetUpperBound(uint bucket)
+    {
+        if (bucket < SUB_BUCKETS)
+        {
+            return bucket;
+        }
+        uint shift = bucket / SUB_BUCKETS - 1;
+        uint64_t subBucket = bucket % SUB_BUCKETS;
+        return ((SUB_BUCKETS + subBucket + 1) << shift) - 1;
+    }
+
+    void LatencyHistogram::Record(std::chrono::nanoseconds latency)
+    {
+        uint64_t value = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+        auto& shard = m_Shards[GetThreadShard(SHARDS)];
+        shard.m_Buckets[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+        shard.m_Count.fetch_add(1, std::memory_order_relaxed);
+        shard.m_Sum.fetch_add(value, std::memory_order_relaxed);
+        uint64_t max = shard.m_Max.load(std::memory_order_relaxed);
+        while ((value > max) && !shard.m_Max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    LatencyStatistics LatencyHistogram::GetStatistics() const
+    {
+        uint64_t buckets[BUCKETS] = {};
+        LatencyStatistics statistics = {};
+        uint64_t sum = 0;
+        for (auto& shard : m_Shards)
+        {
+            for (uint bucket = 0; bucket < BUCKETS; bucket++)
+            {
+                buckets[bucket] += shard.m_Buckets[bucket].load(std::memory_order_relaxed);
+            }
+            sum += shard.m_Sum.load(std::memory_order_relaxed);
+            statistics.m_MaxNs = std::max(statistics.m_MaxNs, shard.m_Max.load(std::memory_order_relaxed));
+        }
+
+        // the shards are read while other threads record, count what the buckets hold
+        for (uint bucket = 0; bucket < BUCKETS; bucket++)
+        {
+            statistics.m_Count += buckets[bucket];
+        }
+        if (!statistics.m_Count)
+        {
+            return statistics;
+        }
+        statistics.m_MeanNs = sum / statistics.m_Count;
+
+        struct Percentile
+        {
+            double m_Fraction;
+            uint64_t* m_Value;
+        };
+        Percentile percentiles[] = {{0.5, &statistics.m_P50Ns},
+                                    {0.9, &statistics.m_P90Ns},
+                                    {0.99, &statistics.m_P99Ns},
+                                    {0.999, &statistics.m_P999Ns}};
+        uint64_t seen = 0;
+        uint bucket = 0;
+        for (auto& percentile : percentiles)
+        {
+            auto rank = static_cast<uint64_t>(percentile.m_Fraction * static_cast<double>(statistics.m_Count - 1)) + 1;
+            while ((seen + buckets[bucket] < rank) && (bucket < BUCKETS - 1))
+            {
+                seen += buckets[bucket];
+                bucket++;
+            }
+            // the last bucket is open-ended, the maximum is its only bound
+            *percentile.m_Value = bucket < BUCKETS - 1 ? std::min(GetUpperBound(bucket), statistics.m_MaxNs)
+                                                       : statistics.m_MaxNs;
+        }
+        return statistics;
+    }
+
+    std::string ToJSON(const LatencyStatistics& statistics)
+    {
+        std::stringstream json;
+        json << "{\"count\": " << statistics.m_Count << ", \"mean_us\": " << statistics.m_MeanNs / 1000.0
+             << ", \"p50_us\": " << statistics.m_P50Ns / 1000.0 << ", \"p90_us\": " << statistics.m_P90Ns / 1000.0
+             << ", \"p99_us\": " << statistics.m_P99Ns / 1000.0 << ", \"p999_us\": " << statistics.m_P999Ns / 1000.0
+             << ", \"max_us\": " << statistics.m_MaxNs / 1000.0 << "}";
+        return json.str();
+    }
+}
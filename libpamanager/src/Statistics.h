@@ -0,0 +1,100 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+namespace LibPAmanager
+{
+    // summary of a latency histogram, percentiles with at most 12.5% error
+    struct LatencyStatistics
+    {
+        uint64_t m_Count;
+        uint64_t m_MeanNs;
+        uint64_t m_P50Ns;
+        uint64_t m_P90Ns;
+        uint64_t m_P99Ns;
+        uint64_t m_P999Ns;
+        uint64_t m_MaxNs;
+    };
+
+    // {"count": ..., "mean_us": ..., "p50_us": ..., "p90_us": ..., "p99_us": ..., "p999_us": ..., "max_us": ...}
+    std::string ToJSON(const LatencyStatistics& statistics);
+
+    //
+    // HDR-style latency histogram: 8 linear buckets per power of two, from 1 ns up to about a minute;
+    // recording is one relaxed increment in the shard of the calling thread, the shards are merged when read
+    //
+    class LatencyHistogram
+    {
+    public:
+        LatencyHistogram() = default;
+        LatencyHistogram(const LatencyHistogram&) = delete;
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        void Record(std::chrono::nanoseconds latency);
+        void Record(std::chrono::steady_clock::time_point start)
+        {
+            Record(std::chrono::steady_clock::now() - start);
+        }
+        LatencyStatistics GetStatistics() const;
+
+    private:
+        static constexpr uint SUB_BUCKET_BITS = 3;
+        static constexpr uint SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+        static constexpr uint MAX_BITS = 36;
+        static constexpr uint BUCKETS = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+        static constexpr uint SHARDS = 4;
+
+        static uint GetBucket(uint64_t value);
+        static uint64_t GetUpperBound(uint bucket);
+
+        struct alignas(64) Shard
+        {
+            std::atomic<uint64_t> m_Buckets[BUCKETS]{};
+            std::atomic<uint64_t> m_Count{0};
+            std::atomic<uint64_t> m_Sum{0};
+            std::atomic<uint64_t> m_Max{0};
+        };
+        Shard m_Shards[SHARDS];
+    };
+
+    // records the lifetime of the scope, e.g. the time spent in a callback
+    class ScopedLatency
+    {
+    public:
+        explicit ScopedLatency(LatencyHistogram& histogram)
+            : m_Histogram(histogram), m_Start(std::chrono::steady_clock::now())
+        {
+        }
+        ~ScopedLatency() { m_Histogram.Record(m_Start); }
+
+    private:
+        LatencyHistogram& m_Histogram;
+        std::chrono::steady_clock::time_point m_Start;
+    };
+}
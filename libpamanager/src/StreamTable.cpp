@@ -0,0 +1,97 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <cstring>
+
+#include "StreamTable.h"
+
+namespace LibPAmanager
+{
+    namespace
+    {
+        bool Equal(const StreamRecord& left, const StreamRecord& right)
+        {
+            return (left.m_Client == right.m_Client) && (left.m_Application == right.m_Application) &&
+                   (left.m_Name == right.m_Name) && (left.m_Device == right.m_Device) &&
+                   (left.m_Volume == right.m_Volume) && (left.m_HasVolume == right.m_HasVolume) &&
+                   (left.m_ChannelMap.channels == right.m_ChannelMap.channels) &&
+                   (left.m_CVolume.channels == right.m_CVolume.channels) &&
+                   !memcmp(left.m_CVolume.values, right.m_CVolume.values, left.m_CVolume.channels * sizeof(pa_volume_t));
+        }
+    }
+
+    bool StreamTable::Update(const StreamRecord& record)
+    {
+        auto existing = m_Streams.find(record.m_PAIndex);
+        if (existing == m_Streams.end())
+        {
+            m_Streams.emplace(record.m_PAIndex, record);
+        }
+        else if (Equal(existing->second, record))
+        {
+            return false;
+        }
+        else
+        {
+            existing->second = record;
+        }
+        m_Published.reset();
+        return true;
+    }
+
+    bool StreamTable::Remove(uint paIndex)
+    {
+        if (!m_Streams.erase(paIndex))
+        {
+            return false;
+        }
+        m_Published.reset();
+        return true;
+    }
+
+    void StreamTable::Clear()
+    {
+        m_Streams.clear();
+        m_Published.reset();
+    }
+
+    const StreamRecord* StreamTable::Find(uint paIndex) const
+    {
+        auto existing = m_Streams.find(paIndex);
+        return existing != m_Streams.end() ? &existing->second : nullptr;
+    }
+
+    StreamTable::StreamList StreamTable::Publish()
+    {
+        if (!m_Published)
+        {
+            auto streams = std::make_shared<std::vector<StreamRecord>>();
+            streams->reserve(m_Streams.size());
+            for (auto& stream : m_Streams)
+            {
+                streams->push_back(stream.second);
+            }
+            m_Published = std::move(streams);
+        }
+        return m_Published;
+    }
+}
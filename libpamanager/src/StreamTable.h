@@ -0,0 +1,80 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <pulse/pulseaudio.h>
+
+namespace LibPAmanager
+{
+    // an application stream: a sink input (playback) or a source output (record)
+    struct StreamRecord
+    {
+        uint m_PAIndex;
+        uint m_Client;             // owning client, PA_INVALID_INDEX if none
+        std::string m_Application; // application.name of the client
+        std::string m_Name;        // media name
+        uint m_Device;             // PA index of the sink or source the stream is attached to
+        uint m_Volume;
+        bool m_HasVolume;
+        pa_channel_map m_ChannelMap;
+        pa_cvolume m_CVolume;
+    };
+
+    //
+    // sink inputs or source outputs by PA index; the list handed to readers is
+    // rebuilt only when the registry changed since it was last published
+    //
+    class StreamTable
+    {
+    public:
+        using StreamList = std::shared_ptr<const std::vector<StreamRecord>>;
+
+        // insert or replace, returns false if the record did not change
+        bool Update(const StreamRecord& record);
+        bool Remove(uint paIndex);
+        void Clear();
+
+        const StreamRecord* Find(uint paIndex) const;
+        size_t Size() const { return m_Streams.size(); }
+
+        template<typename Function> void ForEach(Function function) const
+        {
+            for (auto& stream : m_Streams)
+            {
+                function(stream.second);
+            }
+        }
+
+        // ordered by PA index, shared between snapshots until the next change
+        StreamList Publish();
+
+    private:
+        std::map<uint, StreamRecord> m_Streams;
+        StreamList m_Published;
+    };
+}
@@ -0,0 +1,174 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <array>
+#include <algorithm>
+
+#include "VolumeCurve.h"
+
+namespace LibPAmanager
+{
+    namespace
+    {
+        constexpr size_t TABLE_SIZE = 101; // 0 - 100 percent
+        using VolumeTable = std::array<pa_volume_t, TABLE_SIZE>;
+
+        // the standard library's math functions are not constexpr
+        constexpr double Cbrt(double value)
+        {
+            if (value <= 0.0)
+            {
+                return 0.0;
+            }
+            double root = value < 1.0 ? 1.0 : value;
+            for (int iteration = 0; iteration < 64; iteration++)
+            {
+                root = (2.0 * root + value / (root * root)) / 3.0;
+            }
+            return root;
+        }
+
+        constexpr double Exp(double value)
+        {
+            // exp(x) = exp(x / 2^k)^(2^k), the Taylor series converges quickly for small arguments
+            int halvings = 0;
+            while ((value > 0.5) || (value < -0.5))
+            {
+                value /= 2.0;
+                halvings++;
+            }
+            double sum = 1.0;
+            double term = 1.0;
+            for (int order = 1; order < 20; order++)
+            {
+                term *= value / order;
+                sum += term;
+            }
+            for (int squaring = 0; squaring < halvings; squaring++)
+            {
+                sum *= sum;
+            }
+            return sum;
+        }
+
+        constexpr pa_volume_t ToVolume(double normalized)
+        {
+            return static_cast<pa_volume_t>(normalized * PA_VOLUME_NORM + 0.5);
+        }
+
+        constexpr VolumeTable MakeTable(VolumeCurve curve)
+        {
+            constexpr double LN10 = 2.302585092994046;
+            VolumeTable table{};
+            for (size_t percent = 0; percent < TABLE_SIZE; percent++)
+            {
+                double fraction = static_cast<double>(percent) / 100.0;
+                switch (curve)
+                {
+                    case VolumeCurve::CUBIC:
+                        table[percent] = ToVolume(fraction);
+                        break;
+                    case VolumeCurve::LINEAR:
+                        table[percent] = ToVolume(Cbrt(fraction));
+                        break;
+                    case VolumeCurve::DECIBEL:
+                        // -60 dB to 0 dB in amplitude is 10^((fraction - 1) * 3) = PA volume 10^(fraction - 1)
+                        table[percent] = percent ? ToVolume(Exp((fraction - 1.0) * LN10)) : PA_VOLUME_MUTED;
+                        break;
+                }
+            }
+            return table;
+        }
+
+        constexpr VolumeTable CUBIC_TABLE = MakeTable(VolumeCurve::CUBIC);
+        constexpr VolumeTable LINEAR_TABLE = MakeTable(VolumeCurve::LINEAR);
+        constexpr VolumeTable DECIBEL_TABLE = MakeTable(VolumeCurve::DECIBEL);
+
+        static_assert(CUBIC_TABLE[100] == PA_VOLUME_NORM, "volume tables must end at PA_VOLUME_NORM");
+        static_assert(LINEAR_TABLE[100] == PA_VOLUME_NORM, "volume tables must end at PA_VOLUME_NORM");
+        static_assert(DECIBEL_TABLE[100] == PA_VOLUME_NORM, "volume tables must end at PA_VOLUME_NORM");
+
+        const VolumeTable& GetTable(VolumeCurve curve)
+        {
+            switch (curve)
+            {
+                case VolumeCurve::LINEAR:
+                    return LINEAR_TABLE;
+                case VolumeCurve::DECIBEL:
+                    return DECIBEL_TABLE;
+                default:
+                    return CUBIC_TABLE;
+            }
+        }
+    }
+
+    pa_volume_t PercentToVolume(uint percent, VolumeCurve curve)
+    {
+        return GetTable(curve)[std::min<uint>(percent, TABLE_SIZE - 1)];
+    }
+
+    //
+    // nearest table entry, the tables are strictly increasing
+    //
+    uint VolumeToPercent(pa_volume_t volume, VolumeCurve curve)
+    {
+        auto& table = GetTable(curve);
+        auto above = std::upper_bound(table.begin(), table.end(), volume);
+        if (above == table.end())
+        {
+            return TABLE_SIZE - 1;
+        }
+        if (above == table.begin())
+        {
+            return 0;
+        }
+        auto below = above - 1;
+        auto nearest = (volume - *below) < (*above - volume) ? below : above;
+        return static_cast<uint>(nearest - table.begin());
+    }
+
+    float VolumeToPosition(pa_volume_t volume, VolumeCurve curve)
+    {
+        auto& table = GetTable(curve);
+        auto above = std::upper_bound(table.begin() + 1, table.end(), volume);
+        if (above == table.end())
+        {
+            return static_cast<float>(TABLE_SIZE - 1);
+        }
+        auto below = above - 1;
+        return static_cast<float>(below - table.begin()) +
+               static_cast<float>(volume - *below) / static_cast<float>(*above - *below);
+    }
+
+    pa_volume_t PositionToVolume(float position, VolumeCurve curve)
+    {
+        auto& table = GetTable(curve);
+        position = std::clamp(position, 0.0f, static_cast<float>(TABLE_SIZE - 1));
+        auto below = static_cast<size_t>(position);
+        if (below == TABLE_SIZE - 1)
+        {
+            return table[below];
+        }
+        float fraction = position - static_cast<float>(below);
+        return table[below] + static_cast<pa_volume_t>(fraction * static_cast<float>(table[below + 1] - table[below]) + 0.5f);
+    }
+}
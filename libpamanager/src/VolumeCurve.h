@@ -0,0 +1,48 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <sys/types.h>
+#include <pulse/pulseaudio.h>
+
+namespace LibPAmanager
+{
+    //
+    // mapping of the 0 - 100 percent scale of the API to PulseAudio volumes;
+    // PulseAudio volumes are themselves cubic in amplitude (pa_sw_volume_from_linear)
+    //
+    enum class VolumeCurve
+    {
+        CUBIC,   // percent is PulseAudio's own scale, as shown by pavucontrol (default)
+        LINEAR,  // percent is proportional to the amplitude
+        DECIBEL  // percent is linear in dB over a 60 dB range, 0 is muted
+    };
+
+    // table lookups, no floating point on the way
+    pa_volume_t PercentToVolume(uint percent, VolumeCurve curve);
+    uint VolumeToPercent(pa_volume_t volume, VolumeCurve curve);
+
+    // fractional percent, interpolated linearly between the table entries, for smooth ramps
+    float VolumeToPosition(pa_volume_t volume, VolumeCurve curve);
+    pa_volume_t PositionToVolume(float position, VolumeCurve curve);
+}
@@ -0,0 +1,48 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include "VolumeRamp.h"
+
+namespace LibPAmanager
+{
+    void VolumeRamp::Start(pa_volume_t from, pa_volume_t to, std::chrono::microseconds duration, VolumeCurve curve,
+                           Clock::time_point now)
+    {
+        m_Curve = curve;
+        m_From = VolumeToPosition(from, curve);
+        m_To = VolumeToPosition(to, curve);
+        m_Target = to;
+        m_Start = now;
+        m_End = now + duration;
+    }
+
+    pa_volume_t VolumeRamp::GetVolume(Clock::time_point now) const
+    {
+        if (IsFinished(now))
+        {
+            return m_Target;
+        }
+        auto elapsed = std::chrono::duration<float>(now - m_Start).count();
+        auto duration = std::chrono::duration<float>(m_End - m_Start).count();
+        return PositionToVolume(m_From + (m_To - m_From) * elapsed / duration, m_Curve);
+    }
+}
@@ -0,0 +1,55 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <chrono>
+#include <pulse/pulseaudio.h>
+
+#include "VolumeCurve.h"
+
+namespace LibPAmanager
+{
+    //
+    // a fade between two volumes over a fixed time, linear in the percent scale of a VolumeCurve;
+    // holds no timers, the owner samples it with GetVolume() at its own rate
+    //
+    class VolumeRamp
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        void Start(pa_volume_t from, pa_volume_t to, std::chrono::microseconds duration, VolumeCurve curve,
+                   Clock::time_point now);
+        pa_volume_t GetVolume(Clock::time_point now) const;
+        pa_volume_t GetTarget() const { return m_Target; }
+        bool IsFinished(Clock::time_point now) const { return now >= m_End; }
+
+    private:
+        VolumeCurve m_Curve = VolumeCurve::CUBIC;
+        float m_From = 0.0f;
+        float m_To = 0.0f;
+        pa_volume_t m_Target = PA_VOLUME_MUTED;
+        Clock::time_point m_Start;
+        Clock::time_point m_End;
+    };
+}
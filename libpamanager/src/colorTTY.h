@@ -58,39 +58,12 @@ namespace LibPAmanager
     }
 }
 //
-//logging in all configurations
+//logging in all configurations, see Logger.h for the log levels
 //
-#define PRINT_ERROR(...) fprintf (stderr, "%s\n", __VA_ARGS__)
 #define PrintMessage(code, str) LibPAmanager::PrintMessageInternal(code, str)
 namespace LibPAmanager
 {
     void PrintMessageInternal(Color::Code code, const std::string& x);
 }
 
-//
-//logging only in debug configuration
-//
-#ifdef VERBOSE
-
-    #define LOG_INFO(str)     LibPAmanager::LogInfo(str)
-    #define LOG_WARN(str)     LibPAmanager::LogWarn(str)
-    #define LOG_CRITICAL(str) LibPAmanager::LogCritical(str)
-    #define LOG_TRACE(str)    LibPAmanager::LogTrace(str)
-
-    namespace LibPAmanager
-    {
-        void LogInfo(const std::string& str);
-        void LogWarn(const std::string& str);
-        void LogCritical(const std::string& str);
-        void LogTrace(const std::string& str);
-    }
-
-    #define LOG_MESSAGE printf
-#else
-    #define LOG_INFO(str)
-    #define LOG_WARN(str)
-    #define LOG_CRITICAL(str)
-    #define LOG_TRACE(str)
-
-    #define LOG_MESSAGE(...)
-#endif
+#include "Logger.h"
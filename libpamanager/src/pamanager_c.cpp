@@ -0,0 +1,375 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <mutex>
+#include <vector>
+
+#include "pamanager_c.h"
+#include "SoundDeviceManager.h"
+
+using namespace LibPAmanager;
+
+// the C event types are the values of Event::EventType
+#define CHECK_EVENT_TYPE(type) static_assert(int(PAMANAGER_EVENT_##type) == int(Event::type), "C event type")
+CHECK_EVENT_TYPE(DEVICE_MANAGER_READY);
+CHECK_EVENT_TYPE(OUTPUT_DEVICE_CHANGED);
+CHECK_EVENT_TYPE(OUTPUT_DEVICE_VOLUME_CHANGED);
+CHECK_EVENT_TYPE(OUTPUT_DEVICE_LIST_CHANGED);
+CHECK_EVENT_TYPE(INPUT_DEVICE_LIST_CHANGED);
+CHECK_EVENT_TYPE(OUTPUT_DEVICE_ADDED);
+CHECK_EVENT_TYPE(OUTPUT_DEVICE_REMOVED);
+CHECK_EVENT_TYPE(INPUT_DEVICE_ADDED);
+CHECK_EVENT_TYPE(INPUT_DEVICE_REMOVED);
+CHECK_EVENT_TYPE(PLAYBACK_STREAM_LIST_CHANGED);
+CHECK_EVENT_TYPE(RECORD_STREAM_LIST_CHANGED);
+CHECK_EVENT_TYPE(CARD_LIST_CHANGED);
+CHECK_EVENT_TYPE(CONNECTION_LOST);
+CHECK_EVENT_TYPE(CONNECTION_RESTORED);
+#undef CHECK_EVENT_TYPE
+
+//
+// the listeners are replaced as a whole, the thread of the manager reads them without a lock
+//
+struct pamanager
+{
+    struct Listener
+    {
+        uint64_t m_Id;
+        pamanager_event_cb m_Callback;
+        void* m_Userdata;
+    };
+    using Listeners = std::shared_ptr<const std::vector<Listener>>;
+
+    SoundDeviceManager* m_Manager = nullptr;
+    std::unique_ptr<SoundDeviceManager> m_OwnedManager; // nullptr for pamanager_default()
+    std::mutex m_Mutex;                                  // listener changes and start
+    Listeners m_Listeners = std::make_shared<const std::vector<Listener>>();
+    uint64_t m_NextListener = 1;
+    bool m_Started = false;
+};
+
+struct pamanager_snapshot
+{
+    std::shared_ptr<const SoundDeviceManager::Snapshot> m_Snapshot;
+};
+
+struct pamanager_event
+{
+    const Event* m_Event;
+};
+
+namespace
+{
+    void Attach(pamanager* manager)
+    {
+        manager->m_Manager->SetCallback([manager](const Event& event)
+        {
+            pamanager_event cEvent{&event};
+            auto listeners = std::atomic_load_explicit(&manager->m_Listeners, std::memory_order_acquire);
+            for (auto& listener : *listeners)
+            {
+                listener.m_Callback(&cEvent, listener.m_Userdata);
+            }
+        });
+    }
+
+    pamanager_string_t View(const InternedString& string)
+    {
+        return {string.c_str(), string.View().size()};
+    }
+
+    void Fill(const DeviceRecord& record, pamanager_device_t* device)
+    {
+        device->handle = {record.m_Handle.m_Slot, record.m_Handle.m_Generation};
+        device->pa_index = record.m_PAIndex;
+        device->name = View(record.m_Name);
+        device->description = View(record.m_Description);
+        device->volume = record.m_Volume;
+        device->card = record.m_Card;
+    }
+
+    int Wait(Completion completion, int32_t timeoutMs)
+    {
+        if (timeoutMs == 0)
+        {
+            return PA_OK;
+        }
+        if ((timeoutMs > 0) &&
+            (completion.wait_for(std::chrono::milliseconds(timeoutMs)) != std::future_status::ready))
+        {
+            return PA_ERR_TIMEOUT;
+        }
+        auto result = completion.get();
+        if (result.m_Success)
+        {
+            return PA_OK;
+        }
+        return result.m_Error != PA_OK ? result.m_Error : PA_ERR_UNKNOWN;
+    }
+
+    const std::vector<DeviceRecord>* GetChanges(const pamanager_event_t* event, int change)
+    {
+        auto& deviceListChange = event->m_Event->GetDeviceListChange();
+        if (!deviceListChange)
+        {
+            return nullptr;
+        }
+        switch (change)
+        {
+            case PAMANAGER_CHANGE_ADDED:
+                return &deviceListChange->m_Added;
+            case PAMANAGER_CHANGE_REMOVED:
+                return &deviceListChange->m_Removed;
+            case PAMANAGER_CHANGE_MODIFIED:
+                return &deviceListChange->m_Modified;
+        }
+        return nullptr;
+    }
+}
+
+const char* pamanager_version(void)
+{
+    return LIBPAMANAGER_VERSION;
+}
+
+pamanager_t* pamanager_default(void)
+{
+    static pamanager* manager = []()
+    {
+        auto defaultManager = new pamanager();
+        defaultManager->m_Manager = SoundDeviceManager::GetInstance();
+        Attach(defaultManager);
+        return defaultManager;
+    }();
+    return manager;
+}
+
+pamanager_t* pamanager_new(const char* server)
+{
+    auto manager = new pamanager();
+    manager->m_OwnedManager = std::make_unique<SoundDeviceManager>(server ? server : "");
+    manager->m_Manager = manager->m_OwnedManager.get();
+    Attach(manager);
+    return manager;
+}
+
+int pamanager_free(pamanager_t* manager)
+{
+    if (!manager)
+    {
+        return PA_OK;
+    }
+    if (!manager->m_OwnedManager)
+    {
+        // the process-wide manager stays with the other consumers
+        return PA_ERR_INVALID;
+    }
+    // stop the thread of the manager before the listeners go away
+    manager->m_OwnedManager.reset();
+    delete manager;
+    return PA_OK;
+}
+
+void pamanager_start(pamanager_t* manager, int queue_events)
+{
+    std::lock_guard<std::mutex> lock(manager->m_Mutex);
+    if (manager->m_Started)
+    {
+        return;
+    }
+    manager->m_Started = true;
+    manager->m_Manager->Start(SoundDeviceManager::Backend::MAINLOOP,
+                              queue_events ? SoundDeviceManager::EventDelivery::QUEUE
+                                           : SoundDeviceManager::EventDelivery::CALLBACK);
+}
+
+int pamanager_is_ready(const pamanager_t* manager)
+{
+    return manager->m_Manager->IsReady();
+}
+
+int pamanager_wait_until_ready(pamanager_t* manager, uint32_t timeout_ms)
+{
+    return manager->m_Manager->WaitUntilReady(std::chrono::milliseconds(timeout_ms));
+}
+
+uint64_t pamanager_add_listener(pamanager_t* manager, pamanager_event_cb callback, void* userdata)
+{
+    if (!callback)
+    {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(manager->m_Mutex);
+    auto listeners = std::make_shared<std::vector<pamanager::Listener>>(*manager->m_Listeners);
+    uint64_t id = manager->m_NextListener++;
+    listeners->push_back({id, callback, userdata});
+    std::atomic_store_explicit(&manager->m_Listeners, pamanager::Listeners(std::move(listeners)),
+                               std::memory_order_release);
+    return id;
+}
+
+// a callback that is running may still see the listener once
+void pamanager_remove_listener(pamanager_t* manager, uint64_t listener)
+{
+    std::lock_guard<std::mutex> lock(manager->m_Mutex);
+    auto listeners = std::make_shared<std::vector<pamanager::Listener>>();
+    for (auto& existing : *manager->m_Listeners)
+    {
+        if (existing.m_Id != listener)
+        {
+            listeners->push_back(existing);
+        }
+    }
+    std::atomic_store_explicit(&manager->m_Listeners, pamanager::Listeners(std::move(listeners)),
+                               std::memory_order_release);
+}
+
+size_t pamanager_dispatch_events(pamanager_t* manager)
+{
+    return manager->m_Manager->DispatchEvents();
+}
+
+int pamanager_event_type(const pamanager_event_t* event)
+{
+    return event->m_Event->GetType();
+}
+
+pamanager_device_handle_t pamanager_event_device(const pamanager_event_t* event)
+{
+    auto device = event->m_Event->GetDevice();
+    return {device.m_Slot, device.m_Generation};
+}
+
+uint32_t pamanager_event_old_volume(const pamanager_event_t* event)
+{
+    return event->m_Event->GetOldVolume();
+}
+
+uint32_t pamanager_event_new_volume(const pamanager_event_t* event)
+{
+    return event->m_Event->GetNewVolume();
+}
+
+size_t pamanager_event_change_count(const pamanager_event_t* event, int change)
+{
+    auto devices = GetChanges(event, change);
+    return devices ? devices->size() : 0;
+}
+
+int pamanager_event_change(const pamanager_event_t* event, int change, size_t index, pamanager_device_t* device)
+{
+    auto devices = GetChanges(event, change);
+    if (!devices || (index >= devices->size()))
+    {
+        return 0;
+    }
+    Fill((*devices)[index], device);
+    return 1;
+}
+
+int pamanager_event_change_reset(const pamanager_event_t* event)
+{
+    auto& deviceListChange = event->m_Event->GetDeviceListChange();
+    return deviceListChange && deviceListChange->m_Reset;
+}
+
+pamanager_snapshot_t* pamanager_snapshot_acquire(const pamanager_t* manager)
+{
+    return new pamanager_snapshot{manager->m_Manager->GetSnapshot()};
+}
+
+void pamanager_snapshot_release(pamanager_snapshot_t* snapshot)
+{
+    delete snapshot;
+}
+
+int pamanager_snapshot_is_stale(const pamanager_snapshot_t* snapshot)
+{
+    return snapshot->m_Snapshot->m_Stale;
+}
+
+size_t pamanager_snapshot_device_count(const pamanager_snapshot_t* snapshot, int output)
+{
+    return output ? snapshot->m_Snapshot->m_OutputDeviceRecords.size()
+                  : snapshot->m_Snapshot->m_InputDeviceRecords.size();
+}
+
+int pamanager_snapshot_device(const pamanager_snapshot_t* snapshot, int output, size_t index,
+                              pamanager_device_t* device)
+{
+    auto& records = output ? snapshot->m_Snapshot->m_OutputDeviceRecords : snapshot->m_Snapshot->m_InputDeviceRecords;
+    if (index >= records.size())
+    {
+        return 0;
+    }
+    Fill(records[index], device);
+    return 1;
+}
+
+int pamanager_snapshot_default_output_device(const pamanager_snapshot_t* snapshot, pamanager_device_t* device)
+{
+    auto handle = snapshot->m_Snapshot->m_DefaultOutputDeviceHandle;
+    if (!handle.IsValid())
+    {
+        return 0;
+    }
+    for (auto& record : snapshot->m_Snapshot->m_OutputDeviceRecords)
+    {
+        if (record.m_Handle == handle)
+        {
+            Fill(record, device);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint32_t pamanager_snapshot_output_volume(const pamanager_snapshot_t* snapshot)
+{
+    return snapshot->m_Snapshot->m_OutputDeviceVolume;
+}
+
+uint32_t pamanager_get_volume(const pamanager_t* manager)
+{
+    return manager->m_Manager->GetVolume();
+}
+
+int pamanager_set_volume(pamanager_t* manager, uint32_t volume, int32_t timeout_ms)
+{
+    return Wait(manager->m_Manager->SetVolume(volume), timeout_ms);
+}
+
+int pamanager_set_output_device(pamanager_t* manager, pamanager_device_handle_t device, int32_t timeout_ms)
+{
+    return Wait(manager->m_Manager->SetOutputDevice(DeviceHandle{device.slot, device.generation}), timeout_ms);
+}
+
+int pamanager_set_output_device_by_description(pamanager_t* manager, const char* description, size_t length,
+                                               int32_t timeout_ms)
+{
+    return Wait(manager->m_Manager->SetOutputDevice(std::string_view(description, length)), timeout_ms);
+}
+
+int pamanager_cycle_output_device(pamanager_t* manager, int32_t timeout_ms)
+{
+    return Wait(manager->m_Manager->CycleNextOutputDevice(), timeout_ms);
+}
@@ -0,0 +1,163 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+/*
+ * C ABI of libpamanager, built into libpamanager.so for FFI consumers (Python, Rust, ...):
+ * opaque handles, callbacks with userdata, and borrowed views into the published device
+ * registry instead of copied lists; nothing C++ crosses the boundary
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define PAMANAGER_API __attribute__((visibility("default")))
+
+typedef struct pamanager pamanager_t;
+typedef struct pamanager_snapshot pamanager_snapshot_t;
+typedef struct pamanager_event pamanager_event_t;
+
+/* event types, the values are part of the ABI */
+enum
+{
+    PAMANAGER_EVENT_DEVICE_MANAGER_READY = 0,
+    PAMANAGER_EVENT_OUTPUT_DEVICE_CHANGED = 1,
+    PAMANAGER_EVENT_OUTPUT_DEVICE_VOLUME_CHANGED = 2,
+    PAMANAGER_EVENT_OUTPUT_DEVICE_LIST_CHANGED = 3,
+    PAMANAGER_EVENT_INPUT_DEVICE_LIST_CHANGED = 4,
+    PAMANAGER_EVENT_OUTPUT_DEVICE_ADDED = 5,
+    PAMANAGER_EVENT_OUTPUT_DEVICE_REMOVED = 6,
+    PAMANAGER_EVENT_INPUT_DEVICE_ADDED = 7,
+    PAMANAGER_EVENT_INPUT_DEVICE_REMOVED = 8,
+    PAMANAGER_EVENT_PLAYBACK_STREAM_LIST_CHANGED = 9,
+    PAMANAGER_EVENT_RECORD_STREAM_LIST_CHANGED = 10,
+    PAMANAGER_EVENT_CARD_LIST_CHANGED = 11,
+    PAMANAGER_EVENT_CONNECTION_LOST = 12,
+    PAMANAGER_EVENT_CONNECTION_RESTORED = 13
+};
+
+/* the device sets of the list changed events */
+enum
+{
+    PAMANAGER_CHANGE_ADDED = 0,
+    PAMANAGER_CHANGE_REMOVED = 1,
+    PAMANAGER_CHANGE_MODIFIED = 2
+};
+
+/* stays valid until the device is removed */
+typedef struct
+{
+    uint32_t slot;
+    uint32_t generation;
+} pamanager_device_handle_t;
+
+/* borrowed, also NUL terminated; device strings are interned and stay valid for the life of the process */
+typedef struct
+{
+    const char* data;
+    size_t length;
+} pamanager_string_t;
+
+typedef struct
+{
+    pamanager_device_handle_t handle;
+    uint32_t pa_index;
+    pamanager_string_t name;
+    pamanager_string_t description;
+    uint32_t volume; /* percent */
+    uint32_t card;   /* PA index, UINT32_MAX if none */
+} pamanager_device_t;
+
+/* called on the thread of the manager, or from pamanager_dispatch_events(); the event is only valid during the call */
+typedef void (*pamanager_event_cb)(const pamanager_event_t* event, void* userdata);
+
+PAMANAGER_API const char* pamanager_version(void);
+
+/*
+ * managers: pamanager_default() is the process-wide manager of the default server, shared by all consumers
+ * in the process and never freed; pamanager_new() connects to server ("unix:/run/user/1000/pulse/native",
+ * NULL for the default) on its own; pamanager_free() must not be called from an event callback, it returns
+ * 0, or PA_ERR_INVALID (3) and releases nothing for the handle of pamanager_default()
+ */
+PAMANAGER_API pamanager_t* pamanager_default(void);
+PAMANAGER_API pamanager_t* pamanager_new(const char* server);
+PAMANAGER_API int pamanager_free(pamanager_t* manager);
+
+/* the first call starts the manager, later calls are ignored; queue_events: the events wait for
+   pamanager_dispatch_events() instead of being delivered on the thread of the manager */
+PAMANAGER_API void pamanager_start(pamanager_t* manager, int queue_events);
+PAMANAGER_API int pamanager_is_ready(const pamanager_t* manager);
+PAMANAGER_API int pamanager_wait_until_ready(pamanager_t* manager, uint32_t timeout_ms);
+
+/*
+ * any number of listeners per manager, returns 0 on failure; the listeners are called from the one
+ * SoundDeviceManager::SetCallback() of the manager, which the C layer takes over: for pamanager_default()
+ * that is the callback of SoundDeviceManager::GetInstance(), so C++ code in the same process that sets it
+ * disconnects all listeners, and the first pamanager_default() call replaces a callback set before
+ */
+PAMANAGER_API uint64_t pamanager_add_listener(pamanager_t* manager, pamanager_event_cb callback, void* userdata);
+PAMANAGER_API void pamanager_remove_listener(pamanager_t* manager, uint64_t listener);
+PAMANAGER_API size_t pamanager_dispatch_events(pamanager_t* manager);
+
+PAMANAGER_API int pamanager_event_type(const pamanager_event_t* event);
+PAMANAGER_API pamanager_device_handle_t pamanager_event_device(const pamanager_event_t* event);
+PAMANAGER_API uint32_t pamanager_event_old_volume(const pamanager_event_t* event);
+PAMANAGER_API uint32_t pamanager_event_new_volume(const pamanager_event_t* event);
+/* list changed events of the devices: the added, removed and modified devices; reset asks to re-read the list */
+PAMANAGER_API size_t pamanager_event_change_count(const pamanager_event_t* event, int change);
+PAMANAGER_API int pamanager_event_change(const pamanager_event_t* event, int change, size_t index,
+                                         pamanager_device_t* device);
+PAMANAGER_API int pamanager_event_change_reset(const pamanager_event_t* event);
+
+/* the registry as published by the manager, immutable until released */
+PAMANAGER_API pamanager_snapshot_t* pamanager_snapshot_acquire(const pamanager_t* manager);
+PAMANAGER_API void pamanager_snapshot_release(pamanager_snapshot_t* snapshot);
+PAMANAGER_API int pamanager_snapshot_is_stale(const pamanager_snapshot_t* snapshot);
+PAMANAGER_API size_t pamanager_snapshot_device_count(const pamanager_snapshot_t* snapshot, int output);
+PAMANAGER_API int pamanager_snapshot_device(const pamanager_snapshot_t* snapshot, int output, size_t index,
+                                            pamanager_device_t* device);
+PAMANAGER_API int pamanager_snapshot_default_output_device(const pamanager_snapshot_t* snapshot,
+                                                           pamanager_device_t* device);
+PAMANAGER_API uint32_t pamanager_snapshot_output_volume(const pamanager_snapshot_t* snapshot);
+
+/*
+ * commands return 0 or a PulseAudio error code (pa_strerror()); timeout_ms < 0 waits until the server
+ * has acknowledged, 0 returns once the command is queued, > 0 returns PA_ERR_TIMEOUT when it expires
+ * (the command still completes)
+ */
+PAMANAGER_API uint32_t pamanager_get_volume(const pamanager_t* manager);
+PAMANAGER_API int pamanager_set_volume(pamanager_t* manager, uint32_t volume, int32_t timeout_ms);
+PAMANAGER_API int pamanager_set_output_device(pamanager_t* manager, pamanager_device_handle_t device,
+                                              int32_t timeout_ms);
+PAMANAGER_API int pamanager_set_output_device_by_description(pamanager_t* manager, const char* description,
+                                                             size_t length, int32_t timeout_ms);
+PAMANAGER_API int pamanager_cycle_output_device(pamanager_t* manager, int32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
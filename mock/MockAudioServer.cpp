@@ -0,0 +1,1138 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <cmath>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "MockAudioServer.h"
+
+namespace LibPAmanager
+{
+    namespace
+    {
+        constexpr float TWO_PI = 6.2831853f;
+    }
+
+    //
+    // a sine of a few hertz per source, sampled at the peak rate
+    //
+    class MockAudioServer::MockPeakStream : public PeakStream
+    {
+    public:
+        MockPeakStream(MockAudioServer* server, uint sourceIndex, uint rate, uint fragment, PeakCallback callback,
+                       PeakStreamEndedCallback endedCallback, void* userdata)
+            : m_Server(server), m_SourceIndex(sourceIndex), m_Samples(fragment), m_Callback(callback),
+              m_EndedCallback(endedCallback), m_Userdata(userdata),
+              m_Step(TWO_PI * (1.0f + sourceIndex % 4) / rate),
+              m_Interval(fragment * PA_USEC_PER_SEC / rate), m_Deadline(pa_rtclock_now() + m_Interval)
+        {
+        }
+
+        ~MockPeakStream() override { m_Server->m_PeakStreams.erase(this); }
+
+        void Deliver()
+        {
+            for (auto& sample : m_Samples)
+            {
+                sample = std::fabs(std::sin(m_Phase));
+                m_Phase = std::fmod(m_Phase + m_Step, TWO_PI);
+            }
+            m_Callback(m_Samples.data(), m_Samples.size(), m_Userdata);
+            m_Deadline += m_Interval;
+        }
+
+    public:
+        MockAudioServer* m_Server;
+        uint m_SourceIndex;
+        std::vector<float> m_Samples;
+        PeakCallback m_Callback;
+        PeakStreamEndedCallback m_EndedCallback;
+        void* m_Userdata;
+        float m_Phase = 0.0f;
+        float m_Step;
+        pa_usec_t m_Interval;
+        pa_usec_t m_Deadline;
+    };
+
+    MockAudioServer::MockAudioServer() : MockAudioServer(Configuration()) {}
+
+    MockAudioServer::MockAudioServer(const Configuration& configuration)
+        : m_Latency(configuration.m_Latency), m_FailureRate(configuration.m_FailureRate),
+          m_FailureError(configuration.m_FailureError), m_HangRate(configuration.m_HangRate),
+          m_RandomGenerator(configuration.m_Seed)
+    {
+        m_WakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        for (uint sink = 0; sink < configuration.m_Sinks; sink++)
+        {
+            auto name = "mock_sink_" + std::to_string(sink);
+            uint index = m_NextIndex++;
+            m_Sinks[index] = {index, name, "Mock Sink " + std::to_string(sink), {}, m_NextIndex++, PA_INVALID_INDEX};
+            pa_cvolume_set(&m_Sinks[index].m_Volume, 2, PA_VOLUME_NORM);
+        }
+        for (uint source = 0; source < configuration.m_Sources; source++)
+        {
+            auto name = "mock_source_" + std::to_string(source);
+            m_Sources[m_NextIndex] = {m_NextIndex, name, "Mock Source " + std::to_string(source), {}, PA_INVALID_INDEX,
+                                      PA_INVALID_INDEX};
+            pa_cvolume_set(&m_Sources[m_NextIndex].m_Volume, 2, PA_VOLUME_NORM);
+            m_NextIndex++;
+        }
+        for (uint card = 0; card < configuration.m_Cards; card++)
+        {
+            AddCard(card);
+        }
+        if (!m_Sinks.empty())
+        {
+            m_DefaultSink = m_Sinks.begin()->second.m_Name;
+        }
+        if (!m_Sources.empty())
+        {
+            m_DefaultSource = m_Sources.begin()->second.m_Name;
+        }
+
+        m_Proplist = pa_proplist_new();
+        for (uint stream = 0; stream < configuration.m_SinkInputs; stream++)
+        {
+            AddStream(m_SinkInputs, PA_SUBSCRIPTION_EVENT_SINK_INPUT, "mock_player_" + std::to_string(stream), m_Sinks,
+                      m_DefaultSink);
+        }
+        for (uint stream = 0; stream < configuration.m_SourceOutputs; stream++)
+        {
+            AddStream(m_SourceOutputs, PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT, "mock_recorder_" + std::to_string(stream),
+                      m_Sources, m_DefaultSource);
+        }
+    }
+
+    MockAudioServer::~MockAudioServer()
+    {
+        DropOperations();
+        if (m_MainloopAPI)
+        {
+            if (m_ReplyTimer)
+            {
+                FreeTimer(m_ReplyTimer);
+            }
+            if (m_PeakTimer)
+            {
+                FreeTimer(m_PeakTimer);
+            }
+            if (m_WakeupEvent)
+            {
+                m_MainloopAPI->io_free(m_WakeupEvent);
+            }
+        }
+        close(m_WakeupFd);
+        pa_proplist_free(m_Proplist);
+    }
+
+    //
+    // deliver a reply after the configured latency
+    //
+    void MockAudioServer::Reply(std::function<void()> reply)
+    {
+        pa_usec_t now = pa_rtclock_now();
+        m_Replies.emplace(now + m_Latency.load(std::memory_order_relaxed), std::move(reply));
+
+        pa_usec_t deadline = m_Replies.begin()->first;
+        pa_usec_t delay = deadline > now ? deadline - now : 0;
+        if (!m_ReplyTimer)
+        {
+            m_ReplyTimer = NewTimer(delay, ReplyTimerCallback, this);
+        }
+        else
+        {
+            RestartTimer(m_ReplyTimer, delay);
+        }
+    }
+
+    void MockAudioServer::ReplyTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent, const struct timeval* tv,
+                                             void* userdata)
+    {
+        auto server = static_cast<MockAudioServer*>(userdata);
+        pa_usec_t now = pa_rtclock_now();
+
+        // replies queued by the replies themselves wait for the next round
+        while (!server->m_Replies.empty() && (server->m_Replies.begin()->first <= now))
+        {
+            auto reply = std::move(server->m_Replies.begin()->second);
+            server->m_Replies.erase(server->m_Replies.begin());
+            reply();
+        }
+        if (!server->m_Replies.empty())
+        {
+            pa_usec_t deadline = server->m_Replies.begin()->first;
+            server->RestartTimer(timeEvent, deadline > now ? deadline - now : 0);
+        }
+    }
+
+    //
+    // a tracked request: the reply is dropped if the tracker gave up on the operation in the
+    // meantime, a hanging request is never answered and left to the deadline of its type
+    //
+    bool MockAudioServer::Request(OperationType type, uint key, std::function<void()> fail,
+                                  std::function<void()> reply)
+    {
+        if (m_State != PA_CONTEXT_READY)
+        {
+            m_Errno = PA_ERR_BADSTATE;
+            return false;
+        }
+        if (!AdmitOperation())
+        {
+            return false;
+        }
+        uint64_t id = TrackOperation(type, key, nullptr, std::move(fail));
+        if (DrawHang())
+        {
+            return true;
+        }
+        Reply([this, id, reply = std::move(reply)]()
+        {
+            if (FinishOperation(id))
+            {
+                reply();
+            }
+        });
+        return true;
+    }
+
+    bool MockAudioServer::DrawHang()
+    {
+        double hangRate = m_HangRate.load(std::memory_order_relaxed);
+        if (hangRate <= 0.0)
+        {
+            return false;
+        }
+        return std::uniform_real_distribution<double>(0.0, 1.0)(m_RandomGenerator) < hangRate;
+    }
+
+    int MockAudioServer::GetErrno() const
+    {
+        int error = GetOperationError();
+        return error != PA_OK ? error : m_Errno;
+    }
+
+    bool MockAudioServer::DrawFailure()
+    {
+        m_Requests.fetch_add(1, std::memory_order_relaxed);
+        double failureRate = m_FailureRate.load(std::memory_order_relaxed);
+        if (failureRate <= 0.0)
+        {
+            return false;
+        }
+        return std::uniform_real_distribution<double>(0.0, 1.0)(m_RandomGenerator) < failureRate;
+    }
+
+    void MockAudioServer::Emit(pa_subscription_event_type_t facility, pa_subscription_event_type_t type, uint index)
+    {
+        if (!m_SubscribeCallback || !(m_SubscriptionMask & (1 << facility)))
+        {
+            return;
+        }
+        auto eventType = static_cast<pa_subscription_event_type_t>(facility | type);
+        Reply([this, eventType, index]() { m_SubscribeCallback(nullptr, eventType, index, m_SubscribeUserdata); });
+    }
+
+    void MockAudioServer::SetState(pa_context_state_t state)
+    {
+        m_State = state;
+        if (m_StateCallback)
+        {
+            m_StateCallback(nullptr, m_StateUserdata);
+        }
+    }
+
+    bool MockAudioServer::Connect(const char* server, pa_context_notify_cb_t stateCallback, void* userdata)
+    {
+        m_StateCallback = stateCallback;
+        m_StateUserdata = userdata;
+        if (!m_WakeupEvent)
+        {
+            m_WakeupEvent = m_MainloopAPI->io_new(m_MainloopAPI, m_WakeupFd, PA_IO_EVENT_INPUT, WakeupCallback, this);
+        }
+
+        SetState(PA_CONTEXT_CONNECTING);
+        if (pa_rtclock_now() < m_DownUntil)
+        {
+            Reply([this]()
+            {
+                m_Errno = PA_ERR_CONNECTIONREFUSED;
+                SetState(PA_CONTEXT_FAILED);
+            });
+            return true;
+        }
+        m_Errno = PA_OK;
+        Reply([this]() { SetState(PA_CONTEXT_AUTHORIZING); });
+        Reply([this]() { SetState(PA_CONTEXT_SETTING_NAME); });
+        Reply([this]() { SetState(PA_CONTEXT_READY); });
+        return true;
+    }
+
+    void MockAudioServer::FillSinkInfo(const Device& device, pa_sink_info& info)
+    {
+        info = {};
+        info.name = device.m_Name.c_str();
+        info.index = device.m_Index;
+        info.description = device.m_Description.c_str();
+        info.channel_map.channels = device.m_Volume.channels;
+        for (uint channel = 0; channel < device.m_Volume.channels; channel++)
+        {
+            info.channel_map.map[channel] = static_cast<pa_channel_position_t>(PA_CHANNEL_POSITION_FRONT_LEFT + channel);
+        }
+        info.volume = device.m_Volume;
+        info.monitor_source = device.m_Monitor;
+        info.base_volume = PA_VOLUME_NORM;
+        info.card = device.m_Card;
+    }
+
+    void MockAudioServer::FillSourceInfo(const Device& device, pa_source_info& info)
+    {
+        info = {};
+        info.name = device.m_Name.c_str();
+        info.index = device.m_Index;
+        info.description = device.m_Description.c_str();
+        info.channel_map.channels = device.m_Volume.channels;
+        for (uint channel = 0; channel < device.m_Volume.channels; channel++)
+        {
+            info.channel_map.map[channel] = static_cast<pa_channel_position_t>(PA_CHANNEL_POSITION_FRONT_LEFT + channel);
+        }
+        info.volume = device.m_Volume;
+        info.monitor_of_sink = PA_INVALID_INDEX;
+        info.base_volume = PA_VOLUME_NORM;
+        info.card = device.m_Card;
+    }
+
+    void MockAudioServer::FillSinkInputInfo(const Stream& stream, pa_sink_input_info& info)
+    {
+        info = {};
+        pa_proplist_sets(m_Proplist, PA_PROP_APPLICATION_NAME, stream.m_Application.c_str());
+        info.index = stream.m_Index;
+        info.name = "playback";
+        info.owner_module = PA_INVALID_INDEX;
+        info.client = stream.m_Client;
+        info.sink = stream.m_Device;
+        info.channel_map.channels = stream.m_Volume.channels;
+        for (uint channel = 0; channel < stream.m_Volume.channels; channel++)
+        {
+            info.channel_map.map[channel] = static_cast<pa_channel_position_t>(PA_CHANNEL_POSITION_FRONT_LEFT + channel);
+        }
+        info.volume = stream.m_Volume;
+        info.proplist = m_Proplist;
+        info.has_volume = 1;
+        info.volume_writable = 1;
+    }
+
+    void MockAudioServer::FillSourceOutputInfo(const Stream& stream, pa_source_output_info& info)
+    {
+        info = {};
+        pa_proplist_sets(m_Proplist, PA_PROP_APPLICATION_NAME, stream.m_Application.c_str());
+        info.index = stream.m_Index;
+        info.name = "record";
+        info.owner_module = PA_INVALID_INDEX;
+        info.client = stream.m_Client;
+        info.source = stream.m_Device;
+        info.channel_map.channels = stream.m_Volume.channels;
+        for (uint channel = 0; channel < stream.m_Volume.channels; channel++)
+        {
+            info.channel_map.map[channel] = static_cast<pa_channel_position_t>(PA_CHANNEL_POSITION_FRONT_LEFT + channel);
+        }
+        info.volume = stream.m_Volume;
+        info.proplist = m_Proplist;
+        info.has_volume = 1;
+        info.volume_writable = 1;
+    }
+
+    bool MockAudioServer::GetServerInfo(pa_server_info_cb_t callback, void* userdata)
+    {
+        bool failure = DrawFailure();
+        return Request(OperationType::QUERY, PA_INVALID_INDEX, FailReply(callback, userdata),
+                       [this, failure, callback, userdata]()
+        {
+            if (failure)
+            {
+                m_Errno = m_FailureError;
+                callback(nullptr, nullptr, userdata);
+                return;
+            }
+            pa_server_info info = {};
+            info.server_name = "pamanager mock server";
+            info.server_version = "0.0.0";
+            info.default_sink_name = m_DefaultSink.c_str();
+            info.default_source_name = m_DefaultSource.c_str();
+            callback(nullptr, &info, userdata);
+        });
+    }
+
+    bool MockAudioServer::GetSinkInfoList(pa_sink_info_cb_t callback, void* userdata)
+    {
+        bool failure = DrawFailure();
+        return Request(OperationType::QUERY, PA_INVALID_INDEX, FailReply(callback, userdata),
+                       [this, failure, callback, userdata]()
+        {
+            if (failure)
+            {
+                m_Errno = m_FailureError;
+                callback(nullptr, nullptr, -1, userdata);
+                return;
+            }
+            pa_sink_info info;
+            for (auto& sink : m_Sinks)
+            {
+                FillSinkInfo(sink.second, info);
+                callback(nullptr, &info, 0, userdata);
+            }
+            callback(nullptr, nullptr, 1, userdata);
+        });
+    }
+
+    bool MockAudioServer::GetSinkInfoByIndex(uint index, pa_sink_info_cb_t callback, void* userdata)
+    {
+        bool failure = DrawFailure();
+        return Request(OperationType::QUERY, index, FailReply(callback, userdata),
+                       [this, failure, index, callback, userdata]()
+        {
+            auto sink = m_Sinks.find(index);
+            if (failure || (sink == m_Sinks.end()))
+            {
+                m_Errno = failure ? m_FailureError : PA_ERR_NOENTITY;
+                callback(nullptr, nullptr, -1, userdata);
+                return;
+            }
+            pa_sink_info info;
+            FillSinkInfo(sink->second, info);
+            callback(nullptr, &info, 0, userdata);
+            callback(nullptr, nullptr, 1, userdata);
+        });
+    }
+
+    bool MockAudioServer::GetSourceInfoList(pa_source_info_cb_t callback, void* userdata)
+    {
+        bool failure = DrawFailure();
+        return Request(OperationType::QUERY, PA_INVALID_INDEX, FailReply(callback, userdata),
+                       [this, failure, callback, userdata]()
+        {
+            if (failure)
+            {
+                m_Errno = m_FailureError;
+                callback(nullptr, nullptr, -1, userdata);
+                return;
+            }
+            pa_source_info info;
+            for (auto& source : m_Sources)
+            {
+                FillSourceInfo(source.second, info);
+                callback(nullptr, &info, 0, userdata);
+            }
+            callback(nullptr, nullptr, 1, userdata);
+        });
+    }
+
+    bool MockAudioServer::GetSourceInfoByIndex(uint index, pa_source_info_cb_t callback, void* userdata)
+    {
+        bool failure = DrawFailure();
+        return Request(OperationType::QUERY, index, FailReply(callback, userdata),
+                       [this, failure, index, callback, userdata]()
+        {
+            auto source = m_Sources.find(index);
+            if (failure || (source == m_Sources.end()))
+            {
+                m_Errno = failure ? m_FailureError : PA_ERR_NOENTITY;
+                callback(nullptr, nullptr, -1, userdata);
+                return;
+            }
+            pa_source_info info;
+            FillSourceInfo(source->second, info);
+            callback(nullptr, &info, 0, userdata);
+            callback(nullptr, nullptr, 1, userdata);
+        });
+    }
+
+    bool MockAudioServer::Subscribe(pa_subscription_mask_t mask, pa_context_subscribe_cb_t callback, void* userdata,
+                                    pa_context_success_cb_t successCallback, void* successUserdata)
+    {
+        m_SubscribeCallback = callback;
+        m_SubscribeUserdata = userdata;
+        m_SubscriptionMask = mask;
+        return Request(OperationType::SUBSCRIBE, PA_INVALID_INDEX, FailReply(successCallback, successUserdata),
+                       [successCallback, successUserdata]()
+        {
+            if (successCallback)
+            {
+                successCallback(nullptr, 1, successUserdata);
+            }
+        });
+    }
+
+    bool MockAudioServer::SetDefaultSink(const char* name, pa_context_success_cb_t callback, void* userdata)
+    {
+        bool failure = DrawFailure();
+        std::string sinkName = name;
+        return Request(OperationType::SET_DEFAULT_SINK, 0, FailReply(callback, userdata),
+                       [this, failure, sinkName, callback, userdata]()
+        {
+            bool found = false;
+            for (auto& sink : m_Sinks)
+            {
+                if (sink.second.m_Name == sinkName)
+                {
+                    found = true;
+                    break;
+                }
+            }
+            if (failure || !found)
+            {
+                m_Errno = failure ? m_FailureError : PA_ERR_NOENTITY;
+                callback(nullptr, 0, userdata);
+                return;
+            }
+            m_DefaultSink = sinkName;
+            callback(nullptr, 1, userdata);
+            Emit(PA_SUBSCRIPTION_EVENT_SERVER, PA_SUBSCRIPTION_EVENT_CHANGE, PA_INVALID_INDEX);
+        });
+    }
+
+    bool MockAudioServer::SetSinkVolumeByIndex(uint index, const pa_cvolume* volume, pa_context_success_cb_t callback,
+                                               void* userdata)
+    {
+        bool failure = DrawFailure();
+        pa_cvolume cVolume = *volume;
+        return Request(OperationType::SET_SINK_VOLUME, index, FailReply(callback, userdata),
+                       [this, failure, index, cVolume, callback, userdata]()
+        {
+            auto sink = m_Sinks.find(index);
+            if (failure || (sink == m_Sinks.end()))
+            {
+                m_Errno = failure ? m_FailureError : PA_ERR_NOENTITY;
+                callback(nullptr, 0, userdata);
+                return;
+            }
+            sink->second.m_Volume = cVolume;
+            callback(nullptr, 1, userdata);
+            Emit(PA_SUBSCRIPTION_EVENT_SINK, PA_SUBSCRIPTION_EVENT_CHANGE, index);
+        });
+    }
+
+    bool MockAudioServer::GetSinkInputInfoList(pa_sink_input_info_cb_t callback, void* userdata)
+    {
+        bool failure = DrawFailure();
+        return Request(OperationType::QUERY, PA_INVALID_INDEX, FailReply(callback, userdata),
+                       [this, failure, callback, userdata]()
+        {
+            if (failure)
+            {
+                m_Errno = m_FailureError;
+                callback(nullptr, nullptr, -1, userdata);
+                return;
+            }
+            pa_sink_input_info info;
+            for (auto& sinkInput : m_SinkInputs)
+            {
+                FillSinkInputInfo(sinkInput.second, info);
+                callback(nullptr, &info, 0, userdata);
+            }
+            callback(nullptr, nullptr, 1, userdata);
+        });
+    }
+
+    bool MockAudioServer::GetSinkInputInfo(uint index, pa_sink_input_info_cb_t callback, void* userdata)
+    {
+        bool failure = DrawFailure();
+        return Request(OperationType::QUERY, index, FailReply(callback, userdata),
+                       [this, failure, index, callback, userdata]()
+        {
+            auto sinkInput = m_SinkInputs.find(index);
+            if (failure || (sinkInput == m_SinkInputs.end()))
+            {
+                m_Errno = failure ? m_FailureError : PA_ERR_NOENTITY;
+                callback(nullptr, nullptr, -1, userdata);
+                return;
+            }
+            pa_sink_input_info info;
+            FillSinkInputInfo(sinkInput->second, info);
+            callback(nullptr, &info, 0, userdata);
+            callback(nullptr, nullptr, 1, userdata);
+        });
+    }
+
+    bool MockAudioServer::GetSourceOutputInfoList(pa_source_output_info_cb_t callback, void* userdata)
+    {
+        bool failure = DrawFailure();
+        return Request(OperationType::QUERY, PA_INVALID_INDEX, FailReply(callback, userdata),
+                       [this, failure, callback, userdata]()
+        {
+            if (failure)
+            {
+                m_Errno = m_FailureError;
+                callback(nullptr, nullptr, -1, userdata);
+                return;
+            }
+            pa_source_output_info info;
+            for (auto& sourceOutput : m_SourceOutputs)
+            {
+                FillSourceOutputInfo(sourceOutput.second, info);
+                callback(nullptr, &info, 0, userdata);
+            }
+            callback(nullptr, nullptr, 1, userdata);
+        });
+    }
+
+    bool MockAudioServer::GetSourceOutputInfo(uint index, pa_source_output_info_cb_t callback, void* userdata)
+    {
+        bool failure = DrawFailure();
+        return Request(OperationType::QUERY, index, FailReply(callback, userdata),
+                       [this, failure, index, callback, userdata]()
+        {
+            auto sourceOutput = m_SourceOutputs.find(index);
+            if (failure || (sourceOutput == m_SourceOutputs.end()))
+            {
+                m_Errno = failure ? m_FailureError : PA_ERR_NOENTITY;
+                callback(nullptr, nullptr, -1, userdata);
+                return;
+            }
+            pa_source_output_info info;
+            FillSourceOutputInfo(sourceOutput->second, info);
+            callback(nullptr, &info, 0, userdata);
+            callback(nullptr, nullptr, 1, userdata);
+        });
+    }
+
+    bool MockAudioServer::MoveStream(Streams& streams, pa_subscription_event_type_t facility, uint index,
+                                     const Devices& devices, uint deviceIndex, pa_context_success_cb_t callback,
+                                     void* userdata)
+    {
+        bool failure = DrawFailure();
+        return Request(OperationType::MOVE_STREAM, index, FailReply(callback, userdata),
+                       [this, failure, &streams, facility, index, &devices, deviceIndex, callback, userdata]()
+        {
+            auto stream = streams.find(index);
+            if (failure || (stream == streams.end()) || !devices.count(deviceIndex))
+            {
+                m_Errno = failure ? m_FailureError : PA_ERR_NOENTITY;
+                callback(nullptr, 0, userdata);
+                return;
+            }
+            stream->second.m_Device = deviceIndex;
+            callback(nullptr, 1, userdata);
+            Emit(facility, PA_SUBSCRIPTION_EVENT_CHANGE, index);
+        });
+    }
+
+    bool MockAudioServer::MoveSinkInput(uint index, uint sinkIndex, pa_context_success_cb_t callback, void* userdata)
+    {
+        return MoveStream(m_SinkInputs, PA_SUBSCRIPTION_EVENT_SINK_INPUT, index, m_Sinks, sinkIndex, callback, userdata);
+    }
+
+    bool MockAudioServer::MoveSourceOutput(uint index, uint sourceIndex, pa_context_success_cb_t callback,
+                                           void* userdata)
+    {
+        return MoveStream(m_SourceOutputs, PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT, index, m_Sources, sourceIndex, callback,
+                          userdata);
+    }
+
+    bool MockAudioServer::SetStreamVolume(Streams& streams, pa_subscription_event_type_t facility, uint index,
+                                          const pa_cvolume* volume, pa_context_success_cb_t callback, void* userdata)
+    {
+        bool failure = DrawFailure();
+        pa_cvolume cVolume = *volume;
+        return Request(OperationType::SET_STREAM_VOLUME, index, FailReply(callback, userdata),
+                       [this, failure, &streams, facility, index, cVolume, callback, userdata]()
+        {
+            auto stream = streams.find(index);
+            if (failure || (stream == streams.end()))
+            {
+                m_Errno = failure ? m_FailureError : PA_ERR_NOENTITY;
+                callback(nullptr, 0, userdata);
+                return;
+            }
+            stream->second.m_Volume = cVolume;
+            callback(nullptr, 1, userdata);
+            Emit(facility, PA_SUBSCRIPTION_EVENT_CHANGE, index);
+        });
+    }
+
+    bool MockAudioServer::SetSinkInputVolume(uint index, const pa_cvolume* volume, pa_context_success_cb_t callback,
+                                             void* userdata)
+    {
+        return SetStreamVolume(m_SinkInputs, PA_SUBSCRIPTION_EVENT_SINK_INPUT, index, volume, callback, userdata);
+    }
+
+    bool MockAudioServer::SetSourceOutputVolume(uint index, const pa_cvolume* volume,
+                                                pa_context_success_cb_t callback, void* userdata)
+    {
+        return SetStreamVolume(m_SourceOutputs, PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT, index, volume, callback, userdata);
+    }
+
+    std::unique_ptr<PeakStream> MockAudioServer::OpenPeakStream(uint sourceIndex, uint rate, uint fragment,
+                                                                PeakCallback callback,
+                                                                PeakStreamEndedCallback endedCallback, void* userdata)
+    {
+        bool found = m_Sources.count(sourceIndex) > 0;
+        for (auto sink = m_Sinks.begin(); !found && (sink != m_Sinks.end()); ++sink)
+        {
+            found = sink->second.m_Monitor == sourceIndex;
+        }
+        if (DrawFailure() || !found || !rate || !fragment)
+        {
+            m_Errno = found ? m_FailureError : PA_ERR_NOENTITY;
+            return nullptr;
+        }
+
+        auto peakStream =
+            std::make_unique<MockPeakStream>(this, sourceIndex, rate, fragment, callback, endedCallback, userdata);
+        m_PeakStreams.insert(peakStream.get());
+        pa_usec_t delay = peakStream->m_Interval;
+        if (!m_PeakTimer)
+        {
+            m_PeakTimer = NewTimer(delay, PeakTimerCallback, this);
+        }
+        else if (m_PeakStreams.size() == 1)
+        {
+            RestartTimer(m_PeakTimer, delay);
+        }
+        return peakStream;
+    }
+
+    //
+    // deliver all streams that are due, then sleep until the next one is
+    //
+    void MockAudioServer::PeakTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent, const struct timeval* tv,
+                                            void* userdata)
+    {
+        auto server = static_cast<MockAudioServer*>(userdata);
+        pa_usec_t now = pa_rtclock_now();
+
+        // a callback may close streams, deliver from a copy
+        std::vector<MockPeakStream*> dueStreams;
+        for (auto peakStream : server->m_PeakStreams)
+        {
+            if (peakStream->m_Deadline <= now)
+            {
+                dueStreams.push_back(peakStream);
+            }
+        }
+        for (auto peakStream : dueStreams)
+        {
+            if (server->m_PeakStreams.count(peakStream))
+            {
+                peakStream->Deliver();
+            }
+        }
+
+        if (server->m_PeakStreams.empty())
+        {
+            return;
+        }
+        pa_usec_t deadline = (*server->m_PeakStreams.begin())->m_Deadline;
+        for (auto peakStream : server->m_PeakStreams)
+        {
+            // a stream that fell behind skips the missed fragments
+            if (peakStream->m_Deadline + peakStream->m_Interval <= now)
+            {
+                peakStream->m_Deadline = now + peakStream->m_Interval;
+            }
+            deadline = std::min(deadline, peakStream->m_Deadline);
+        }
+        server->RestartTimer(timeEvent, deadline > now ? deadline - now : 0);
+    }
+
+    //
+    // like the server, which kills the record streams of a source that goes away
+    //
+    void MockAudioServer::EndPeakStreams(uint sourceIndex)
+    {
+        std::vector<MockPeakStream*> endedStreams;
+        for (auto peakStream : m_PeakStreams)
+        {
+            if ((sourceIndex == PA_INVALID_INDEX) || (peakStream->m_SourceIndex == sourceIndex))
+            {
+                endedStreams.push_back(peakStream);
+            }
+        }
+        for (auto peakStream : endedStreams)
+        {
+            // no more peaks, the owner destroys the stream later
+            m_PeakStreams.erase(peakStream);
+            peakStream->m_EndedCallback(peakStream->m_Userdata);
+        }
+    }
+
+    //
+    // cards: the libpulse structures point into the records, they are valid for the callback only
+    //
+    void MockAudioServer::ReplyCardInfo(const Card& card, pa_card_info_cb_t callback, void* userdata)
+    {
+        std::vector<pa_card_profile_info> profiles(card.m_Profiles.size());
+        std::vector<pa_card_profile_info2> profiles2(card.m_Profiles.size());
+        std::vector<pa_card_profile_info2*> profilePointers;
+        std::vector<pa_card_profile_info2*> outputProfiles;
+        for (size_t profile = 0; profile < card.m_Profiles.size(); profile++)
+        {
+            auto& record = card.m_Profiles[profile];
+            profiles[profile] = {record.m_Name.c_str(), record.m_Description.c_str(), record.m_Sinks, record.m_Sources,
+                                 static_cast<uint32_t>(profile)};
+            profiles2[profile] = {record.m_Name.c_str(), record.m_Description.c_str(), record.m_Sinks, record.m_Sources,
+                                  static_cast<uint32_t>(profile), 1};
+            profilePointers.push_back(&profiles2[profile]);
+            if (record.m_Sinks)
+            {
+                outputProfiles.push_back(&profiles2[profile]);
+            }
+        }
+
+        pa_card_port_info outputPort = {};
+        outputPort.name = "analog-output";
+        outputPort.description = "Analog Output";
+        outputPort.available = PA_PORT_AVAILABLE_UNKNOWN;
+        outputPort.direction = PA_DIRECTION_OUTPUT;
+        outputPort.n_profiles = static_cast<uint32_t>(outputProfiles.size());
+        outputPort.profiles2 = outputProfiles.data();
+        pa_card_port_info* ports[] = {&outputPort};
+
+        pa_card_info info = {};
+        info.index = card.m_Index;
+        info.name = card.m_Name.c_str();
+        info.owner_module = PA_INVALID_INDEX;
+        info.driver = "mock";
+        info.n_profiles = static_cast<uint32_t>(profiles.size());
+        info.profiles = profiles.data();
+        info.active_profile = &profiles[card.m_ActiveProfile];
+        info.profiles2 = profilePointers.data();
+        info.active_profile2 = profilePointers[card.m_ActiveProfile];
+        info.n_ports = 1;
+        info.ports = ports;
+        callback(nullptr, &info, 0, userdata);
+    }
+
+    bool MockAudioServer::GetCardInfoList(pa_card_info_cb_t callback, void* userdata)
+    {
+        bool failure = DrawFailure();
+        return Request(OperationType::QUERY, PA_INVALID_INDEX, FailReply(callback, userdata),
+                       [this, failure, callback, userdata]()
+        {
+            if (failure)
+            {
+                m_Errno = m_FailureError;
+                callback(nullptr, nullptr, -1, userdata);
+                return;
+            }
+            for (auto& card : m_Cards)
+            {
+                ReplyCardInfo(card.second, callback, userdata);
+            }
+            callback(nullptr, nullptr, 1, userdata);
+        });
+    }
+
+    bool MockAudioServer::GetCardInfoByIndex(uint index, pa_card_info_cb_t callback, void* userdata)
+    {
+        bool failure = DrawFailure();
+        return Request(OperationType::QUERY, index, FailReply(callback, userdata),
+                       [this, failure, index, callback, userdata]()
+        {
+            auto card = m_Cards.find(index);
+            if (failure || (card == m_Cards.end()))
+            {
+                m_Errno = failure ? m_FailureError : PA_ERR_NOENTITY;
+                callback(nullptr, nullptr, -1, userdata);
+                return;
+            }
+            ReplyCardInfo(card->second, callback, userdata);
+            callback(nullptr, nullptr, 1, userdata);
+        });
+    }
+
+    bool MockAudioServer::SetCardProfileByIndex(uint index, const char* profile, pa_context_success_cb_t callback,
+                                                void* userdata)
+    {
+        bool failure = DrawFailure();
+        std::string profileName = profile;
+        return Request(OperationType::SET_CARD_PROFILE, index, FailReply(callback, userdata),
+                       [this, failure, index, profileName, callback, userdata]()
+        {
+            auto card = m_Cards.find(index);
+            size_t activeProfile = 0;
+            if (card != m_Cards.end())
+            {
+                while ((activeProfile < card->second.m_Profiles.size()) &&
+                       (card->second.m_Profiles[activeProfile].m_Name != profileName))
+                {
+                    activeProfile++;
+                }
+            }
+            if (failure || (card == m_Cards.end()) || (activeProfile == card->second.m_Profiles.size()))
+            {
+                m_Errno = failure ? m_FailureError : PA_ERR_NOENTITY;
+                callback(nullptr, 0, userdata);
+                return;
+            }
+            if (activeProfile != card->second.m_ActiveProfile)
+            {
+                RemoveCardDevices(card->second);
+                card->second.m_ActiveProfile = activeProfile;
+                AddCardDevices(card->second);
+                Emit(PA_SUBSCRIPTION_EVENT_CARD, PA_SUBSCRIPTION_EVENT_CHANGE, index);
+            }
+            callback(nullptr, 1, userdata);
+        });
+    }
+
+    void MockAudioServer::AddCard(uint card)
+    {
+        uint index = m_NextIndex++;
+        auto name = "mock_card_" + std::to_string(card);
+        auto description = "Mock Card " + std::to_string(card);
+        m_Cards[index] = {index,
+                          name,
+                          description,
+                          {{"off", "Off", 0, 0},
+                           {"output:analog-stereo", "Analog Stereo Output", 1, 0},
+                           {"output:analog-stereo+input:analog-mono", "Analog Stereo Duplex", 1, 1}},
+                          2};
+        AddCardDevices(m_Cards[index]);
+        Emit(PA_SUBSCRIPTION_EVENT_CARD, PA_SUBSCRIPTION_EVENT_NEW, index);
+    }
+
+    void MockAudioServer::AddCardDevices(const Card& card)
+    {
+        auto& profile = card.m_Profiles[card.m_ActiveProfile];
+        for (uint sink = 0; sink < profile.m_Sinks; sink++)
+        {
+            AddDevice(m_Sinks, PA_SUBSCRIPTION_EVENT_SINK, card.m_Name + ".analog-stereo." + std::to_string(sink),
+                      card.m_Description + " Analog Stereo", card.m_Index);
+        }
+        for (uint source = 0; source < profile.m_Sources; source++)
+        {
+            AddDevice(m_Sources, PA_SUBSCRIPTION_EVENT_SOURCE, card.m_Name + ".analog-mono." + std::to_string(source),
+                      card.m_Description + " Analog Mono", card.m_Index);
+        }
+    }
+
+    // like the server, a removed default falls back to the first remaining device
+    void MockAudioServer::RemoveCardDevices(const Card& card)
+    {
+        bool defaultChanged = false;
+        for (auto devices : {std::make_pair(&m_Sinks, PA_SUBSCRIPTION_EVENT_SINK),
+                             std::make_pair(&m_Sources, PA_SUBSCRIPTION_EVENT_SOURCE)})
+        {
+            auto& defaultDevice = devices.first == &m_Sinks ? m_DefaultSink : m_DefaultSource;
+            for (auto device = devices.first->begin(); device != devices.first->end();)
+            {
+                if (device->second.m_Card != card.m_Index)
+                {
+                    ++device;
+                    continue;
+                }
+                uint index = device->first;
+                EndPeakStreams(devices.first == &m_Sinks ? device->second.m_Monitor : index);
+                if (device->second.m_Name == defaultDevice)
+                {
+                    defaultDevice.clear();
+                    defaultChanged = true;
+                }
+                device = devices.first->erase(device);
+                Emit(devices.second, PA_SUBSCRIPTION_EVENT_REMOVE, index);
+            }
+            if (defaultDevice.empty() && !devices.first->empty())
+            {
+                defaultDevice = devices.first->begin()->second.m_Name;
+            }
+        }
+        if (defaultChanged)
+        {
+            Emit(PA_SUBSCRIPTION_EVENT_SERVER, PA_SUBSCRIPTION_EVENT_CHANGE, PA_INVALID_INDEX);
+        }
+    }
+
+    void MockAudioServer::AddDevice(Devices& devices, pa_subscription_event_type_t facility, const std::string& name,
+                                    const std::string& description, uint card)
+    {
+        uint index = m_NextIndex++;
+        uint monitor = facility == PA_SUBSCRIPTION_EVENT_SINK ? m_NextIndex++ : PA_INVALID_INDEX;
+        devices[index] = {index, name, description, {}, monitor, card};
+        pa_cvolume_set(&devices[index].m_Volume, 2, PA_VOLUME_NORM);
+        Emit(facility, PA_SUBSCRIPTION_EVENT_NEW, index);
+    }
+
+    void MockAudioServer::RemoveDevice(Devices& devices, pa_subscription_event_type_t facility, const std::string& name)
+    {
+        for (auto device = devices.begin(); device != devices.end(); ++device)
+        {
+            if (device->second.m_Name == name)
+            {
+                uint index = device->first;
+                EndPeakStreams(&devices == &m_Sinks ? device->second.m_Monitor : index);
+                devices.erase(device);
+                Emit(facility, PA_SUBSCRIPTION_EVENT_REMOVE, index);
+                return;
+            }
+        }
+    }
+
+    void MockAudioServer::AddStream(Streams& streams, pa_subscription_event_type_t facility,
+                                    const std::string& application, const Devices& devices, const std::string& device)
+    {
+        uint deviceIndex = PA_INVALID_INDEX;
+        for (auto& candidate : devices)
+        {
+            if (candidate.second.m_Name == device)
+            {
+                deviceIndex = candidate.first;
+                break;
+            }
+        }
+        uint index = m_NextIndex++;
+        streams[index] = {index, m_NextClient++, application, deviceIndex, {}};
+        pa_cvolume_set(&streams[index].m_Volume, 2, PA_VOLUME_NORM);
+        Emit(facility, PA_SUBSCRIPTION_EVENT_NEW, index);
+    }
+
+    void MockAudioServer::RemoveStream(Streams& streams, pa_subscription_event_type_t facility,
+                                       const std::string& application)
+    {
+        for (auto stream = streams.begin(); stream != streams.end(); ++stream)
+        {
+            if (stream->second.m_Application == application)
+            {
+                uint index = stream->first;
+                streams.erase(stream);
+                Emit(facility, PA_SUBSCRIPTION_EVENT_REMOVE, index);
+                return;
+            }
+        }
+    }
+
+    void MockAudioServer::AddSink(const std::string& name, const std::string& description)
+    {
+        PostChange([this, name, description]() { AddDevice(m_Sinks, PA_SUBSCRIPTION_EVENT_SINK, name, description); });
+    }
+
+    void MockAudioServer::RemoveSink(const std::string& name)
+    {
+        PostChange([this, name]() { RemoveDevice(m_Sinks, PA_SUBSCRIPTION_EVENT_SINK, name); });
+    }
+
+    void MockAudioServer::SetSinkDescription(const std::string& name, const std::string& description)
+    {
+        PostChange([this, name, description]()
+        {
+            for (auto& sink : m_Sinks)
+            {
+                if (sink.second.m_Name == name)
+                {
+                    sink.second.m_Description = description;
+                    Emit(PA_SUBSCRIPTION_EVENT_SINK, PA_SUBSCRIPTION_EVENT_CHANGE, sink.first);
+                    return;
+                }
+            }
+        });
+    }
+
+    void MockAudioServer::AddSource(const std::string& name, const std::string& description)
+    {
+        PostChange([this, name, description]()
+                   { AddDevice(m_Sources, PA_SUBSCRIPTION_EVENT_SOURCE, name, description); });
+    }
+
+    void MockAudioServer::RemoveSource(const std::string& name)
+    {
+        PostChange([this, name]() { RemoveDevice(m_Sources, PA_SUBSCRIPTION_EVENT_SOURCE, name); });
+    }
+
+    void MockAudioServer::AddSinkInput(const std::string& application)
+    {
+        PostChange([this, application]()
+                   { AddStream(m_SinkInputs, PA_SUBSCRIPTION_EVENT_SINK_INPUT, application, m_Sinks, m_DefaultSink); });
+    }
+
+    void MockAudioServer::RemoveSinkInput(const std::string& application)
+    {
+        PostChange([this, application]() { RemoveStream(m_SinkInputs, PA_SUBSCRIPTION_EVENT_SINK_INPUT, application); });
+    }
+
+    void MockAudioServer::AddSourceOutput(const std::string& application)
+    {
+        PostChange([this, application]()
+        {
+            AddStream(m_SourceOutputs, PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT, application, m_Sources, m_DefaultSource);
+        });
+    }
+
+    void MockAudioServer::RemoveSourceOutput(const std::string& application)
+    {
+        PostChange([this, application]()
+                   { RemoveStream(m_SourceOutputs, PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT, application); });
+    }
+
+    //
+    // replies and subscription events of the old connection are lost, the client has to subscribe again;
+    // the indices are kept, which a client must not rely on
+    //
+    void MockAudioServer::Restart(pa_usec_t downtime)
+    {
+        PostChange([this, downtime]()
+        {
+            m_DownUntil = pa_rtclock_now() + downtime;
+            m_Replies.clear();
+            m_SubscribeCallback = nullptr;
+            m_SubscriptionMask = PA_SUBSCRIPTION_MASK_NULL;
+            m_Errno = PA_ERR_CONNECTIONTERMINATED;
+            EndPeakStreams(PA_INVALID_INDEX);
+            SetState(PA_CONTEXT_FAILED);
+        });
+    }
+
+    void MockAudioServer::PostChange(std::function<void()> change)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_ChangesMutex);
+            m_Changes.push_back(std::move(change));
+        }
+        uint64_t value = 1;
+        if (write(m_WakeupFd, &value, sizeof(value)) != sizeof(value))
+        {
+            // the counter is already non-zero, the mainloop will wake up anyway
+        }
+    }
+
+    void MockAudioServer::WakeupCallback(pa_mainloop_api* api, pa_io_event* ioEvent, int fd, pa_io_event_flags_t flags,
+                                         void* userdata)
+    {
+        auto server = static_cast<MockAudioServer*>(userdata);
+        uint64_t value;
+        if (read(fd, &value, sizeof(value)) != sizeof(value))
+        {
+            return;
+        }
+
+        std::vector<std::function<void()>> changes;
+        {
+            std::lock_guard<std::mutex> lock(server->m_ChangesMutex);
+            changes.swap(server->m_Changes);
+        }
+        for (auto& change : changes)
+        {
+            change();
+        }
+    }
+}
@@ -0,0 +1,236 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "AudioServer.h"
+
+namespace LibPAmanager
+{
+    //
+    // deterministic in-process AudioServer for load tests and CI, no daemon required;
+    // replies are delivered on the mainloop after a configurable latency; not part of the
+    // library, the bench and the tests build it from this directory
+    //
+    class MockAudioServer : public AudioServer
+    {
+    public:
+        struct Configuration
+        {
+            uint m_Sinks = 2;
+            uint m_Sources = 1;
+            uint m_SinkInputs = 0;              // playback streams on the first sink
+            uint m_SourceOutputs = 0;           // record streams on the first source
+            uint m_Cards = 0;                   // with an off, an output and an output + input profile
+            pa_usec_t m_Latency = 0;            // per reply
+            double m_FailureRate = 0.0;         // fraction of requests that fail
+            int m_FailureError = PA_ERR_INTERNAL;
+            double m_HangRate = 0.0;            // fraction of requests that are never answered
+            uint32_t m_Seed = 1;                // failures are drawn from a seeded generator
+        };
+
+    public:
+        MockAudioServer();
+        explicit MockAudioServer(const Configuration& configuration);
+        ~MockAudioServer() override;
+
+        // can be called from any thread, the change is applied on the mainloop thread
+        void AddSink(const std::string& name, const std::string& description);
+        void RemoveSink(const std::string& name);
+        void SetSinkDescription(const std::string& name, const std::string& description);
+        void AddSource(const std::string& name, const std::string& description);
+        void RemoveSource(const std::string& name);
+        // streams are attached to the default sink or source, removed by application name
+        void AddSinkInput(const std::string& application);
+        void RemoveSinkInput(const std::string& application);
+        void AddSourceOutput(const std::string& application);
+        void RemoveSourceOutput(const std::string& application);
+        void SetLatency(pa_usec_t latency) { m_Latency.store(latency, std::memory_order_relaxed); }
+        void SetFailureRate(double failureRate) { m_FailureRate.store(failureRate, std::memory_order_relaxed); }
+        void SetHangRate(double hangRate) { m_HangRate.store(hangRate, std::memory_order_relaxed); }
+        // the connection fails, connecting is refused for the downtime; devices and streams survive
+        void Restart(pa_usec_t downtime);
+        uint64_t GetRequestCount() const { return m_Requests.load(std::memory_order_relaxed); }
+
+        bool Connect(const char* server, pa_context_notify_cb_t stateCallback, void* userdata) override;
+        pa_context_state_t GetState() const override { return m_State; }
+        int GetErrno() const override;
+
+        bool GetServerInfo(pa_server_info_cb_t callback, void* userdata) override;
+        bool GetSinkInfoList(pa_sink_info_cb_t callback, void* userdata) override;
+        bool GetSinkInfoByIndex(uint index, pa_sink_info_cb_t callback, void* userdata) override;
+        bool GetSourceInfoList(pa_source_info_cb_t callback, void* userdata) override;
+        bool GetSourceInfoByIndex(uint index, pa_source_info_cb_t callback, void* userdata) override;
+        bool Subscribe(pa_subscription_mask_t mask, pa_context_subscribe_cb_t callback, void* userdata,
+                       pa_context_success_cb_t successCallback, void* successUserdata) override;
+        bool SetDefaultSink(const char* name, pa_context_success_cb_t callback, void* userdata) override;
+        bool SetSinkVolumeByIndex(uint index, const pa_cvolume* volume, pa_context_success_cb_t callback,
+                                  void* userdata) override;
+
+        bool GetSinkInputInfoList(pa_sink_input_info_cb_t callback, void* userdata) override;
+        bool GetSinkInputInfo(uint index, pa_sink_input_info_cb_t callback, void* userdata) override;
+        bool GetSourceOutputInfoList(pa_source_output_info_cb_t callback, void* userdata) override;
+        bool GetSourceOutputInfo(uint index, pa_source_output_info_cb_t callback, void* userdata) override;
+        bool MoveSinkInput(uint index, uint sinkIndex, pa_context_success_cb_t callback, void* userdata) override;
+        bool MoveSourceOutput(uint index, uint sourceIndex, pa_context_success_cb_t callback, void* userdata) override;
+        bool SetSinkInputVolume(uint index, const pa_cvolume* volume, pa_context_success_cb_t callback,
+                                void* userdata) override;
+        bool SetSourceOutputVolume(uint index, const pa_cvolume* volume, pa_context_success_cb_t callback,
+                                   void* userdata) override;
+
+        // a profile switch replaces the sinks and sources of the card
+        bool GetCardInfoList(pa_card_info_cb_t callback, void* userdata) override;
+        bool GetCardInfoByIndex(uint index, pa_card_info_cb_t callback, void* userdata) override;
+        bool SetCardProfileByIndex(uint index, const char* profile, pa_context_success_cb_t callback,
+                                   void* userdata) override;
+
+        // synthetic peaks, sinks are metered on their monitor source (which is not listed as a source)
+        std::unique_ptr<PeakStream> OpenPeakStream(uint sourceIndex, uint rate, uint fragment, PeakCallback callback,
+                                                   PeakStreamEndedCallback endedCallback, void* userdata) override;
+
+    private:
+        struct Device
+        {
+            uint m_Index;
+            std::string m_Name;
+            std::string m_Description;
+            pa_cvolume m_Volume;
+            uint m_Monitor; // sinks: PA index of the monitor source
+            uint m_Card;
+        };
+        using Devices = std::map<uint, Device>;
+
+        struct Card
+        {
+            struct Profile
+            {
+                std::string m_Name;
+                std::string m_Description;
+                uint m_Sinks;
+                uint m_Sources;
+            };
+
+            uint m_Index;
+            std::string m_Name;
+            std::string m_Description;
+            std::vector<Profile> m_Profiles;
+            size_t m_ActiveProfile;
+        };
+        using Cards = std::map<uint, Card>;
+
+        struct Stream
+        {
+            uint m_Index;
+            uint m_Client;
+            std::string m_Application;
+            uint m_Device;
+            pa_cvolume m_Volume;
+        };
+        using Streams = std::map<uint, Stream>;
+
+        class MockPeakStream;
+
+        void Reply(std::function<void()> reply);
+        bool Request(OperationType type, uint key, std::function<void()> fail, std::function<void()> reply);
+        bool DrawFailure();
+        bool DrawHang();
+        void Emit(pa_subscription_event_type_t facility, pa_subscription_event_type_t type, uint index);
+        void SetState(pa_context_state_t state);
+        void AddDevice(Devices& devices, pa_subscription_event_type_t facility, const std::string& name,
+                       const std::string& description, uint card = PA_INVALID_INDEX);
+        void AddCard(uint card);
+        void AddCardDevices(const Card& card);
+        void RemoveCardDevices(const Card& card);
+        static void ReplyCardInfo(const Card& card, pa_card_info_cb_t callback, void* userdata);
+        void RemoveDevice(Devices& devices, pa_subscription_event_type_t facility, const std::string& name);
+        void EndPeakStreams(uint sourceIndex); // PA_INVALID_INDEX: all
+        void AddStream(Streams& streams, pa_subscription_event_type_t facility, const std::string& application,
+                       const Devices& devices, const std::string& device);
+        void RemoveStream(Streams& streams, pa_subscription_event_type_t facility, const std::string& application);
+        bool MoveStream(Streams& streams, pa_subscription_event_type_t facility, uint index, const Devices& devices,
+                        uint deviceIndex, pa_context_success_cb_t callback, void* userdata);
+        bool SetStreamVolume(Streams& streams, pa_subscription_event_type_t facility, uint index,
+                             const pa_cvolume* volume, pa_context_success_cb_t callback, void* userdata);
+        void PostChange(std::function<void()> change);
+        static void FillSinkInfo(const Device& device, pa_sink_info& info);
+        static void FillSourceInfo(const Device& device, pa_source_info& info);
+        void FillSinkInputInfo(const Stream& stream, pa_sink_input_info& info);
+        void FillSourceOutputInfo(const Stream& stream, pa_source_output_info& info);
+        static void ReplyTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent, const struct timeval* tv,
+                                       void* userdata);
+        static void PeakTimerCallback(pa_mainloop_api* api, pa_time_event* timeEvent, const struct timeval* tv,
+                                      void* userdata);
+        static void WakeupCallback(pa_mainloop_api* api, pa_io_event* ioEvent, int fd, pa_io_event_flags_t flags,
+                                   void* userdata);
+
+    private:
+        std::atomic<pa_usec_t> m_Latency;
+        std::atomic<double> m_FailureRate;
+        int m_FailureError;
+        std::atomic<double> m_HangRate;
+        std::mt19937 m_RandomGenerator;
+        std::atomic<uint64_t> m_Requests{0};
+
+        // server state, only accessed on the mainloop thread
+        Devices m_Sinks;
+        Devices m_Sources;
+        Streams m_SinkInputs;
+        Streams m_SourceOutputs;
+        Cards m_Cards;
+        uint m_NextIndex = 0;
+        uint m_NextClient = 0;
+        pa_proplist* m_Proplist; // reused for the stream infos
+        std::string m_DefaultSink;
+        std::string m_DefaultSource;
+        pa_context_state_t m_State = PA_CONTEXT_UNCONNECTED;
+        pa_usec_t m_DownUntil = 0;
+        int m_Errno = PA_OK;
+        pa_context_notify_cb_t m_StateCallback = nullptr;
+        void* m_StateUserdata = nullptr;
+        pa_context_subscribe_cb_t m_SubscribeCallback = nullptr;
+        void* m_SubscribeUserdata = nullptr;
+        pa_subscription_mask_t m_SubscriptionMask = PA_SUBSCRIPTION_MASK_NULL;
+
+        // pending replies by deadline, equal deadlines keep their order
+        std::multimap<pa_usec_t, std::function<void()>> m_Replies;
+        pa_time_event* m_ReplyTimer = nullptr;
+
+        // open peak streams, all driven by one timer
+        std::set<MockPeakStream*> m_PeakStreams;
+        pa_time_event* m_PeakTimer = nullptr;
+
+        // changes requested from other threads, signalled through an eventfd
+        std::mutex m_ChangesMutex;
+        std::vector<std::function<void()>> m_Changes;
+        int m_WakeupFd;
+        pa_io_event* m_WakeupEvent = nullptr;
+    };
+}
@@ -40,4 +40,83 @@ project "testApplication"
         defines { "NDEBUG" }
         optimize "On"
 
+project "pamanagerBench"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+    targetdir "bin/%{cfg.buildcfg}"
+    buildoptions { "-fdiagnostics-color=always -Wall -Wextra -Wno-unused-parameter" }
+
+    defines
+    {
+        "LIBPAMANAGER_VERSION=\"0.1.0\"",
+    }
+
+    files 
+    { 
+        "bench/**.h", 
+        "bench/**.cpp",
+        "mock/**.h", 
+        "mock/**.cpp",
+    }
+
+    includedirs 
+    { 
+        "bench",
+        "mock",
+        "libpamanager/src"
+    }
+
+    links
+    {
+        "libpamanager",
+        "pulse",
+        "pthread"
+    }
+
+    filter { "configurations:Debug" }
+        defines { "DEBUG", "VERBOSE" }
+        symbols "On"
+
+    filter { "configurations:Release" }
+        defines { "NDEBUG" }
+        optimize "On"
+
+project "pamanagerTests"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+    targetdir "bin/%{cfg.buildcfg}"
+    buildoptions { "-fdiagnostics-color=always -Wall -Wextra -Wno-unused-parameter" }
+
+    files 
+    { 
+        "tests/**.h", 
+        "tests/**.cpp",
+        "mock/**.h", 
+        "mock/**.cpp",
+    }
+
+    includedirs 
+    { 
+        "tests",
+        "mock",
+        "libpamanager/src"
+    }
+
+    links
+    {
+        "libpamanager",
+        "pulse",
+        "pthread"
+    }
+
+    filter { "configurations:Debug" }
+        defines { "DEBUG", "VERBOSE" }
+        symbols "On"
+
+    filter { "configurations:Release" }
+        defines { "NDEBUG" }
+        optimize "On"
+
 include "libpamanager/libpamanager.lua"
@@ -33,11 +33,6 @@ using namespace LibPAmanager;
 void OnEnter(SoundDeviceManager* soundDeviceManager);
 void InitSound(SoundDeviceManager* soundDeviceManager);
 
-namespace TestSuite
-{
-    bool g_DeviceManagerReady = false;
-}
-
 //
 // test application with a main thread
 //
@@ -62,10 +57,11 @@ int main()
     std::thread onEnter(OnEnter, soundDeviceManager);
 
     // wait until device manager is online
-    do
+    if (!soundDeviceManager->WaitUntilReady(10s))
     {
-        std::this_thread::sleep_for(1ms);
-    } while (!TestSuite::g_DeviceManagerReady);
+        PrintMessage(Color::FG_RED, "device manager not ready");
+        return 1;
+    }
 
     // profiling: calculate elapsed time since start
     auto endTime = std::chrono::high_resolution_clock::now();
@@ -74,22 +70,20 @@ int main()
     auto elapsedTime = end - start;
     PrintMessage(Color::FG_BLUE, std::string("elapsed time in milliseconds: ") + std::to_string(elapsedTime.count()));
 
-    uint volume = 0;
+    // sweep the volume up to 100 percent in 80 s, then start over from silence;
+    // the steps are taken on the device manager's thread
     while(true)
     {
         LOG_MESSAGE("main thread\n");
 
-        // get volume
-        volume = soundDeviceManager->GetVolume();
-
-        // set volume
-        volume += 1;
-        if (volume >= 100)
+        auto result = soundDeviceManager->RampVolume(100, 80s, VolumeCurve::CUBIC).get();
+        if (!result.m_Success)
         {
-            volume = 0;
+            // no output device, or the output device changed
+            std::this_thread::sleep_for(800ms);
+            continue;
         }
-        soundDeviceManager->SetVolume(volume);
-        std::this_thread::sleep_for(800ms);   
+        soundDeviceManager->SetVolume(0);
     }
 }
 
@@ -98,7 +92,17 @@ int main()
 //
 void InitSound(SoundDeviceManager* soundDeviceManager)
 {
+    // show the devices of the last run right away
+    soundDeviceManager->SetDeviceCacheFile(".pamanager_devices");
     soundDeviceManager->Start();
+    soundDeviceManager->EnableLevelMeters(true);
+    if (soundDeviceManager->GetSnapshot()->m_Stale)
+    {
+        for (auto& device : *soundDeviceManager->GetOutputDeviceList())
+        {
+            PrintMessage(Color::FG_BLUE, std::string("cached output device: ").append(device));
+        }
+    }
     
     // the callback is called from the sound device manager's thread
     soundDeviceManager->SetCallback([=](const LibPAmanager::Event& event)
@@ -110,42 +114,96 @@ void InitSound(SoundDeviceManager* soundDeviceManager)
         {
             case LibPAmanager::Event::DEVICE_MANAGER_READY:
             {
-                TestSuite::g_DeviceManagerReady = true;
+                auto timeToReady = soundDeviceManager->GetTimeToReady();
+                PrintMessage(Color::FG_BLUE, std::string("time to ready in microseconds: ") +
+                                             std::to_string(timeToReady.count()));
                 break;
             }
             case LibPAmanager::Event::OUTPUT_DEVICE_CHANGED:
             {
                 auto device = soundDeviceManager->GetDefaultOutputDevice();
-                PrintMessage(Color::FG_BLUE, std::string("output device changed to: ") + device);
+                PrintMessage(Color::FG_BLUE, std::string("output device changed to: ").append(device));
                 break;
             }
             case LibPAmanager::Event::OUTPUT_DEVICE_LIST_CHANGED:
+            case LibPAmanager::Event::INPUT_DEVICE_LIST_CHANGED:
             {
-                auto outputDeviceList = soundDeviceManager->GetOutputDeviceList();
-                // user code goes here
-                for (auto device : outputDeviceList)
+                // user code goes here: only what changed is reported, the full lists stay in the snapshot
+                std::string list = eventType == LibPAmanager::Event::OUTPUT_DEVICE_LIST_CHANGED ? "output" : "input";
+                auto& change = *event.GetDeviceListChange();
+                for (auto& device : change.m_Added)
+                {
+                    PrintMessage(Color::FG_BLUE, list + " device added: " + device.m_Description.c_str());
+                }
+                for (auto& device : change.m_Removed)
+                {
+                    PrintMessage(Color::FG_BLUE, list + " device removed: " + device.m_Description.c_str());
+                }
+                for (auto& device : change.m_Modified)
                 {
-                    PrintMessage(Color::FG_BLUE, std::string("list all output devices: ") + device);
+                    PrintMessage(Color::FG_BLUE, list + " device renamed: " + device.m_Description.c_str());
+                }
+                if (change.m_Reset)
+                {
+                    auto deviceList = eventType == LibPAmanager::Event::OUTPUT_DEVICE_LIST_CHANGED
+                                          ? soundDeviceManager->GetOutputDeviceList()
+                                          : soundDeviceManager->GetInputDeviceList();
+                    for (auto& device : *deviceList)
+                    {
+                        PrintMessage(Color::FG_BLUE, ("list all " + list + " devices: ").append(device));
+                    }
                 }
                 break;
             }
             case LibPAmanager::Event::OUTPUT_DEVICE_VOLUME_CHANGED:
             {
-                auto volume = soundDeviceManager->GetVolume();
                 // user code goes here
-                PrintMessage(Color::FG_BLUE, std::string("output volume changed to: ") + std::to_string(volume));
+                PrintMessage(Color::FG_BLUE, std::string("output volume changed from ") +
+                                                 std::to_string(event.GetOldVolume()) + " to " +
+                                                 std::to_string(event.GetNewVolume()));
                 break;
             }
-            case LibPAmanager::Event::INPUT_DEVICE_LIST_CHANGED:
+            case LibPAmanager::Event::PLAYBACK_STREAM_LIST_CHANGED:
+            case LibPAmanager::Event::RECORD_STREAM_LIST_CHANGED:
             {
-                auto inputDeviceList  = soundDeviceManager->GetInputDeviceList();
-                // user code goes here
-                for (auto device : inputDeviceList)
+                bool playback = eventType == LibPAmanager::Event::PLAYBACK_STREAM_LIST_CHANGED;
+                auto streams = playback ? soundDeviceManager->GetPlaybackStreams() : soundDeviceManager->GetRecordStreams();
+                for (auto& stream : *streams)
                 {
-                    PrintMessage(Color::FG_BLUE, std::string("list all input devices: ") + device);
+                    PrintMessage(Color::FG_BLUE, std::string(playback ? "playback" : "record") + " stream: " +
+                                                     stream.m_Application + " (" + stream.m_Name + "), volume " +
+                                                     std::to_string(stream.m_Volume));
                 }
                 break;
             }
+            case LibPAmanager::Event::CARD_LIST_CHANGED:
+            {
+                for (auto& card : *soundDeviceManager->GetCards())
+                {
+                    PrintMessage(Color::FG_BLUE, std::string("card: ") + card.m_Description + ", profile " +
+                                                     card.m_ActiveProfile + " of " +
+                                                     std::to_string(card.m_Profiles->size()));
+                }
+                break;
+            }
+            case LibPAmanager::Event::CONNECTION_RESTORED:
+            {
+                // from the loss of the connection to the resynced registry
+                auto stats = soundDeviceManager->GetStats();
+                PrintMessage(Color::FG_BLUE, std::string("reconnect time: ") +
+                                                 ToJSON(stats.m_OperationRoundTrip[SoundDeviceManager::Stats::RECONNECT]));
+                break;
+            }
+            case LibPAmanager::Event::CONNECTION_LOST:
+            case LibPAmanager::Event::OUTPUT_DEVICE_ADDED:
+            case LibPAmanager::Event::OUTPUT_DEVICE_REMOVED:
+            case LibPAmanager::Event::INPUT_DEVICE_ADDED:
+            case LibPAmanager::Event::INPUT_DEVICE_REMOVED:
+            {
+                // the list changed events above report the new lists; until the connection
+                // is restored the snapshot is stale
+                break;
+            }
         }
     });
 }
@@ -161,7 +219,27 @@ void OnEnter(SoundDeviceManager* soundDeviceManager)
 
         soundDeviceManager->PrintInputDeviceList();
         soundDeviceManager->PrintOutputDeviceList();
+        PrintMessage(Color::FG_BLUE, std::string("stats: ") + soundDeviceManager->GetStats().ToJSON());
 
-        soundDeviceManager->CycleNextOutputDevice();
+        auto snapshot = soundDeviceManager->GetSnapshot();
+        for (auto& deviceLevel : *soundDeviceManager->GetLevels())
+        {
+            auto& records = deviceLevel.m_Output ? snapshot->m_OutputDeviceRecords : snapshot->m_InputDeviceRecords;
+            for (auto& record : records)
+            {
+                if (record.m_Handle == deviceLevel.m_Device)
+                {
+                    PrintMessage(Color::FG_BLUE, std::string("level of ") + record.m_Description.c_str() + ": peak " +
+                                                     std::to_string(deviceLevel.m_Level.m_Peak));
+                }
+            }
+        }
+
+        // block until the server has acknowledged the switch
+        auto result = soundDeviceManager->CycleNextOutputDevice().get();
+        if (!result.m_Success)
+        {
+            PrintMessage(Color::FG_RED, std::string("could not switch output device: ") + pa_strerror(result.m_Error));
+        }
     }
 }
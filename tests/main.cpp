@@ -0,0 +1,623 @@
+/* Engine Copyright (c) 2021 Engine Development Team
+   https://github.com/beaumanvienna/gfxRenderEngine
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation files
+   (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "main.h"
+#include "DeviceCache.h"
+#include "Statistics.h"
+#include "VolumeCurve.h"
+#include "SoundDeviceManager.h"
+#include "MockAudioServer.h"
+
+using namespace std::chrono_literals;
+using namespace LibPAmanager;
+
+//
+// pamanagerTests: runs the device manager against the in-process MockAudioServer,
+// no daemon required; exits with 1 when a check failed
+//
+namespace Tests
+{
+    constexpr auto EVENT_TIMEOUT = 5s;
+    constexpr auto QUIET_PERIOD = 300ms; // to tell that an event did not come
+
+    uint g_Checks = 0;
+    uint g_Failures = 0;
+
+    #define CHECK(condition) Check((condition), #condition, __FILE__, __LINE__)
+
+    bool Check(bool condition, const char* expression, const char* file, int line)
+    {
+        g_Checks++;
+        if (!condition)
+        {
+            g_Failures++;
+            PrintMessage(Color::FG_RED, std::string("    failed: ") + expression + " (" + file + ":" +
+                                            std::to_string(line) + ")");
+        }
+        return condition;
+    }
+
+    // polls condition, for state that changes without an event
+    bool WaitUntil(std::function<bool()> condition, std::chrono::milliseconds timeout = EVENT_TIMEOUT)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!condition())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(1ms);
+        }
+        return true;
+    }
+
+    // copies of the events of one manager, recorded on the PA thread
+    class EventRecorder
+    {
+    public:
+        void Record(const Event& event)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Events.push_back(event);
+            }
+            m_Condition.notify_all();
+        }
+
+        // waits until predicate is true for the recorded events
+        bool WaitFor(std::function<bool(const std::vector<Event>&)> predicate,
+                     std::chrono::milliseconds timeout = EVENT_TIMEOUT)
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            return m_Condition.wait_for(lock, timeout, [&]() { return predicate(m_Events); });
+        }
+
+        bool WaitForCount(Event::EventType type, size_t count, std::chrono::milliseconds timeout = EVENT_TIMEOUT)
+        {
+            return WaitFor([&](const std::vector<Event>& events) { return Count(events, type) >= count; }, timeout);
+        }
+
+        size_t Count(Event::EventType type)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            return Count(m_Events, type);
+        }
+
+        // the initial device lists are reported before DEVICE_MANAGER_READY, tests start after them
+        void Clear()
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Events.clear();
+        }
+
+        std::vector<Event> GetEvents()
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            return m_Events;
+        }
+
+        static size_t Count(const std::vector<Event>& events, Event::EventType type)
+        {
+            size_t count = 0;
+            for (auto& event : events)
+            {
+                count += (event.GetType() == type) ? 1 : 0;
+            }
+            return count;
+        }
+
+    private:
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        std::vector<Event> m_Events;
+    };
+
+    // a manager on its own event loop, driven by a mock server; the manager goes first
+    struct Fixture
+    {
+        explicit Fixture(const MockAudioServer::Configuration& configuration = MockAudioServer::Configuration())
+            : m_Manager(std::make_unique<SoundDeviceManager>(std::string(), std::make_shared<EventLoop>()))
+        {
+            auto server = std::make_unique<MockAudioServer>(configuration);
+            m_Server = server.get();
+            m_Manager->SetAudioServer(std::move(server));
+            m_Manager->SetCallback([this](const Event& event) { m_Events.Record(event); });
+        }
+
+        EventRecorder m_Events;
+        std::unique_ptr<SoundDeviceManager> m_Manager;
+        MockAudioServer* m_Server;
+    };
+
+    const DeviceRecord* FindOutputDevice(const SoundDeviceManager::Snapshot& snapshot, std::string_view name)
+    {
+        for (auto& record : snapshot.m_OutputDeviceRecords)
+        {
+            if (record.m_Name == name)
+            {
+                return &record;
+            }
+        }
+        return nullptr;
+    }
+
+    // the list changed events for the output devices, in order
+    std::vector<std::shared_ptr<const DeviceListChange>> GetOutputListChanges(const std::vector<Event>& events)
+    {
+        std::vector<std::shared_ptr<const DeviceListChange>> changes;
+        for (auto& event : events)
+        {
+            if (event.GetType() == Event::OUTPUT_DEVICE_LIST_CHANGED)
+            {
+                changes.push_back(event.GetDeviceListChange());
+            }
+        }
+        return changes;
+    }
+
+    //
+    // DEVICE_MANAGER_READY is raised once per manager: a second Start(), late startup replies after
+    // the startup timeout and a reconnect do not raise it again
+    //
+    void TestReadyOnce()
+    {
+        {
+            Fixture fixture;
+            fixture.m_Manager->Start();
+            fixture.m_Manager->Start();
+            CHECK(fixture.m_Manager->WaitUntilReady(EVENT_TIMEOUT));
+            CHECK(fixture.m_Events.WaitForCount(Event::DEVICE_MANAGER_READY, 1));
+            CHECK(!fixture.m_Manager->GetSnapshot()->m_Stale);
+
+            fixture.m_Server->Restart(0);
+            CHECK(fixture.m_Events.WaitForCount(Event::CONNECTION_RESTORED, 1));
+            std::this_thread::sleep_for(QUIET_PERIOD);
+            CHECK(fixture.m_Events.Count(Event::DEVICE_MANAGER_READY) == 1);
+        }
+        {
+            // the startup replies arrive after the startup timeout made the manager ready
+            MockAudioServer::Configuration configuration;
+            configuration.m_Latency = 200000;
+            Fixture fixture(configuration);
+            fixture.m_Manager->SetStartupTimeout(50ms);
+            fixture.m_Manager->Start();
+            CHECK(fixture.m_Events.WaitForCount(Event::DEVICE_MANAGER_READY, 1));
+            CHECK(WaitUntil([&]()
+            {
+                return fixture.m_Manager->GetSnapshot()->m_OutputDeviceRecords.size() == configuration.m_Sinks;
+            }));
+            std::this_thread::sleep_for(QUIET_PERIOD);
+            CHECK(fixture.m_Events.Count(Event::DEVICE_MANAGER_READY) == 1);
+        }
+    }
+
+    //
+    // an added, a renamed and a removed sink each raise one list changed event that reports
+    // exactly that device; the added device is in the snapshot when its event arrives
+    //
+    void TestDeviceListDiff()
+    {
+        Fixture fixture;
+        fixture.m_Manager->Start();
+        CHECK(fixture.m_Events.WaitForCount(Event::DEVICE_MANAGER_READY, 1));
+        fixture.m_Events.Clear();
+
+        std::atomic<bool> addedInSnapshot{false};
+        fixture.m_Manager->SetCallback([&](const Event& event)
+        {
+            if (event.GetType() == Event::OUTPUT_DEVICE_ADDED)
+            {
+                for (auto& record : fixture.m_Manager->GetSnapshot()->m_OutputDeviceRecords)
+                {
+                    addedInSnapshot = addedInSnapshot || (record.m_Handle == event.GetDevice());
+                }
+            }
+            fixture.m_Events.Record(event);
+        });
+
+        fixture.m_Server->AddSink("test_sink", "Test Sink");
+        CHECK(fixture.m_Events.WaitForCount(Event::OUTPUT_DEVICE_LIST_CHANGED, 1));
+        auto changes = GetOutputListChanges(fixture.m_Events.GetEvents());
+        DeviceHandle handle;
+        if (CHECK(changes.size() == 1) && CHECK(changes[0]->m_Added.size() == 1))
+        {
+            CHECK(changes[0]->m_Removed.empty());
+            CHECK(changes[0]->m_Modified.empty());
+            CHECK(changes[0]->m_Added[0].m_Name == "test_sink");
+            CHECK(changes[0]->m_Added[0].m_Description == "Test Sink");
+            handle = changes[0]->m_Added[0].m_Handle;
+        }
+        CHECK(fixture.m_Events.Count(Event::OUTPUT_DEVICE_ADDED) == 1);
+        CHECK(addedInSnapshot);
+
+        fixture.m_Server->SetSinkDescription("test_sink", "Renamed Sink");
+        CHECK(fixture.m_Events.WaitForCount(Event::OUTPUT_DEVICE_LIST_CHANGED, 2));
+        changes = GetOutputListChanges(fixture.m_Events.GetEvents());
+        if (CHECK(changes.size() == 2) && CHECK(changes[1]->m_Modified.size() == 1))
+        {
+            CHECK(changes[1]->m_Added.empty());
+            CHECK(changes[1]->m_Removed.empty());
+            CHECK(changes[1]->m_Modified[0].m_Handle == handle);
+            CHECK(changes[1]->m_Modified[0].m_Description == "Renamed Sink");
+        }
+        auto record = FindOutputDevice(*fixture.m_Manager->GetSnapshot(), "test_sink");
+        CHECK(record && (record->m_Description == "Renamed Sink"));
+
+        fixture.m_Server->RemoveSink("test_sink");
+        CHECK(fixture.m_Events.WaitForCount(Event::OUTPUT_DEVICE_LIST_CHANGED, 3));
+        changes = GetOutputListChanges(fixture.m_Events.GetEvents());
+        if (CHECK(changes.size() == 3) && CHECK(changes[2]->m_Removed.size() == 1))
+        {
+            CHECK(changes[2]->m_Added.empty());
+            CHECK(changes[2]->m_Modified.empty());
+            CHECK(changes[2]->m_Removed[0].m_Handle == handle);
+        }
+        CHECK(fixture.m_Events.Count(Event::OUTPUT_DEVICE_REMOVED) == 1);
+        CHECK(!FindOutputDevice(*fixture.m_Manager->GetSnapshot(), "test_sink"));
+    }
+
+    //
+    // after a reconnect the registry is resynced: nothing is reported when nothing changed,
+    // otherwise one list change with what changed meanwhile precedes CONNECTION_RESTORED
+    // and the surviving devices keep their handles
+    //
+    void TestResync()
+    {
+        Fixture fixture;
+        fixture.m_Manager->Start();
+        CHECK(fixture.m_Events.WaitForCount(Event::DEVICE_MANAGER_READY, 1));
+        fixture.m_Events.Clear();
+        auto snapshot = fixture.m_Manager->GetSnapshot();
+        auto survivor = FindOutputDevice(*snapshot, "mock_sink_0");
+        auto removed = FindOutputDevice(*snapshot, "mock_sink_1");
+        if (!CHECK(survivor && removed))
+        {
+            return;
+        }
+        auto survivorHandle = survivor->m_Handle;
+        auto removedHandle = removed->m_Handle;
+
+        fixture.m_Server->Restart(0);
+        CHECK(fixture.m_Events.WaitForCount(Event::CONNECTION_RESTORED, 1));
+        CHECK(fixture.m_Events.Count(Event::CONNECTION_LOST) == 1);
+        CHECK(fixture.m_Events.Count(Event::OUTPUT_DEVICE_LIST_CHANGED) == 0);
+        CHECK(fixture.m_Events.Count(Event::INPUT_DEVICE_LIST_CHANGED) == 0);
+        fixture.m_Events.Clear();
+
+        // the changes are applied while the server is down, without subscription events
+        fixture.m_Server->Restart(200000);
+        fixture.m_Server->RemoveSink("mock_sink_1");
+        fixture.m_Server->AddSink("test_sink", "Test Sink");
+        CHECK(fixture.m_Events.WaitForCount(Event::CONNECTION_RESTORED, 1));
+        auto events = fixture.m_Events.GetEvents();
+        auto changes = GetOutputListChanges(events);
+        if (CHECK(changes.size() == 1))
+        {
+            CHECK(changes[0]->m_Added.size() == 1);
+            CHECK(changes[0]->m_Removed.size() == 1);
+            CHECK(changes[0]->m_Modified.empty());
+            if (!changes[0]->m_Added.empty())
+            {
+                CHECK(changes[0]->m_Added[0].m_Name == "test_sink");
+            }
+            if (!changes[0]->m_Removed.empty())
+            {
+                CHECK(changes[0]->m_Removed[0].m_Handle == removedHandle);
+            }
+        }
+        CHECK(events.back().GetType() == Event::CONNECTION_RESTORED);
+
+        snapshot = fixture.m_Manager->GetSnapshot();
+        CHECK(!snapshot->m_Stale);
+        auto record = FindOutputDevice(*snapshot, "mock_sink_0");
+        CHECK(record && (record->m_Handle == survivorHandle));
+        CHECK(!FindOutputDevice(*snapshot, "mock_sink_1"));
+        CHECK(FindOutputDevice(*snapshot, "test_sink"));
+    }
+
+    //
+    // a manager destroyed with startup queries in flight raises no events while shutting down
+    //
+    void TestShutdown()
+    {
+        MockAudioServer::Configuration configuration;
+        configuration.m_HangRate = 1.0;
+        Fixture fixture(configuration);
+        fixture.m_Manager->SetStartupTimeout(60000ms);
+        fixture.m_Manager->Start();
+        CHECK(WaitUntil([&]() { return fixture.m_Manager->GetOperationStatistics().m_InFlight > 0; }));
+        CHECK(!fixture.m_Manager->IsReady());
+
+        fixture.m_Manager.reset();
+        CHECK(fixture.m_Events.GetEvents().empty());
+    }
+
+    //
+    // detached devices stay in the table until RemoveDetached(), re-attaching one keeps its handle
+    //
+    void TestDeviceTableDetach()
+    {
+        DeviceTable table;
+        auto first = table.Add(1, "detach_first", "First")->m_Handle;
+        table.Add(2, "detach_second", "Second");
+        table.TakeChanges();
+
+        table.Detach();
+        CHECK(table.Size() == 2);
+        CHECK(!table.FindByIndex(1));
+        auto record = table.Add(11, "detach_first", "First");
+        CHECK(record->m_Handle == first);
+        CHECK(table.Size() == 2);
+        CHECK(table.TakeChanges().IsEmpty());
+
+        CHECK(table.RemoveDetached().size() == 1);
+        CHECK(table.Size() == 1);
+        auto change = table.TakeChanges();
+        CHECK(change.m_Added.empty() && (change.m_Removed.size() == 1));
+    }
+
+    //
+    // device cache files: a stored topology loads back unchanged; a truncated or corrupted file
+    // is rejected and leaves the topology of the caller as it was
+    //
+    void TestDeviceCacheDecode()
+    {
+        char directoryTemplate[] = "/tmp/pamanagerTests-XXXXXX";
+        if (!CHECK(mkdtemp(directoryTemplate)))
+        {
+            return;
+        }
+        std::string directory = directoryTemplate;
+        std::string filename = directory + "/devices";
+
+        DeviceCache::Topology topology;
+        topology.m_InputDevices = {{"source_a", "Source A", 40}};
+        topology.m_OutputDevices = {{"sink_a", "Sink A", 75}, {"sink_b", "", 100}};
+        topology.m_DefaultInputDevice = "source_a";
+        topology.m_DefaultOutputDevice = "sink_b";
+        DeviceCache cache;
+        cache.SetFile(filename);
+        CHECK(cache.Store(topology));
+
+        std::string contents;
+        {
+            std::ifstream file(filename, std::ios::binary);
+            contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        // loads contents through a new cache, the topology starts out as sentinel
+        DeviceCache::Topology sentinel;
+        sentinel.m_DefaultOutputDevice = "sentinel";
+        auto load = [&](const std::string& data, DeviceCache::Topology& loaded)
+        {
+            {
+                std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+                file.write(data.data(), static_cast<std::streamsize>(data.size()));
+            }
+            loaded = sentinel;
+            DeviceCache reader;
+            reader.SetFile(filename);
+            return reader.Load(loaded);
+        };
+        auto isSentinel = [&](const DeviceCache::Topology& loaded)
+        {
+            return loaded.m_InputDevices.empty() && loaded.m_OutputDevices.empty() &&
+                   loaded.m_DefaultInputDevice.empty() && (loaded.m_DefaultOutputDevice == "sentinel");
+        };
+
+        DeviceCache::Topology loaded;
+        if (CHECK(load(contents, loaded)) && CHECK(loaded.m_OutputDevices.size() == 2) &&
+            CHECK(loaded.m_InputDevices.size() == 1))
+        {
+            CHECK(loaded.m_OutputDevices[0].m_Name == "sink_a");
+            CHECK(loaded.m_OutputDevices[0].m_Description == "Sink A");
+            CHECK(loaded.m_OutputDevices[0].m_Volume == 75);
+            CHECK(loaded.m_OutputDevices[1].m_Description.empty());
+            CHECK(loaded.m_InputDevices[0].m_Volume == 40);
+            CHECK(loaded.m_DefaultInputDevice == "source_a");
+            CHECK(loaded.m_DefaultOutputDevice == "sink_b");
+        }
+
+        // every field is needed, no prefix of the file is a valid cache
+        bool truncatedRejected = true;
+        for (size_t size = 0; size < contents.size(); size++)
+        {
+            truncatedRejected = truncatedRejected && !load(contents.substr(0, size), loaded) && isSentinel(loaded);
+        }
+        CHECK(truncatedRejected);
+
+        // layout: magic, version, number of input and output devices, then the length of the default input
+        auto corrupt = [&](size_t offset, uint32_t value)
+        {
+            auto data = contents;
+            data.replace(offset, sizeof(value), reinterpret_cast<const char*>(&value), sizeof(value));
+            return data;
+        };
+        auto badMagic = contents;
+        badMagic[0] = 'X';
+        CHECK(!load(badMagic, loaded) && isSentinel(loaded));
+        CHECK(!load(corrupt(4, 2), loaded) && isSentinel(loaded));          // unknown version
+        CHECK(!load(corrupt(12, 0xffffffff), loaded) && isSentinel(loaded)); // more output devices than stored
+        CHECK(!load(corrupt(16, 0xffffffff), loaded) && isSentinel(loaded)); // string beyond the end
+
+        unlink(filename.c_str());
+        rmdir(directory.c_str());
+    }
+
+    //
+    // percent to volume and back is exact on all table entries, the ends included; volumes and positions
+    // beyond the ends are clamped
+    //
+    void TestVolumeCurveRoundTrip()
+    {
+        for (auto curve : {VolumeCurve::CUBIC, VolumeCurve::LINEAR, VolumeCurve::DECIBEL})
+        {
+            bool exact = true;
+            for (uint percent = 0; percent <= 100; percent++)
+            {
+                auto volume = PercentToVolume(percent, curve);
+                exact = exact && (VolumeToPercent(volume, curve) == percent) &&
+                        (VolumeToPosition(volume, curve) == static_cast<float>(percent)) &&
+                        (PositionToVolume(static_cast<float>(percent), curve) == volume);
+            }
+            CHECK(exact);
+
+            CHECK(PercentToVolume(0, curve) == PA_VOLUME_MUTED);
+            CHECK(PercentToVolume(100, curve) == PA_VOLUME_NORM);
+            CHECK(PercentToVolume(150, curve) == PA_VOLUME_NORM);
+            CHECK(VolumeToPercent(PA_VOLUME_MUTED, curve) == 0);
+            CHECK(VolumeToPercent(PA_VOLUME_NORM, curve) == 100);
+            CHECK(VolumeToPercent(PA_VOLUME_MAX, curve) == 100);
+            CHECK(VolumeToPosition(PA_VOLUME_MUTED, curve) == 0.0f);
+            CHECK(VolumeToPosition(PA_VOLUME_MAX, curve) == 100.0f);
+            CHECK(PositionToVolume(-1.0f, curve) == PA_VOLUME_MUTED);
+            CHECK(PositionToVolume(101.0f, curve) == PA_VOLUME_NORM);
+
+            // between the entries the position is interpolated, back and forth within one step
+            auto first = PercentToVolume(1, curve);
+            auto middle = PositionToVolume(0.5f, curve);
+            CHECK((middle > PA_VOLUME_MUTED) && (middle < first));
+            auto position = VolumeToPosition(middle, curve);
+            CHECK((position > 0.49f) && (position < 0.51f));
+            auto last = PositionToVolume(99.5f, curve);
+            CHECK((last > PercentToVolume(99, curve)) && (last < PA_VOLUME_NORM));
+        }
+    }
+
+    //
+    // percentiles are the upper bound of their bucket, at most 12.5% above the exact value and
+    // never above the maximum
+    //
+    void TestLatencyHistogramPercentiles()
+    {
+        {
+            LatencyHistogram histogram;
+            auto statistics = histogram.GetStatistics();
+            CHECK((statistics.m_Count == 0) && (statistics.m_P50Ns == 0) && (statistics.m_MaxNs == 0));
+        }
+        {
+            LatencyHistogram histogram;
+            histogram.Record(std::chrono::nanoseconds(12345));
+            auto statistics = histogram.GetStatistics();
+            CHECK(statistics.m_Count == 1);
+            CHECK(statistics.m_MeanNs == 12345);
+            CHECK(statistics.m_MaxNs == 12345);
+            CHECK((statistics.m_P50Ns == 12345) && (statistics.m_P999Ns == 12345));
+        }
+        {
+            // small values have buckets of their own
+            LatencyHistogram histogram;
+            for (int value = 0; value < 8; value++)
+            {
+                histogram.Record(std::chrono::nanoseconds(value));
+            }
+            auto statistics = histogram.GetStatistics();
+            CHECK(statistics.m_P50Ns == 3);
+            CHECK(statistics.m_P90Ns == 6);
+        }
+        {
+            LatencyHistogram histogram;
+            for (int value = 1; value <= 1000; value++)
+            {
+                histogram.Record(std::chrono::microseconds(value));
+            }
+            histogram.Record(std::chrono::nanoseconds(-5)); // counted as 0
+            auto statistics = histogram.GetStatistics();
+            CHECK(statistics.m_Count == 1001);
+            CHECK(statistics.m_MaxNs == 1000000);
+            CHECK(statistics.m_MeanNs == 500000);
+            auto withinBucket = [](uint64_t percentile, uint64_t exact)
+            {
+                return (percentile >= exact) && (percentile <= exact + exact / 8);
+            };
+            CHECK(withinBucket(statistics.m_P50Ns, 500000));
+            CHECK(withinBucket(statistics.m_P90Ns, 900000));
+            CHECK(withinBucket(statistics.m_P99Ns, 990000));
+            CHECK(statistics.m_P999Ns == statistics.m_MaxNs);
+        }
+        {
+            // beyond the last bucket the maximum is exact
+            LatencyHistogram histogram;
+            histogram.Record(std::chrono::hours(1));
+            CHECK(histogram.GetStatistics().m_P99Ns == 3600000000000ULL);
+        }
+    }
+
+    struct Test
+    {
+        const char* m_Name;
+        void (*m_Function)();
+    };
+
+    const Test g_Tests[] =
+    {
+        {"ReadyOnce", TestReadyOnce},
+        {"DeviceListDiff", TestDeviceListDiff},
+        {"Resync", TestResync},
+        {"Shutdown", TestShutdown},
+        {"DeviceTableDetach", TestDeviceTableDetach},
+        {"DeviceCacheDecode", TestDeviceCacheDecode},
+        {"VolumeCurveRoundTrip", TestVolumeCurveRoundTrip},
+        {"LatencyHistogramPercentiles", TestLatencyHistogramPercentiles},
+    };
+}
+
+using namespace Tests;
+
+int main()
+{
+    uint failedTests = 0;
+    for (auto& test : g_Tests)
+    {
+        PrintMessage(Color::FG_DEFAULT, std::string("running ") + test.m_Name);
+        uint failures = g_Failures;
+        test.m_Function();
+        if (g_Failures != failures)
+        {
+            failedTests++;
+            PrintMessage(Color::FG_RED, std::string(test.m_Name) + ": failed");
+        }
+        else
+        {
+            PrintMessage(Color::FG_GREEN, std::string(test.m_Name) + ": passed");
+        }
+    }
+    PrintMessage(failedTests ? Color::FG_RED : Color::FG_GREEN,
+                 std::to_string(g_Checks) + " checks, " + std::to_string(g_Failures) + " failed");
+    return failedTests ? 1 : 0;
+}